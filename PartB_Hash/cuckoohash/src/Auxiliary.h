@@ -10,6 +10,7 @@
 #include <sstream>
 #include <string>
 #include <set>
+#include <unordered_set>
 #include <algorithm>
 #include <random>
 #include <chrono>
@@ -18,6 +19,18 @@
 #include "Substring.h"
 #include "CustomHash.h"
 #include "Parser.h"
+#include "WindowScanner.h"
+#include "BatchHash.h"
+#include "FrozenCuckooTable.h"
+#include "BinaryFuseFilter.h"
+#include "ParallelScan.h"
+#include "SidArena.h"
+#include "CuckooFilterTable.h"
+#include "PerfectHashIndex.h"
+#include "TableSnapshot.h"
+#include "HugePages.h"
+#include "CuckooPlacement.h"
+#include "Ruleset.h"
 #include "Statistics.h"
 #include "Config.h"
 
@@ -43,8 +56,32 @@ void createDir(std::string path) {
 #endif
 }
 
+// Shuffles a vector with a given seed. Unlike std::shuffle (whose algorithm is implementation defined), the order only depends
+// on the seed: the same on every platform and standard library.
+template<typename T>
+void deterministicShuffle(std::vector<T>& items, uint64_t seed) {
+    std::mt19937_64 generator(seed);
+    for (std::size_t i = items.size(); i > 1; --i) {
+        std::swap(items[i - 1], items[static_cast<std::size_t>(generator() % i)]);
+    }
+}
+
+// The resident memory of the process counted by the given field of /proc/self/status ("VmRSS", or "RssAnon" for the private
+// memory and "RssFile" for the mapped files, whose pages are shared with the other processes mapping them), in Bytes.
+// 0 where /proc is not available.
+std::size_t processMemoryBytes(const std::string& field) {
+    std::ifstream status_file("/proc/self/status");
+    std::string line;
+    while (std::getline(status_file, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return static_cast<std::size_t>(std::stoull(line.substr(field.size() + 1))) * 1024;     // the values are in kB
+        }
+    }
+    return 0;
+}
+
 // Gets the arguments for the main functions for either Visual Studio environment or WSL environment
-void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_path, std::size_t* num_of_tests, std::string& test_path) {
+void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_path, std::size_t* num_of_tests, std::string& test_path, std::string& ruleset_path) {
     bool is_file_path_set = false;
 #if defined _MSC_VER    // Visual Studio
     // Running from Visual Studio: get params from 'args' field in "launch.vs.json" (Debug -> Debug and Launch Settings for <project_name>)
@@ -61,10 +98,13 @@ void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_p
     if (argc > 4) {
         test_path = argv[4];
     }
+    if (argc > 5) {
+        ruleset_path = argv[5];
+    }
 #elif defined __GNUC__  // WSL (GNU/Linux)
     // Running from WSL: get params from "run_project_unix.sh" script
     int opt = 0;
-    while ((opt = getopt(argc, argv, "f:d:n:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "f:d:n:t:b:")) != -1) {
         switch (opt) {
         case 'f':
             file_path = optarg;
@@ -80,18 +120,85 @@ void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_p
         case 't':
             test_path = optarg;
             break;
+        case 'b':
+            ruleset_path = optarg;
+            break;
         default:
-            std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-n num_of_tests] [-t test_path]" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-n num_of_tests] [-t test_path] [-b ruleset_path]" << std::endl;
             exit(EXIT_FAILURE);
         }
     }
 #endif  
     if (!is_file_path_set) {
-        std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-n num_of_tests]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-n num_of_tests] [-t test_path] [-b ruleset_path]" << std::endl;
         exit(EXIT_FAILURE);
     }
+    if (ruleset_path.empty()) {
+        ruleset_path = defaultRulesetPath(file_path);
+    }
     std::cout << "File path: " << file_path << std::endl;
 }
+
+// Gets the arguments of the benchmarks executable (bench.cpp) for either Visual Studio environment or WSL environment
+void getBenchOpts(int argc, char* argv[], std::string& file_path, std::string& dest_path, std::string& mode, std::size_t* iterations, std::string& test_path, std::string& ruleset_path) {
+    bool is_file_path_set = false;
+#if defined _MSC_VER    // Visual Studio
+    if (argc > 1) {
+        file_path = argv[1];
+        is_file_path_set = true;
+    }
+    if (argc > 2) {
+        dest_path = argv[2];
+    }
+    if (argc > 3) {
+        mode = argv[3];
+    }
+    if (argc > 4) {
+        *iterations = std::stoi(argv[4]);
+    }
+    if (argc > 5) {
+        test_path = argv[5];
+    }
+    if (argc > 6) {
+        ruleset_path = argv[6];
+    }
+#elif defined __GNUC__  // WSL (GNU/Linux)
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "f:d:m:n:t:b:")) != -1) {
+        switch (opt) {
+        case 'f':
+            file_path = optarg;
+            is_file_path_set = true;
+            break;
+        case 'd':
+            dest_path = optarg;
+            break;
+        case 'm':
+            mode = optarg;
+            break;
+        case 'n':
+            *iterations = static_cast<std::size_t>(std::stoi(std::string(optarg)));
+            break;
+        case 't':
+            test_path = optarg;
+            break;
+        case 'b':
+            ruleset_path = optarg;
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-m mode] [-n iterations] [-t test_path] [-b ruleset_path]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+#endif  
+    if (!is_file_path_set) {
+        std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-m mode] [-n iterations] [-t test_path] [-b ruleset_path]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (ruleset_path.empty()) {
+        ruleset_path = defaultRulesetPath(file_path);
+    }
+}
 // END OF ENVIRONMENT DEFINITIONS
 
 #endif                          // Auxiliary.h
@@ -0,0 +1,309 @@
+#ifndef _BATCH_HASH_H
+#define _BATCH_HASH_H
+
+#include "CustomHash.h"
+#include "SubstringKey.h"
+#include "WindowScanner.h"
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+#if defined __GNUC__ && defined __x86_64__
+#include <immintrin.h>
+#define BATCH_HASH_HAS_X86_DISPATCH     // AVX2 / AVX-512 kernels are compiled with target attributes, and picked at runtime
+#endif
+
+#define BATCH_HASH_BLOCK_SIZE 256       // number of windows hashed at once (the keys and hashes of a block stay in L1)
+
+/*
+Batched hashing of the windows of a payload.
+The windows of a block of the payload are built first (see loadWindow), then all of their keys are hashed at once:
+the CustomHash multiply-xorshift rounds run on 8 (AVX2) or 16 (AVX-512) 32 bits keys, or 4 / 8 64 bits keys, per instruction.
+The kernels compute exactly CustomHash (bit-identical, checked by the 'batch' benchmark), so tables built with CustomHash
+are looked up with the batched hashes as they are. Keys of 2 or 16 bytes are hashed by the scalar CustomHash.
+*/
+
+
+/// <summary>
+/// Scalar kernel: hashes[i] = CustomHash()(keys[i]).
+/// </summary>
+template<typename K>
+inline void hashKeysScalar(const K* keys, std::size_t count, std::size_t* hashes) {
+    CustomHash hasher;
+    for (std::size_t i = 0; i < count; ++i) {
+        hashes[i] = hasher(keys[i]);
+    }
+}
+
+#if defined BATCH_HASH_HAS_X86_DISPATCH
+/// <summary>
+/// AVX2 kernel of CustomHash for uint32_t keys (8 keys per iteration).
+/// </summary>
+__attribute__((target("avx2"))) inline void hashKeys32Avx2(const uint32_t* keys, std::size_t count, std::size_t* hashes) {
+    const __m256i mult = _mm256_set1_epi32(static_cast<int>(MURMURHASH3_MULTIPLIER_UINT32_T));
+    const __m256i seed = _mm256_set1_epi32(static_cast<int>(HASH_SEED_UINT32_T));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i hash = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        hash = _mm256_xor_si256(seed, _mm256_mullo_epi32(hash, mult));
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, MURMURHASH3_FIRST_ROUND_SHIFT_UINT32_T));
+        hash = _mm256_mullo_epi32(hash, mult);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, MURMURHASH3_SECOND_ROUND_SHIFT_UINT32_T));
+        // zero extend the 32 bits hashes to std::size_t
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), _mm256_cvtepu32_epi64(_mm256_castsi256_si128(hash)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i + 4), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(hash, 1)));
+    }
+    hashKeysScalar(keys + i, count - i, hashes + i);
+}
+
+/// <summary>
+/// The lower 64 bits of a * b for 4 lanes (AVX2 has no 64 bits multiply): lo(a)*lo(b) + ((lo(a)*hi(b) + hi(a)*lo(b)) << 32).
+/// </summary>
+__attribute__((target("avx2"))) inline __m256i multiplyLow64Avx2(__m256i a, __m256i b, __m256i b_high) {
+    __m256i low = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, b_high), _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+/// <summary>
+/// AVX2 kernel of CustomHash for uint64_t keys (4 keys per iteration).
+/// </summary>
+__attribute__((target("avx2"))) inline void hashKeys64Avx2(const uint64_t* keys, std::size_t count, std::size_t* hashes) {
+    const __m256i mult = _mm256_set1_epi64x(static_cast<long long>(MURMURHASH3_MULTIPLIER_UINT64_T));
+    const __m256i mult_high = _mm256_srli_epi64(mult, 32);
+    const __m256i seed = _mm256_set1_epi64x(static_cast<long long>(HASH_SEED_UINT64_T));
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i hash = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        hash = _mm256_xor_si256(seed, multiplyLow64Avx2(hash, mult, mult_high));
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi64(hash, MURMURHASH3_ROUND_SHIFT_UINT64_T));
+        hash = multiplyLow64Avx2(hash, mult, mult_high);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi64(hash, MURMURHASH3_ROUND_SHIFT_UINT64_T));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), hash);
+    }
+    hashKeysScalar(keys + i, count - i, hashes + i);
+}
+
+// GCC 12 reports the _mm512_undefined passthrough of the AVX-512 shifts and extracts as maybe-uninitialized where they are
+//  inlined, i.e. in the kernels: a false positive (those lanes are never read)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+/// <summary>
+/// AVX-512 kernel of CustomHash for uint32_t keys (16 keys per iteration).
+/// </summary>
+__attribute__((target("avx512f"))) inline void hashKeys32Avx512(const uint32_t* keys, std::size_t count, std::size_t* hashes) {
+    const __m512i mult = _mm512_set1_epi32(static_cast<int>(MURMURHASH3_MULTIPLIER_UINT32_T));
+    const __m512i seed = _mm512_set1_epi32(static_cast<int>(HASH_SEED_UINT32_T));
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i hash = _mm512_loadu_si512(keys + i);
+        hash = _mm512_xor_si512(seed, _mm512_mullo_epi32(hash, mult));
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi32(hash, MURMURHASH3_FIRST_ROUND_SHIFT_UINT32_T));
+        hash = _mm512_mullo_epi32(hash, mult);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi32(hash, MURMURHASH3_SECOND_ROUND_SHIFT_UINT32_T));
+        _mm512_storeu_si512(hashes + i, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(hash)));
+        _mm512_storeu_si512(hashes + i + 8, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(hash, 1)));
+    }
+    hashKeysScalar(keys + i, count - i, hashes + i);
+}
+
+/// <summary>
+/// AVX-512 kernel of CustomHash for uint64_t keys (8 keys per iteration, native 64 bits multiply of AVX-512DQ).
+/// </summary>
+__attribute__((target("avx512f,avx512dq"))) inline void hashKeys64Avx512(const uint64_t* keys, std::size_t count, std::size_t* hashes) {
+    const __m512i mult = _mm512_set1_epi64(static_cast<long long>(MURMURHASH3_MULTIPLIER_UINT64_T));
+    const __m512i seed = _mm512_set1_epi64(static_cast<long long>(HASH_SEED_UINT64_T));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i hash = _mm512_loadu_si512(keys + i);
+        hash = _mm512_xor_si512(seed, _mm512_mullo_epi64(hash, mult));
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi64(hash, MURMURHASH3_ROUND_SHIFT_UINT64_T));
+        hash = _mm512_mullo_epi64(hash, mult);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi64(hash, MURMURHASH3_ROUND_SHIFT_UINT64_T));
+        _mm512_storeu_si512(hashes + i, hash);
+    }
+    hashKeysScalar(keys + i, count - i, hashes + i);
+}
+#pragma GCC diagnostic pop
+#endif
+
+
+/// <summary>
+/// The widest kernel the CPU supports for keys of type K (the scalar kernel for uint16_t and uint128_t keys).
+/// </summary>
+template<typename K>
+struct HashKeysKernel {
+    typedef void (*kernel_type)(const K*, std::size_t, std::size_t*);
+
+    static kernel_type select() {
+        return hashKeysScalar<K>;
+    }
+};
+
+template<>
+struct HashKeysKernel<uint32_t> {
+    typedef void (*kernel_type)(const uint32_t*, std::size_t, std::size_t*);
+
+    static kernel_type select() {
+#if defined BATCH_HASH_HAS_X86_DISPATCH
+        if (__builtin_cpu_supports("avx512f")) {
+            return hashKeys32Avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return hashKeys32Avx2;
+        }
+#endif
+        return hashKeysScalar<uint32_t>;
+    }
+};
+
+template<>
+struct HashKeysKernel<uint64_t> {
+    typedef void (*kernel_type)(const uint64_t*, std::size_t, std::size_t*);
+
+    static kernel_type select() {
+#if defined BATCH_HASH_HAS_X86_DISPATCH
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+            return hashKeys64Avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return hashKeys64Avx2;
+        }
+#endif
+        return hashKeysScalar<uint64_t>;
+    }
+};
+
+/// <summary>
+/// hashes[i] = CustomHash()(keys[i]) for count keys, with the widest SIMD kernel available (selected once).
+/// </summary>
+template<typename K>
+inline void hashKeys(const K* keys, std::size_t count, std::size_t* hashes) {
+    static const typename HashKeysKernel<K>::kernel_type kernel = HashKeysKernel<K>::select();
+    kernel(keys, count, hashes);
+}
+
+
+/// <summary>
+/// Call callback(key, hash) for every window of L bytes of the payload, advancing G bytes every time (the windows of forEachWindow),
+/// where hash = CustomHash()(key). The windows are built and hashed in blocks of BATCH_HASH_BLOCK_SIZE.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="L">Length of the windows</typeparam>
+/// <typeparam name="G">Gap between 2 windows</typeparam>
+/// <param name="payload">The payload bytes</param>
+/// <param name="length">The number of bytes in the payload</param>
+/// <param name="tolower">Case fold the windows</param>
+/// <param name="callback">Called with each window's key and hash</param>
+template<typename K, std::size_t L, std::size_t G, typename F>
+inline void forEachHashedWindow(const uint8_t* payload, std::size_t length, bool tolower, F&& callback) {
+    static_assert(L <= sizeof(K), "The key type is too small for windows of L bytes (see SubstringKey<L>)");
+    K keys[BATCH_HASH_BLOCK_SIZE];
+    std::size_t hashes[BATCH_HASH_BLOCK_SIZE];
+    const uint8_t* end = payload + length;
+    std::size_t num_of_windows = (length >= L) ? (length - L) / G + 1 : 0;
+    for (std::size_t first = 0; first < num_of_windows; first += BATCH_HASH_BLOCK_SIZE) {
+        std::size_t count = std::min<std::size_t>(BATCH_HASH_BLOCK_SIZE, num_of_windows - first);
+        const uint8_t* block = payload + first * G;
+        for (std::size_t i = 0; i < count; ++i) {
+            keys[i] = static_cast<K>(loadWindow<L>(block + i * G, end, tolower));
+        }
+        hashKeys(keys, count, hashes);
+        for (std::size_t i = 0; i < count; ++i) {
+            callback(keys[i], hashes[i]);
+        }
+    }
+}
+
+/// <summary>
+/// The windows of two lengths LS < LL of the payload in a single pass (the windows of forEachHashedWindow<KS, LS, G> and of
+/// forEachHashedWindow<KL, LL, G>): at each position, the window of LL bytes is loaded once and the window of LS bytes is its
+/// first LS bytes (its upper bits), so only the last positions, where a window of LL bytes does not fit, load a short window.
+/// Calls short_callback(key, hash) / long_callback(key, hash) for every window of each length, hashed in blocks of BATCH_HASH_BLOCK_SIZE.
+/// </summary>
+/// <typeparam name="KS">Type of the key of the short windows, see SubstringKey<LS></typeparam>
+/// <typeparam name="LS">Length of the short windows</typeparam>
+/// <typeparam name="KL">Type of the key of the long windows, see SubstringKey<LL></typeparam>
+/// <typeparam name="LL">Length of the long windows (LL <= 8: a single load)</typeparam>
+/// <typeparam name="G">Gap between 2 windows (of each length)</typeparam>
+template<typename KS, std::size_t LS, typename KL, std::size_t LL, std::size_t G, typename FS, typename FL>
+inline void forEachHashedWindowPair(const uint8_t* payload, std::size_t length, bool tolower, FS&& short_callback, FL&& long_callback) {
+    static_assert(LS < LL && LL <= sizeof(uint64_t), "The short windows must be shorter than the long ones, which are a single load");
+    static_assert(LS <= sizeof(KS) && LL <= sizeof(KL), "The key types are too small for the windows (see SubstringKey<L>)");
+    KS short_keys[BATCH_HASH_BLOCK_SIZE];
+    KL long_keys[BATCH_HASH_BLOCK_SIZE];
+    std::size_t short_hashes[BATCH_HASH_BLOCK_SIZE];
+    std::size_t long_hashes[BATCH_HASH_BLOCK_SIZE];
+    const uint8_t* end = payload + length;
+    std::size_t num_of_short_windows = (length >= LS) ? (length - LS) / G + 1 : 0;
+    std::size_t num_of_long_windows = (length >= LL) ? (length - LL) / G + 1 : 0;
+    for (std::size_t first = 0; first < num_of_short_windows; first += BATCH_HASH_BLOCK_SIZE) {
+        std::size_t count = std::min<std::size_t>(BATCH_HASH_BLOCK_SIZE, num_of_short_windows - first);
+        std::size_t long_count = (num_of_long_windows > first) ? std::min(count, num_of_long_windows - first) : 0;
+        const uint8_t* block = payload + first * G;
+        for (std::size_t i = 0; i < long_count; ++i) {
+            long_keys[i] = static_cast<KL>(loadWindow<LL>(block + i * G, end, tolower));
+            short_keys[i] = static_cast<KS>(long_keys[i] >> (8 * (LL - LS)));
+        }
+        for (std::size_t i = long_count; i < count; ++i) {
+            short_keys[i] = static_cast<KS>(loadWindow<LS>(block + i * G, end, tolower));
+        }
+        hashKeys(short_keys, count, short_hashes);
+        hashKeys(long_keys, long_count, long_hashes);
+        for (std::size_t i = 0; i < count; ++i) {
+            short_callback(short_keys[i], short_hashes[i]);
+        }
+        for (std::size_t i = 0; i < long_count; ++i) {
+            long_callback(long_keys[i], long_hashes[i]);
+        }
+    }
+}
+
+
+/// <summary>
+/// A hasher which lets a lookup use a hash computed in advance (by the batched kernels) instead of hashing the key again.
+/// libcuckoo has no lookup by (key, hash), it always calls its hasher: arm(key, hash) stores the pair in a thread local slot,
+/// and the hasher returns the stored hash for this very key. Any other key (inserts, resizes, an unarmed lookup) is hashed by H,
+/// so a table of PrehashedHash<H> has exactly the layout of a table of H.
+/// </summary>
+/// <typeparam name="H">The hasher of the table (the armed hashes must be H's hashes, e.g. the batched CustomHash)</typeparam>
+template<typename H>
+struct PrehashedHash {
+    template<typename K>
+    struct Slot {
+        K key;
+        std::size_t hash;
+        bool armed;
+    };
+
+    template<typename K>
+    static Slot<K>& slot() {
+        static thread_local Slot<K> armed_slot = { 0, 0, false };
+        return armed_slot;
+    }
+
+    template<typename K>
+    static void arm(K key, std::size_t hash) {
+        Slot<K>& armed_slot = slot<K>();
+        armed_slot.key = key;
+        armed_slot.hash = hash;
+        armed_slot.armed = true;
+    }
+
+    template<typename K>
+    std::size_t operator()(const K key) const {
+        const Slot<K>& armed_slot = slot<K>();
+        if (armed_slot.armed && armed_slot.key == key) {
+            return armed_slot.hash;
+        }
+        return H()(key);
+    }
+};
+
+template<typename H>
+struct IsPrehashedHash : std::false_type {};
+template<typename H>
+struct IsPrehashedHash<PrehashedHash<H>> : std::true_type {};
+
+#endif // _BATCH_HASH_H
@@ -0,0 +1,248 @@
+#ifndef _BINARY_FUSE_FILTER_H
+#define _BINARY_FUSE_FILTER_H
+
+#include "CustomHash.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#define BINARY_FUSE_ARITY 3
+#define BINARY_FUSE_MAX_SEGMENT_LENGTH 262144
+#define BINARY_FUSE_MAX_ITERATIONS 100              // seeds tried before giving up the construction
+#define BINARY_FUSE_SEED_STATE 0x726b2b9d438b9d4d
+#define SPLITMIX64_INCREMENT_UINT64_T 0x9e3779b97f4a7c15
+#define SPLITMIX64_MULTIPLIER_1_UINT64_T 0xbf58476d1ce4e5b9
+#define SPLITMIX64_MULTIPLIER_2_UINT64_T 0x94d049bb133111eb
+#define MURMUR64_FINALIZER_1_UINT64_T 0xff51afd7ed558ccd
+#define MURMUR64_FINALIZER_2_UINT64_T 0xc4ceb9fe1a85ec53
+
+/*
+A static binary fuse filter with 8 bits fingerprints (Graf & Lemire, "Binary Fuse Filters: Fast and Smaller Than Xor Filters"):
+an approximate set of the keys of the substrings table, in ~9 bits per key (1.125 fingerprints per key for large sets, more
+for small ones), with a false positive rate of ~1/256 and no false negatives. A lookup xors the fingerprints of 3 slots
+(one in each of 3 consecutive segments of the array) with the fingerprint of the key, so it costs 3 loads and no branch.
+The set is fixed at construction; used as a prefilter in front of the cuckoo table, a window missing the filter (most of them)
+skips its two-bucket probe.
+*/
+
+
+/// <summary>
+/// A step of the SplitMix64 generator (the seeds of the construction attempts).
+/// </summary>
+inline uint64_t splitMix64(uint64_t* state) {
+    uint64_t z = (*state += SPLITMIX64_INCREMENT_UINT64_T);
+    z = (z ^ (z >> 30)) * SPLITMIX64_MULTIPLIER_1_UINT64_T;
+    z = (z ^ (z >> 27)) * SPLITMIX64_MULTIPLIER_2_UINT64_T;
+    return z ^ (z >> 31);
+}
+
+/// <summary>
+/// The finalizer of MurmurHash3 (64 bits).
+/// </summary>
+inline uint64_t murmur64(uint64_t h) {
+    h ^= h >> 33;
+    h *= MURMUR64_FINALIZER_1_UINT64_T;
+    h ^= h >> 33;
+    h *= MURMUR64_FINALIZER_2_UINT64_T;
+    h ^= h >> 33;
+    return h;
+}
+
+
+/// <summary>
+/// A static binary fuse filter (3-wise, 8 bits fingerprints) of keys of type K.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+template<typename K>
+class BinaryFuseFilter {
+public:
+    BinaryFuseFilter() : seed(0), segment_length(0), segment_length_mask(0), segment_count_length(0), num_of_keys(0) {}
+    explicit BinaryFuseFilter(std::vector<K> keys) : BinaryFuseFilter() { build(std::move(keys)); }
+
+    bool build(std::vector<K> keys);
+
+    /// <summary>
+    /// false: the key is not in the set. true: the key is in the set, or a false positive (~1/256).
+    /// </summary>
+    bool contains(const K& key) const {
+        if (fingerprints.empty()) {
+            return num_of_keys > 0;     // an empty set, or a construction which failed (then every key passes)
+        }
+        uint64_t hash = hashOf(key);
+        std::size_t h0 = 0, h1 = 0, h2 = 0;
+        positions(hash, &h0, &h1, &h2);
+        return (fingerprintOf(hash) ^ fingerprints[h0] ^ fingerprints[h1] ^ fingerprints[h2]) == 0;
+    }
+
+    std::size_t size() const { return num_of_keys; }
+    std::size_t sizeBytes() const { return fingerprints.size() * sizeof(uint8_t); }
+    double bitsPerKey() const { return num_of_keys ? 8.0 * sizeBytes() / num_of_keys : 0; }
+
+private:
+    uint64_t hashOf(const K& key) const {
+#if SUBSTRING_MAX_LENGTH > 8
+        if constexpr (sizeof(K) > sizeof(uint64_t)) {
+            return murmur64(murmur64(static_cast<uint64_t>(key >> 64) + seed) ^ static_cast<uint64_t>(key));
+        }
+        else
+#endif
+        {
+            return murmur64(static_cast<uint64_t>(key) + seed);
+        }
+    }
+    static uint8_t fingerprintOf(uint64_t hash) { return static_cast<uint8_t>(hash ^ (hash >> 32)); }
+    void positions(uint64_t hash, std::size_t* h0, std::size_t* h1, std::size_t* h2) const {
+        uint64_t low = 0;
+        uint64_t h = multiply128(hash, segment_count_length, &low);
+        *h0 = static_cast<std::size_t>(h);
+        *h1 = static_cast<std::size_t>((h + segment_length) ^ ((hash >> 18) & segment_length_mask));
+        *h2 = static_cast<std::size_t>((h + 2 * segment_length) ^ (hash & segment_length_mask));
+    }
+
+    std::vector<uint8_t> fingerprints;
+    uint64_t seed;
+    uint64_t segment_length;
+    uint64_t segment_length_mask;
+    uint64_t segment_count_length;
+    std::size_t num_of_keys;
+};
+
+
+/// <summary>
+/// Build the filter of the given keys (duplicates are removed): hash every key to 3 slots, peel the slots used by a single key
+/// (hypergraph peeling), and assign the fingerprints in the reverse peeling order. A construction which can not be peeled is
+/// retried with another seed.
+/// </summary>
+/// <returns>false if no seed of BINARY_FUSE_MAX_ITERATIONS could be peeled (the filter then passes every key)</returns>
+template<typename K>
+bool BinaryFuseFilter<K>::build(std::vector<K> keys) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    num_of_keys = keys.size();
+    std::size_t size = keys.size();
+
+    // Sizes of the segments and of the array (the parameters of the reference implementation for arity 3)
+    segment_length = (size == 0) ? 4 : uint64_t(1) << static_cast<int>(std::floor(std::log(double(size)) / std::log(3.33) + 2.25));
+    segment_length = std::min<uint64_t>(segment_length, BINARY_FUSE_MAX_SEGMENT_LENGTH);
+    segment_length_mask = segment_length - 1;
+    double size_factor = (size <= 1) ? 0 : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(double(size)));
+    uint64_t capacity = static_cast<uint64_t>(std::round(double(size) * size_factor));
+    int64_t segment_count = static_cast<int64_t>((capacity + segment_length - 1) / segment_length) - (BINARY_FUSE_ARITY - 1);
+    segment_count = std::max<int64_t>(segment_count, 1);
+    std::size_t array_length = static_cast<std::size_t>((segment_count + BINARY_FUSE_ARITY - 1) * segment_length);
+    segment_count_length = segment_count * segment_length;
+    fingerprints.assign(array_length, 0);
+    if (size == 0) {
+        fingerprints.clear();
+        return true;
+    }
+
+    std::vector<uint64_t> reverse_order(size + 1, 0);
+    std::vector<uint8_t> reverse_h(size);
+    std::vector<uint32_t> alone(array_length);
+    std::vector<uint8_t> t2count(array_length, 0);
+    std::vector<uint64_t> t2hash(array_length, 0);
+    reverse_order[size] = 1;        // sentinel of the bucket sort below
+
+    unsigned int block_bits = 1;
+    while ((uint64_t(1) << block_bits) < static_cast<uint64_t>(segment_count)) {
+        ++block_bits;
+    }
+    std::size_t block = std::size_t(1) << block_bits;
+    std::vector<std::size_t> start_positions(block);
+    uint64_t seed_state = BINARY_FUSE_SEED_STATE;
+    seed = splitMix64(&seed_state);
+
+    for (std::size_t iteration = 0; ; ++iteration) {
+        if (iteration >= BINARY_FUSE_MAX_ITERATIONS) {
+            fingerprints.clear();
+            return false;
+        }
+        // Sort the hashes roughly by their first segment (better locality of the counters below)
+        for (std::size_t i = 0; i < block; ++i) {
+            start_positions[i] = (i * size) >> block_bits;
+        }
+        for (const K& key : keys) {
+            uint64_t hash = hashOf(key);
+            std::size_t segment_index = static_cast<std::size_t>(hash >> (64 - block_bits));
+            while (reverse_order[start_positions[segment_index]] != 0) {
+                segment_index = (segment_index + 1) & (block - 1);
+            }
+            reverse_order[start_positions[segment_index]] = hash;
+            ++start_positions[segment_index];
+        }
+
+        // Count the keys of every slot (t2count >> 2), keep the xor of their hashes and of their indices in the 3 slots (t2count & 3)
+        bool error = false;
+        for (std::size_t i = 0; i < size; ++i) {
+            uint64_t hash = reverse_order[i];
+            std::size_t h0 = 0, h1 = 0, h2 = 0;
+            positions(hash, &h0, &h1, &h2);
+            t2count[h0] += 4;
+            t2hash[h0] ^= hash;
+            t2count[h1] += 4;
+            t2count[h1] ^= 1;
+            t2hash[h1] ^= hash;
+            t2count[h2] += 4;
+            t2count[h2] ^= 2;
+            t2hash[h2] ^= hash;
+            error = error || t2count[h0] < 4 || t2count[h1] < 4 || t2count[h2] < 4;     // a counter overflowed
+        }
+
+        // Peel: a slot of a single key determines that key's fingerprint last, remove the key from its 2 other slots
+        std::size_t stack_size = 0;
+        if (!error) {
+            std::size_t queue_size = 0;
+            for (std::size_t i = 0; i < array_length; ++i) {
+                alone[queue_size] = static_cast<uint32_t>(i);
+                queue_size += ((t2count[i] >> 2) == 1) ? 1 : 0;
+            }
+            while (queue_size > 0) {
+                std::size_t index = alone[--queue_size];
+                if ((t2count[index] >> 2) != 1) {
+                    continue;
+                }
+                uint64_t hash = t2hash[index];
+                std::size_t h012[5];
+                positions(hash, &h012[0], &h012[1], &h012[2]);
+                h012[3] = h012[0];
+                h012[4] = h012[1];
+                uint8_t found = t2count[index] & 3;
+                reverse_h[stack_size] = found;
+                reverse_order[stack_size] = hash;
+                ++stack_size;
+                for (uint8_t other = 1; other <= 2; ++other) {
+                    std::size_t other_index = h012[found + other];
+                    alone[queue_size] = static_cast<uint32_t>(other_index);
+                    queue_size += ((t2count[other_index] >> 2) == 2) ? 1 : 0;
+                    t2count[other_index] -= 4;
+                    t2count[other_index] ^= static_cast<uint8_t>((found + other) % 3);
+                    t2hash[other_index] ^= hash;
+                }
+            }
+        }
+        if (stack_size == size) {
+            break;
+        }
+        std::fill(reverse_order.begin(), reverse_order.begin() + size, 0);
+        std::fill(t2count.begin(), t2count.end(), 0);
+        std::fill(t2hash.begin(), t2hash.end(), 0);
+        seed = splitMix64(&seed_state);
+    }
+
+    // Assign the fingerprints in the reverse peeling order: the fingerprint of a key = xor of its 3 slots
+    for (std::size_t i = size; i-- > 0;) {
+        uint64_t hash = reverse_order[i];
+        std::size_t h012[5];
+        positions(hash, &h012[0], &h012[1], &h012[2]);
+        h012[3] = h012[0];
+        h012[4] = h012[1];
+        uint8_t found = reverse_h[i];
+        fingerprints[h012[found]] = fingerprintOf(hash) ^ fingerprints[h012[found + 1]] ^ fingerprints[h012[found + 2]];
+    }
+    return true;
+}
+
+#endif // _BINARY_FUSE_FILTER_H
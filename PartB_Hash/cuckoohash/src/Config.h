@@ -5,7 +5,21 @@
 #define NUMBER_OF_TESTS 100
 #define MAX_LOAD_FACTOR 0.75        // in [0,1]
 #define TABLE_SIZE 256              // in KB
+#define TABLE_SIZES { 2, 4, 8, 16, 32, 64, 128, 256, 512 }    // in KB, the table sizes swept by runTests (and bench.cpp)
 #define SHUFFLE_SEED 2847354131     // prime!
+#define TEST_THREADS 0              // threads running the trials of runTests (0 = number of hardware threads)
+#define SCAN_THREADS 0              // threads scanning the test payloads in searchTest (0 = number of hardware threads)
+#define USE_PREFILTER true          // searchTest looks the windows up in a binary fuse filter before the hash table
+#define USE_HUGE_PAGES true         // searchTest moves the structures the scan reads (frozen table, lists of SIDs) to huge pages
+
+// Micro benchmarks (bench.cpp):
+#define BENCH_ITERATIONS 1000       // number of passes over the test payloads when timing lookups
+#define BENCH_CORPUS_SIZE (1 << 20) // size (in Bytes) of the synthetic corpus
+#define BENCH_LARGE_CORPUS_SIZE (1 << 26)   // size (in Bytes) of the synthetic corpus of the parallel scan benchmark
+#define BENCH_FLOW_SIZE 1500        // the large corpus is cut into flows (payloads) of this size
+#define BENCH_HUGE_PAGES_SIZES { 256, 512, 4096, 32768 }  // in KB, the sizes of the synthetic tables of the huge pages benchmark
+#define BENCH_MIN_KEYS_PER_PARTIAL_KEY 8        // the hashes benchmark checks the spread of the partial keys from 256 * this keys on
+#define BENCH_MAX_PARTIAL_KEY_CHI_SQUARE 2.0    // ...and warns above this normalized chi-square (~1 for a uniform hash)
 
 // Additional data info (for IBLT / raw linked list calculations):
 const std::size_t SID_ENTRY_IN_LINKED_LIST = 64; // 32bits for the SID (ranges from 0-999999 => use uint32_t), 32bits for pointer (in x32 architecture)
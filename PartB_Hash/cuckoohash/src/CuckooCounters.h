@@ -0,0 +1,171 @@
+#ifndef _CUCKOO_COUNTERS_H
+#define _CUCKOO_COUNTERS_H
+
+#include <array>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+
+#define CUCKOO_COUNTERS_MAX_PATH_LENGTH 8           // longer cuckoo paths are counted in the last length (libcuckoo's BFS paths are at most 5 moves)
+#define CUCKOO_COUNTERS_LOAD_FACTOR_BINS 20         // the displacements are also counted per 5% of load factor
+
+/*
+Instrumentation of the insertions into a libcuckoo table, without changing libcuckoo: the table is given a CountingAllocator,
+through which libcuckoo constructs every element it places in a slot - the inserted element itself, every element moved
+along a cuckoo path (a displacement), and every element moved to the new buckets of a resize. countInsert() attributes the
+elements constructed during an insertion to it:
+    > the hashpower did not change: 1 placement + the displacements of its cuckoo path (libcuckoo's BFS path length);
+    > the hashpower changed: a resize (rehashing the table's elements);
+    > it threw (e.g. maximum_hashpower_exceeded) or found the key already in the table: a failed insertion.
+The allocator also counts the bytes the table holds in allocated_bytes: everything libcuckoo allocates through it, its buckets
+and its locks alike - the size of the table as allocated, rather than its capacity times the size of an element. constructs
+only counts the key-value pairs it constructs, not the locks.
+*/
+
+
+/// <summary>
+/// The counters of the insertions into a table (and their merge, over the trials of a test).
+/// </summary>
+struct CuckooCounters {
+    std::size_t constructs;                 // key-value pairs constructed by the table's allocator (placements, displacements, rehashes)
+    std::size_t inserts;                    // successful insertions
+    std::size_t failed_inserts;
+    std::size_t displacements;              // elements moved along the cuckoo paths of the insertions
+    std::size_t max_path_length;
+    std::size_t resizes;
+    std::size_t rehashed_elements;          // elements moved by the resizes
+    std::array<std::size_t, CUCKOO_COUNTERS_MAX_PATH_LENGTH + 1> path_lengths;          // insertions per cuckoo path length
+    std::array<std::size_t, CUCKOO_COUNTERS_LOAD_FACTOR_BINS> inserts_by_load_factor;  // insertions per load factor (before them)
+    std::array<std::size_t, CUCKOO_COUNTERS_LOAD_FACTOR_BINS> displacements_by_load_factor;
+    std::size_t allocated_bytes;            // bytes allocated by the table's allocator (buckets and locks) and not deallocated yet
+    std::size_t peak_allocated_bytes;
+
+    CuckooCounters() : constructs(0), inserts(0), failed_inserts(0), displacements(0), max_path_length(0), resizes(0),
+        rehashed_elements(0), path_lengths(), inserts_by_load_factor(), displacements_by_load_factor(), allocated_bytes(0),
+        peak_allocated_bytes(0) {}
+
+    void merge(const CuckooCounters& other) {
+        constructs += other.constructs;
+        inserts += other.inserts;
+        failed_inserts += other.failed_inserts;
+        displacements += other.displacements;
+        max_path_length = std::max(max_path_length, other.max_path_length);
+        resizes += other.resizes;
+        rehashed_elements += other.rehashed_elements;
+        for (std::size_t i = 0; i < path_lengths.size(); ++i) {
+            path_lengths[i] += other.path_lengths[i];
+        }
+        for (std::size_t i = 0; i < CUCKOO_COUNTERS_LOAD_FACTOR_BINS; ++i) {
+            inserts_by_load_factor[i] += other.inserts_by_load_factor[i];
+            displacements_by_load_factor[i] += other.displacements_by_load_factor[i];
+        }
+        allocated_bytes = std::max(allocated_bytes, other.allocated_bytes);      // the largest table of the trials
+        peak_allocated_bytes = std::max(peak_allocated_bytes, other.peak_allocated_bytes);
+    }
+};
+
+
+template<typename T>
+struct IsPair : std::false_type {};
+template<typename A, typename B>
+struct IsPair<std::pair<A, B>> : std::true_type {};
+
+/// <summary>
+/// An allocator (std::allocator's memory) which counts the bytes it holds and the key-value pairs constructed in it (see above).
+/// The copies and rebinds of an allocator count into the same counters.
+/// </summary>
+template<typename T>
+class CountingAllocator {
+public:
+    typedef T value_type;
+    template<typename U>
+    struct rebind {
+        typedef CountingAllocator<U> other;
+    };
+
+    CountingAllocator() : counters(nullptr) {}
+    explicit CountingAllocator(CuckooCounters* counters) : counters(counters) {}
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : counters(other.counters) {}
+
+    T* allocate(std::size_t n) {
+        T* p = std::allocator<T>().allocate(n);
+        if (counters != nullptr) {
+            counters->allocated_bytes += n * sizeof(T);
+            counters->peak_allocated_bytes = std::max(counters->peak_allocated_bytes, counters->allocated_bytes);
+        }
+        return p;
+    }
+    void deallocate(T* p, std::size_t n) {
+        if (counters != nullptr) {
+            counters->allocated_bytes -= n * sizeof(T);
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        if (IsPair<typename std::remove_cv<U>::type>::value && counters != nullptr) {
+            ++counters->constructs;
+        }
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+    template<typename U>
+    void destroy(U* p) { p->~U(); }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>& other) const { return counters == other.counters; }
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>& other) const { return counters != other.counters; }
+
+    CuckooCounters* counters;
+};
+
+
+/// <summary>
+/// Insert into a table whose allocator counts into counters (a CountingAllocator of these counters, used by this table only),
+/// and attribute the elements the table constructed meanwhile to the insertion (see above). The exceptions of the insertion
+/// are counted as failed insertions, and rethrown.
+/// </summary>
+/// <param name="insert">insert(): inserts into the table, returns true if the key was inserted</param>
+/// <returns>The result of insert()</returns>
+template<typename T, typename F>
+bool countInsert(const T& table, CuckooCounters& counters, F insert) {
+    std::size_t hash_power = table.hashpower();
+    std::size_t capacity = table.capacity();
+    std::size_t constructs = counters.constructs;
+    std::size_t load_factor_bin = std::min<std::size_t>(CUCKOO_COUNTERS_LOAD_FACTOR_BINS - 1,
+        counters.inserts * CUCKOO_COUNTERS_LOAD_FACTOR_BINS / std::max<std::size_t>(1, capacity));   // the table holds counters.inserts elements
+    bool is_inserted = false;
+    try {
+        is_inserted = insert();
+    }
+    catch (...) {
+        ++counters.failed_inserts;
+        throw;
+    }
+    std::size_t placed = counters.constructs - constructs;
+    if (table.hashpower() != hash_power) {
+        ++counters.resizes;
+        counters.rehashed_elements += placed - std::min<std::size_t>(placed, 1);
+    }
+    if (!is_inserted) {
+        ++counters.failed_inserts;
+        return false;
+    }
+    ++counters.inserts;
+    ++counters.inserts_by_load_factor[load_factor_bin];
+    if (table.hashpower() == hash_power) {
+        std::size_t path_length = placed - std::min<std::size_t>(placed, 1);
+        counters.displacements += path_length;
+        counters.displacements_by_load_factor[load_factor_bin] += path_length;
+        counters.max_path_length = std::max(counters.max_path_length, path_length);
+        ++counters.path_lengths[std::min<std::size_t>(path_length, CUCKOO_COUNTERS_MAX_PATH_LENGTH)];
+    }
+    return true;
+}
+
+#endif // _CUCKOO_COUNTERS_H
@@ -0,0 +1,320 @@
+#ifndef _CUCKOO_FILTER_TABLE_H
+#define _CUCKOO_FILTER_TABLE_H
+
+#include "CustomHash.h"
+#include "ExactMatches.h"
+#include "WindowScanner.h"
+#include "FrozenCuckooTable.h"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#define CUCKOO_FILTER_SLOTS_PER_BUCKET 4
+#define CUCKOO_FILTER_TARGET_LOAD_FACTOR 0.95           // initial sizing (the table doubles if the keys do not fit)
+#define CUCKOO_FILTER_MAX_KICKS 500                     // evictions per insertion before the table is rebuilt larger
+#define CUCKOO_FILTER_ALT_INDEX_MULTIPLIER 0xc6a4a7935bd1e995  // same as libcuckoo's alt_index
+#define CUCKOO_FILTER_FINGERPRINT_MULTIPLIER 0x9e3779b97f4a7c15 // odd, remixes the hash so the fingerprint is not the bucket's bits
+#define CUCKOO_FILTER_EVICTION_SEED 0x2545f4914f6cdd1d
+#define CUCKOO_FILTER_NO_SOURCE 0xffffffff
+
+/*
+A fingerprint-only cuckoo table (cuckoo filter layout, Fan et al., "Cuckoo Filter: Practically Better Than Bloom"):
+the hot array holds only a short fingerprint (8, 12 or 16 bits) per slot instead of the full key, in 4-way buckets packed
+back to back (4, 6 or 8 Bytes per bucket), with partial-key cuckoo hashing (bucket 2 = bucket 1 ^ f(fingerprint)) as in
+FrozenCuckooTable.
+A fingerprint match is only a candidate: the verification stage reads the slot's source - the offset of one occurrence of the
+key in the ruleset's pattern bytes (RulesetView::pattern_bytes) - and compares the L bytes there to the looked up window, so
+the lookups are exact and the values (rule list references) of false candidates are never returned. The sources and values
+are a cold array indexed by slot, read only on a fingerprint match (~8 / 2^bits of the misses).
+*/
+
+
+/// <summary>
+/// The source of each key: the offset, in the ruleset's pattern bytes, of its first occurrence as a window of L bytes
+/// (every G bytes) of an exact match - the windows parseExactMatches extracts the substrings from.
+/// </summary>
+/// <returns>sources[i] = the offset of keys[i] (CUCKOO_FILTER_NO_SOURCE if it is not a window of the ruleset)</returns>
+template<typename K, std::size_t L, std::size_t G>
+std::vector<uint32_t> findSubstringSources(const RulesetView& exact_matches, const std::vector<K>& keys) {
+	std::unordered_map<K, uint32_t, CustomHash> first_offsets;
+	first_offsets.reserve(keys.size());
+	for (std::size_t i = 0; i < exact_matches.size(); ++i) {
+		Span<uint8_t> exact_match = exact_matches.getExactMatch(i);
+		uint32_t pattern_offset = exact_matches.pattern_offsets[i];
+		const uint8_t* end = exact_match.data() + exact_match.size();
+		for (std::size_t j = 0; j + L <= exact_match.size(); j += G) {
+			K key = static_cast<K>(loadWindow<L>(exact_match.data() + j, end, false));
+			first_offsets.emplace(key, static_cast<uint32_t>(pattern_offset + j));
+		}
+	}
+	std::vector<uint32_t> sources(keys.size(), CUCKOO_FILTER_NO_SOURCE);
+	for (std::size_t i = 0; i < keys.size(); ++i) {
+		auto it = first_offsets.find(keys[i]);
+		if (it != first_offsets.end()) {
+			sources[i] = it->second;
+		}
+	}
+	return sources;
+}
+
+
+/// <summary>
+/// A read-only cuckoo table of fingerprints, with exact lookups through a verification stage on the ruleset's pattern bytes.
+/// Lookup interface as FrozenCuckooTable's (and libcuckoo::cuckoohash_map's).
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="V">Type of the value</typeparam>
+/// <typeparam name="L">Length of the substrings (the bytes compared by the verification stage)</typeparam>
+/// <typeparam name="FingerprintBits">Bits of a fingerprint {8, 12, 16}</typeparam>
+/// <typeparam name="H">The hasher of the keys</typeparam>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits = 12, typename H = CustomHash>
+class CuckooFilterTable {
+	static_assert(FingerprintBits == 8 || FingerprintBits == 12 || FingerprintBits == 16, "Fingerprints are 8, 12 or 16 bits");
+	static_assert(L <= sizeof(K), "The key type is too small for substrings of L bytes (see SubstringKey<L>)");
+
+public:
+	static constexpr std::size_t BUCKET_BYTES = CUCKOO_FILTER_SLOTS_PER_BUCKET * FingerprintBits / 8;
+	static constexpr uint64_t FINGERPRINT_MASK = (uint64_t(1) << FingerprintBits) - 1;
+
+	CuckooFilterTable() : pattern_bytes(nullptr), pattern_bytes_end(nullptr), mask(0), num_of_elements(0) {}
+
+	void build(const std::vector<K>& keys, const std::vector<uint32_t>& sources, const std::vector<V>& values,
+			   const RulesetView& exact_matches);
+
+	bool find(const K& key, V& value) const { return find(key, H()(key), value); }
+	bool find(const K& key, std::size_t hash, V& value) const;
+	bool contains(const K& key) const { return contains(key, H()(key)); }
+	bool contains(const K& key, std::size_t hash) const { V value; return find(key, hash, value); }
+	bool mayContain(const K& key) const { return mayContain(key, H()(key)); }
+	bool mayContain(const K& key, std::size_t hash) const;
+	void find_batch(const K* keys, const std::size_t* hashes, std::size_t n, V* values, uint8_t* found) const;
+
+	std::size_t size() const { return num_of_elements; }
+	std::size_t bucket_count() const { return mask + (fingerprints.empty() ? 0 : 1); }
+	std::size_t capacity() const { return bucket_count() * CUCKOO_FILTER_SLOTS_PER_BUCKET; }
+	double load_factor() const { return capacity() ? double(num_of_elements) / capacity() : 0; }
+	static constexpr std::size_t slot_per_bucket() { return CUCKOO_FILTER_SLOTS_PER_BUCKET; }
+	static constexpr std::size_t fingerprint_bits() { return FingerprintBits; }
+	std::size_t filterBytes() const { return bucket_count() * BUCKET_BYTES; }		// the fingerprints (the hot array)
+	std::size_t verificationBytes() const { return sources.size() * sizeof(uint32_t) + values.size() * sizeof(V); }
+	std::size_t memoryBytes() const { return filterBytes() + verificationBytes(); }
+	double bitsPerKey() const { return num_of_elements ? 8.0 * filterBytes() / num_of_elements : 0; }
+
+	static uint64_t fingerprintOf(std::size_t hash) {
+		uint64_t fingerprint = (static_cast<uint64_t>(hash) * CUCKOO_FILTER_FINGERPRINT_MULTIPLIER) >> (64 - FingerprintBits);
+		return (fingerprint == 0) ? 1 : fingerprint;		// 0 marks an empty slot
+	}
+	std::size_t primaryBucket(std::size_t hash) const { return hash & mask; }
+	std::size_t alternateBucket(std::size_t bucket, uint64_t fingerprint) const {
+		return (bucket ^ ((static_cast<std::size_t>(fingerprint) + 1) * static_cast<std::size_t>(CUCKOO_FILTER_ALT_INDEX_MULTIPLIER))) & mask;
+	}
+
+private:
+	/// <summary>
+	/// The fingerprints of a bucket, slot i in bits [i * FingerprintBits, (i + 1) * FingerprintBits). A single unaligned 8 Bytes
+	/// load: the array is padded, and the bytes of the next bucket (6 Bytes buckets) are masked out.
+	/// </summary>
+	uint64_t loadBucket(std::size_t bucket) const {
+		uint64_t word;
+		std::memcpy(&word, fingerprints.data() + bucket * BUCKET_BYTES, sizeof(word));
+		if constexpr (BUCKET_BYTES < sizeof(uint64_t)) {
+			word &= (uint64_t(1) << (8 * BUCKET_BYTES)) - 1;
+		}
+		return word;
+	}
+	void storeFingerprint(std::size_t bucket, std::size_t slot, uint64_t fingerprint) {
+		uint8_t* pos = fingerprints.data() + bucket * BUCKET_BYTES;
+		uint64_t word;
+		std::memcpy(&word, pos, sizeof(word));
+		word &= ~(FINGERPRINT_MASK << (slot * FingerprintBits));
+		word |= fingerprint << (slot * FingerprintBits);
+		std::memcpy(pos, &word, sizeof(word));
+	}
+	/// <summary>
+	/// Bitmask of the slots of the bucket whose fingerprint equals the given fingerprint (bit i = slot i).
+	/// </summary>
+	uint32_t matchFingerprints(std::size_t bucket, uint64_t fingerprint) const {
+		uint64_t word = loadBucket(bucket);
+		uint32_t matches = 0;
+		for (std::size_t slot = 0; slot < CUCKOO_FILTER_SLOTS_PER_BUCKET; ++slot) {
+			matches |= static_cast<uint32_t>(((word >> (slot * FingerprintBits)) & FINGERPRINT_MASK) == fingerprint) << slot;
+		}
+		return matches;
+	}
+	bool verify(std::size_t position, const K& key) const {
+		const uint8_t* source = pattern_bytes + sources[position];
+		return static_cast<K>(loadWindow<L>(source, pattern_bytes_end, false)) == key;
+	}
+	bool findInBucket(std::size_t bucket, uint64_t fingerprint, const K& key, std::size_t* position) const;
+	bool insert(uint64_t fingerprint, std::size_t bucket, uint32_t source, V value, uint64_t& random_state);
+
+	std::vector<uint8_t> fingerprints;	// bucket_count() * BUCKET_BYTES, + padding for the 8 Bytes loads
+	std::vector<uint32_t> sources;		// sources[bucket * CUCKOO_FILTER_SLOTS_PER_BUCKET + slot], offsets in pattern_bytes
+	std::vector<V> values;				// values[bucket * CUCKOO_FILTER_SLOTS_PER_BUCKET + slot]
+	const uint8_t* pattern_bytes;		// the ruleset's pattern bytes (not owned), read by the verification stage
+	const uint8_t* pattern_bytes_end;
+	std::size_t mask;
+	std::size_t num_of_elements;
+};
+
+
+/// <summary>
+/// Build the table from (unique) keys, their sources (see findSubstringSources) and their values. The ruleset must outlive the
+/// table. The number of buckets is the smallest power of 2 holding the keys at CUCKOO_FILTER_TARGET_LOAD_FACTOR; it is doubled
+/// until all the keys are placed.
+/// </summary>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+void CuckooFilterTable<K, V, L, FingerprintBits, H>::build(const std::vector<K>& keys, const std::vector<uint32_t>& sources,
+														   const std::vector<V>& values, const RulesetView& exact_matches) {
+	for (uint32_t source : sources) {
+		if (source == CUCKOO_FILTER_NO_SOURCE) {
+			throw std::invalid_argument("A key of the cuckoo filter table has no source in the ruleset to be verified against.");
+		}
+	}
+	pattern_bytes = exact_matches.pattern_bytes;
+	pattern_bytes_end = exact_matches.pattern_bytes + exact_matches.pattern_offsets[exact_matches.size()];
+
+	std::size_t num_of_buckets = 1;
+	while (num_of_buckets * CUCKOO_FILTER_SLOTS_PER_BUCKET * CUCKOO_FILTER_TARGET_LOAD_FACTOR < keys.size()) {
+		num_of_buckets <<= 1;
+	}
+	for (;;) {
+		fingerprints.assign(num_of_buckets * BUCKET_BYTES + sizeof(uint64_t), 0);
+		this->sources.assign(num_of_buckets * CUCKOO_FILTER_SLOTS_PER_BUCKET, CUCKOO_FILTER_NO_SOURCE);
+		this->values.assign(num_of_buckets * CUCKOO_FILTER_SLOTS_PER_BUCKET, V());
+		mask = num_of_buckets - 1;
+		num_of_elements = 0;
+		uint64_t random_state = CUCKOO_FILTER_EVICTION_SEED;
+		std::size_t i = 0;
+		for (; i < keys.size(); ++i) {
+			std::size_t hash = H()(keys[i]);
+			if (!insert(fingerprintOf(hash), primaryBucket(hash), sources[i], values[i], random_state)) {
+				break;
+			}
+		}
+		if (i == keys.size()) {
+			return;
+		}
+		num_of_buckets <<= 1;		// an insertion failed (and evicted an entry): rebuild everything in a larger table
+	}
+}
+
+/// <summary>
+/// Place a fingerprint (and its source and value) in one of its 2 buckets, evicting entries to their alternate buckets (random
+/// walk) if both are full. The keys are not needed: the alternate bucket of an entry is known from its fingerprint alone.
+/// </summary>
+/// <returns>false if no place was found within CUCKOO_FILTER_MAX_KICKS evictions (the last evicted entry is then lost)</returns>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+bool CuckooFilterTable<K, V, L, FingerprintBits, H>::insert(uint64_t fingerprint, std::size_t bucket, uint32_t source, V value,
+															uint64_t& random_state) {
+	for (std::size_t kick = 0; kick <= CUCKOO_FILTER_MAX_KICKS; ++kick) {
+		std::size_t buckets[2] = { bucket, alternateBucket(bucket, fingerprint) };
+		for (std::size_t candidate : buckets) {
+			uint32_t empty_slots = matchFingerprints(candidate, 0);
+			if (empty_slots != 0) {
+				std::size_t slot = lowestSetBit(empty_slots);
+				std::size_t position = candidate * CUCKOO_FILTER_SLOTS_PER_BUCKET + slot;
+				storeFingerprint(candidate, slot, fingerprint);
+				sources[position] = source;
+				values[position] = value;
+				++num_of_elements;
+				return true;
+			}
+		}
+		// Both buckets are full: evict a random entry of one of them, and place it in its alternate bucket next
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 7;
+		random_state ^= random_state << 17;
+		bucket = buckets[random_state & 1];
+		std::size_t slot = (random_state >> 1) % CUCKOO_FILTER_SLOTS_PER_BUCKET;
+		std::size_t position = bucket * CUCKOO_FILTER_SLOTS_PER_BUCKET + slot;
+		uint64_t evicted_fingerprint = (loadBucket(bucket) >> (slot * FingerprintBits)) & FINGERPRINT_MASK;
+		storeFingerprint(bucket, slot, fingerprint);
+		fingerprint = evicted_fingerprint;
+		std::swap(source, sources[position]);
+		std::swap(value, values[position]);
+		bucket = alternateBucket(bucket, fingerprint);
+	}
+	return false;
+}
+
+/// <summary>
+/// The verification stage: every slot of the bucket with the key's fingerprint is a candidate, confirmed by comparing the key
+/// to the bytes of its source.
+/// </summary>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+bool CuckooFilterTable<K, V, L, FingerprintBits, H>::findInBucket(std::size_t bucket, uint64_t fingerprint, const K& key,
+																  std::size_t* position) const {
+	uint32_t matches = matchFingerprints(bucket, fingerprint);
+	while (matches != 0) {
+		std::size_t candidate = bucket * CUCKOO_FILTER_SLOTS_PER_BUCKET + lowestSetBit(matches);
+		if (verify(candidate, key)) {
+			*position = candidate;
+			return true;
+		}
+		matches &= matches - 1;
+	}
+	return false;
+}
+
+/// <summary>
+/// Look up a key whose hash (H's) is already known: a fingerprint match, confirmed by the verification stage.
+/// </summary>
+/// <returns>true if the key is in the table (its value is stored into value)</returns>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+bool CuckooFilterTable<K, V, L, FingerprintBits, H>::find(const K& key, std::size_t hash, V& value) const {
+	if (fingerprints.empty()) {
+		return false;
+	}
+	uint64_t fingerprint = fingerprintOf(hash);
+	std::size_t bucket = primaryBucket(hash);
+	std::size_t position = 0;
+	if (!findInBucket(bucket, fingerprint, key, &position)
+		&& !findInBucket(alternateBucket(bucket, fingerprint), fingerprint, key, &position)) {
+		return false;
+	}
+	value = values[position];
+	return true;
+}
+
+/// <summary>
+/// The filter alone (no verification stage): false if the key is not in the table, true if it is or on a false positive.
+/// </summary>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+bool CuckooFilterTable<K, V, L, FingerprintBits, H>::mayContain(const K& key, std::size_t hash) const {
+	(void)key;
+	if (fingerprints.empty()) {
+		return false;
+	}
+	uint64_t fingerprint = fingerprintOf(hash);
+	std::size_t bucket = primaryBucket(hash);
+	return matchFingerprints(bucket, fingerprint) != 0 || matchFingerprints(alternateBucket(bucket, fingerprint), fingerprint) != 0;
+}
+
+/// <summary>
+/// Look up n keys whose hashes (H's) are already known, and get their values.
+/// </summary>
+/// <param name="values">values[i] = the value of keys[i], if found (unchanged otherwise)</param>
+/// <param name="found">found[i] = 1 if keys[i] is in the table, 0 otherwise</param>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+void CuckooFilterTable<K, V, L, FingerprintBits, H>::find_batch(const K* keys, const std::size_t* hashes, std::size_t n, V* values,
+																uint8_t* found) const {
+	for (std::size_t i = 0; i < n; ++i) {
+		found[i] = find(keys[i], hashes[i], values[i]);
+	}
+}
+
+/// <summary>
+/// Batched lookup of n keys and their (H's) hashes in a CuckooFilterTable (see findBatch in FrozenCuckooTable.h).
+/// </summary>
+template<typename K, typename V, std::size_t L, std::size_t FingerprintBits, typename H>
+void findBatch(const CuckooFilterTable<K, V, L, FingerprintBits, H>& table, const K* keys, const std::size_t* hashes, std::size_t n,
+			   V* values, uint8_t* found) {
+	table.find_batch(keys, hashes, n, values, found);
+}
+
+#endif // _CUCKOO_FILTER_TABLE_H
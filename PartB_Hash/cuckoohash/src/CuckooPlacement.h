@@ -0,0 +1,177 @@
+#ifndef _CUCKOO_PLACEMENT_H
+#define _CUCKOO_PLACEMENT_H
+
+#include "CustomHash.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#define CUCKOO_PLACEMENT_SLOTS_PER_BUCKET 4         // as libcuckoo's default layout
+#define CUCKOO_PLACEMENT_NO_BUCKET 0xffffffff
+#define CUCKOO_PLACEMENT_ALT_INDEX_MULTIPLIER 0xc6a4a7935bd1e995    // same as libcuckoo's alt_index
+
+/*
+Offline placement of a static set of keys in a bucketized cuckoo table (2 candidate buckets per key, S slots per bucket).
+Placing keys is a bipartite b-matching of the keys to the buckets (capacity S); a key is inserted with an augmenting path:
+a breadth-first search over the buckets, from its 2 buckets, where an edge moves a resident key to its other bucket, up to
+the first bucket with a free slot - then the keys along the path are shifted by one. Unlike libcuckoo's insertion (a bounded
+search, then a resize or a failure), this finds a path whenever one exists:
+    > the keys placed, in the order given, are a maximum matching: a key is rejected only if no rearrangement of the keys
+      already placed makes room for it, and the insertions carry on with the next keys (all the keys fit up to the ~97.7% load
+      threshold of 2-choice 4-way buckets; given more keys, ~99% of the slots are filled);
+    > the sets of keys which can be placed together are a transversal matroid, so inserting the keys by decreasing priority
+      places the best set the table can hold (e.g. most rules first).
+The buckets a failed search visited are closed (every move from them stays in them) and full, and stay so (a static table
+only gets keys): they are marked saturated, and later searches skip them, so the rejections past the capacity are cheap.
+The 2 buckets of a key are libcuckoo's: the primary one from the low bits of the hash, the alternate one the primary xor a
+multiple of the 8 bits partial key (the hash folded to a byte), so the hashers of 16 and 32 bits (CustomHash of uint16_t,
+uint32_t keys) get 2 choices as well, and the tables compared with runTests have the same buckets.
+The table is looked up like libcuckoo's (find / contains), with the keys and values in separate arrays.
+*/
+
+
+/// <summary>
+/// A static cuckoo table whose keys are placed offline (see above).
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+/// <typeparam name="V">Type of the value</typeparam>
+/// <typeparam name="S">Slots per bucket</typeparam>
+/// <typeparam name="H">The hasher of the keys</typeparam>
+template<typename K, typename V, std::size_t S = CUCKOO_PLACEMENT_SLOTS_PER_BUCKET, typename H = CustomHash>
+class PlacedCuckooTable {
+public:
+    explicit PlacedCuckooTable(std::size_t hash_power) : mask((std::size_t(1) << hash_power) - 1), num_of_elements(0),
+        slot_keys((mask + 1) * S), slot_values((mask + 1) * S), bucket_sizes(mask + 1, 0), saturated(mask + 1, 0),
+        visited(mask + 1, 0), parent_buckets(mask + 1), parent_slots(mask + 1), epoch(0) {}
+
+    bool insert(const K& key, const V& value);
+
+    bool find(const K& key, V& value) const {
+        std::size_t hash = H()(key);
+        std::size_t bucket = primaryBucket(hash);
+        for (std::size_t pass = 0; pass < 2; ++pass) {
+            for (std::size_t slot = 0; slot < bucket_sizes[bucket]; ++slot) {
+                if (slot_keys[bucket * S + slot] == key) {
+                    value = slot_values[bucket * S + slot];
+                    return true;
+                }
+            }
+            bucket = alternateBucket(bucket, hash);
+        }
+        return false;
+    }
+    bool contains(const K& key) const {
+        V value;
+        return find(key, value);
+    }
+
+    std::size_t size() const { return num_of_elements; }
+    std::size_t bucket_count() const { return mask + 1; }
+    std::size_t capacity() const { return bucket_count() * S; }
+    double load_factor() const { return double(num_of_elements) / capacity(); }
+    static constexpr std::size_t slot_per_bucket() { return S; }
+    std::size_t memoryBytes() const { return capacity() * (sizeof(K) + sizeof(V)) + bucket_count() * sizeof(uint8_t); }
+
+private:
+    /// <summary>
+    /// The hash folded to a byte, as libcuckoo's partial_key.
+    /// </summary>
+    static uint8_t partialKey(std::size_t hash) {
+        uint64_t folded = static_cast<uint64_t>(hash);
+        folded ^= folded >> 32;
+        folded ^= folded >> 16;
+        folded ^= folded >> 8;
+        return static_cast<uint8_t>(folded);
+    }
+    std::size_t primaryBucket(std::size_t hash) const { return hash & mask; }
+    /// <summary>
+    /// The other bucket of a key with this hash, in one of its buckets (as libcuckoo's alt_index: its own inverse).
+    /// </summary>
+    std::size_t alternateBucket(std::size_t bucket, std::size_t hash) const {
+        return (bucket ^ ((static_cast<std::size_t>(partialKey(hash)) + 1) * static_cast<std::size_t>(CUCKOO_PLACEMENT_ALT_INDEX_MULTIPLIER))) & mask;
+    }
+    std::size_t otherBucket(const K& key, std::size_t bucket) const {
+        return alternateBucket(bucket, H()(key));
+    }
+
+    std::size_t mask;
+    std::size_t num_of_elements;
+    std::vector<K> slot_keys;               // slot_keys[bucket * S + slot], the first bucket_sizes[bucket] slots of a bucket are used
+    std::vector<V> slot_values;
+    std::vector<uint8_t> bucket_sizes;
+    // The state of the searches (build only)
+    std::vector<uint8_t> saturated;         // the bucket is in a closed and full set of buckets
+    std::vector<uint32_t> visited;          // the epoch of the last search which visited the bucket
+    std::vector<uint32_t> parent_buckets;   // the bucket whose key moved to the bucket in the search (NO_BUCKET: a bucket of the key)
+    std::vector<uint8_t> parent_slots;      // ...and its slot
+    std::vector<std::size_t> queue;         // the buckets of the search, in the order they were visited
+    uint32_t epoch;
+};
+
+
+/// <summary>
+/// Insert a key, moving the keys placed along an augmenting path if both its buckets are full (see above).
+/// </summary>
+/// <returns>false if the key is already in the table, or the table can not hold it with the keys it holds (it is unchanged)</returns>
+template<typename K, typename V, std::size_t S, typename H>
+bool PlacedCuckooTable<K, V, S, H>::insert(const K& key, const V& value) {
+    std::size_t hash = H()(key);
+    std::size_t roots[2] = { primaryBucket(hash), alternateBucket(primaryBucket(hash), hash) };
+    if (contains(key) || (saturated[roots[0]] && saturated[roots[1]])) {
+        return false;
+    }
+
+    // Breadth-first search from the 2 buckets of the key, up to a bucket with a free slot
+    ++epoch;
+    queue.clear();
+    for (std::size_t root : roots) {
+        if (visited[root] != epoch && !saturated[root]) {
+            visited[root] = epoch;
+            parent_buckets[root] = CUCKOO_PLACEMENT_NO_BUCKET;
+            queue.push_back(root);
+        }
+    }
+    std::size_t free_bucket = CUCKOO_PLACEMENT_NO_BUCKET;
+    for (std::size_t head = 0; head < queue.size() && free_bucket == CUCKOO_PLACEMENT_NO_BUCKET; ++head) {
+        std::size_t bucket = queue[head];
+        if (bucket_sizes[bucket] < S) {
+            free_bucket = bucket;
+            break;
+        }
+        for (std::size_t slot = 0; slot < S; ++slot) {
+            std::size_t next = otherBucket(slot_keys[bucket * S + slot], bucket);
+            if (visited[next] == epoch || saturated[next]) {
+                continue;
+            }
+            visited[next] = epoch;
+            parent_buckets[next] = static_cast<uint32_t>(bucket);
+            parent_slots[next] = static_cast<uint8_t>(slot);
+            queue.push_back(next);
+        }
+    }
+    if (free_bucket == CUCKOO_PLACEMENT_NO_BUCKET) {
+        for (std::size_t bucket : queue) {
+            saturated[bucket] = 1;
+        }
+        return false;
+    }
+
+    // Shift the keys along the path: each one moves to the (free) slot its successor left, the key takes the root's slot
+    std::size_t bucket = free_bucket;
+    std::size_t slot = bucket_sizes[bucket]++;
+    while (parent_buckets[bucket] != CUCKOO_PLACEMENT_NO_BUCKET) {
+        std::size_t parent = parent_buckets[bucket];
+        std::size_t parent_slot = parent_slots[bucket];
+        slot_keys[bucket * S + slot] = slot_keys[parent * S + parent_slot];
+        slot_values[bucket * S + slot] = slot_values[parent * S + parent_slot];
+        bucket = parent;
+        slot = parent_slot;
+    }
+    slot_keys[bucket * S + slot] = key;
+    slot_values[bucket * S + slot] = value;
+    ++num_of_elements;
+    return true;
+}
+
+#endif // _CUCKOO_PLACEMENT_H
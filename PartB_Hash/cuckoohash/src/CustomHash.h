@@ -2,6 +2,14 @@
 #define _CUSTOM_HASH_H
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
+#include "SubstringKey.h"
+
+#if defined __GNUC__ && defined __x86_64__
+#include <nmmintrin.h>
+#define CRC32C_HAS_SSE42_DISPATCH       // _mm_crc32_u64 is compiled for SSE4.2 only, and used if the CPU supports it
+#endif
 
 #define MURMURHASH3_ROUND_SHIFT_UINT64_T 47
 #define MURMURHASH3_FIRST_ROUND_SHIFT_UINT32_T 15
@@ -18,6 +26,19 @@
 #define HASH_SEED_UINT32_T 0x9e3779b1               // prime!
 #define HASH_SEED_UINT16_T 0x1f49                   // prime!
 
+// Alternate hashers (see the hash family below):
+#define WYHASH_P0_UINT64_T 0xa0761d6478bd642f
+#define WYHASH_P1_UINT64_T 0xe7037ed1a0b428db
+#define XXH3_RRMXMX_MULTIPLIER_UINT64_T 0x9fb21c651e98df25
+#define XXH3_BITFLIP_UINT64_T 0xc73ab174c5ecd5a2    // bytes 8-15 ^ bytes 16-23 of XXH3's default secret (seed = 0)
+#define MULTIPLY_SHIFT_A_UINT64_T 0x9e3779b97f4a7c15 // odd
+#define MULTIPLY_SHIFT_B_UINT64_T 0xd6e8feb86659fd93
+#define CRC32C_POLYNOMIAL_UINT32_T 0x82f63b78       // Castagnoli, reflected
+#define CRC32C_SEED_LOW_UINT32_T 0x9e3779b1
+#define CRC32C_SEED_HIGH_UINT32_T 0x85ebca6b
+#define FMIX64_MULTIPLIER_1_UINT64_T 0xff51afd7ed558ccd  // MurmurHash3's 64 bits finalizer (fmix64)
+#define FMIX64_MULTIPLIER_2_UINT64_T 0xc4ceb9fe1a85ec53
+
 /* 
 The original MurmurHash3 algorithm, as proposed by Austin Appleby, 
     involves multiple mixing rounds to achieve a good avalanche effect
@@ -28,6 +49,29 @@ The original MurmurHash3 algorithm, as proposed by Austin Appleby,
 
 
 struct CustomHash {
+#if SUBSTRING_MAX_LENGTH > 8
+    // OVERLOADING for UINT128_T (substrings of 9 to 16 bytes):
+    // both 64 bits halves are mixed as blocks of MurmurHash64A, followed by its finalization rounds.
+    std::size_t operator()(const uint128_t key) const {
+        constexpr uint64_t mult = MURMURHASH3_MULTIPLIER_UINT64_T;
+        constexpr uint64_t seed = HASH_SEED_UINT64_T;
+        const uint64_t blocks[2] = { static_cast<uint64_t>(key >> 64), static_cast<uint64_t>(key) };
+        uint64_t hash = seed ^ (sizeof(blocks) * mult);
+        for (uint64_t block : blocks) {
+            block *= mult;
+            block ^= (block >> MURMURHASH3_ROUND_SHIFT_UINT64_T);
+            block *= mult;
+            hash ^= block;
+            hash *= mult;
+        }
+        hash ^= (hash >> MURMURHASH3_ROUND_SHIFT_UINT64_T);
+        hash *= mult;
+        hash ^= (hash >> MURMURHASH3_ROUND_SHIFT_UINT64_T);
+
+        return static_cast<std::size_t>(hash);
+    }
+#endif
+
     // OVERLOADING for UINT64_T:
     std::size_t operator()(const uint64_t key) const {
         constexpr uint64_t mult = MURMURHASH3_MULTIPLIER_UINT64_T;
@@ -57,13 +101,14 @@ struct CustomHash {
 
 
     // OVERLOADING for UINT16_T:
+    // the products are computed in uint32_t and truncated to 16 bits (uint16_t operands are promoted to int, which overflows).
     std::size_t operator()(const uint16_t key) const {
-        constexpr uint16_t mult = MURMURHASH3_MULTIPLIER_UINT16_T;
-        constexpr uint16_t seed = HASH_SEED_UINT16_T;
-        uint16_t hash = seed ^ (key * mult);
-        hash ^= (hash >> MURMURHASH3_FIRST_ROUND_SHIFT_UINT16_T);
-        hash *= mult;
+        constexpr uint32_t mult = MURMURHASH3_MULTIPLIER_UINT16_T;
+        constexpr uint32_t seed = HASH_SEED_UINT16_T;
+        uint32_t hash = (seed ^ (static_cast<uint32_t>(key) * mult)) & 0xffff;
         hash ^= (hash >> MURMURHASH3_FIRST_ROUND_SHIFT_UINT16_T);
+        hash = (hash * mult) & 0xffff;
+        hash ^= (hash >> MURMURHASH3_SECOND_ROUND_SHIFT_UINT16_T);
         // third round if needed
         //hash *= mult;
         //hash ^= (hash >> 8);
@@ -73,4 +118,144 @@ struct CustomHash {
 };
 
 
+/*
+Hash family: alternate hashers, which can be used as the H template argument (instead of CustomHash) of the tests and of libcuckoo.
+Each one is a 64 bits mixer, applied to the key zero extended to 64 bits; a 128 bits key is hashed as mix(low ^ mix(high)).
+    WyHash            - wyhash's 64 bits hash (128 bits multiply, folded)
+    Xxh3Hash          - XXH3's hash of 4-8 bytes inputs (rrmxmx avalanche)
+    MultiplyShiftHash - multiply-add-shift (the upper 64 bits of a * key + b); the cheapest, weakest mixer
+    Crc32cHash        - 2 CRC32C's of the key (SSE4.2 crc32 instruction, or a lookup table if the CPU lacks it), finalized by
+                        MurmurHash3's fmix64: a CRC is affine in the key, so the xor of the 2 halves alone is the same for every
+                        key (and so is the partial key libcuckoo folds the hash to, see the "hashes" bench)
+*/
+
+/// <summary>
+/// The 128 bits product of 2 64 bits values.
+/// </summary>
+/// <returns>The upper 64 bits of the product (the lower 64 bits are stored into low)</returns>
+inline uint64_t multiply128(uint64_t a, uint64_t b, uint64_t* low) {
+#if SUBSTRING_MAX_LENGTH > 8
+    uint128_t product = static_cast<uint128_t>(a) * b;
+    *low = static_cast<uint64_t>(product);
+    return static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t a_low = a & 0xffffffff, a_high = a >> 32;
+    uint64_t b_low = b & 0xffffffff, b_high = b >> 32;
+    uint64_t low_low = a_low * b_low, low_high = a_low * b_high, high_low = a_high * b_low, high_high = a_high * b_high;
+    uint64_t middle = (low_low >> 32) + (low_high & 0xffffffff) + (high_low & 0xffffffff);
+    *low = (middle << 32) | (low_low & 0xffffffff);
+    return high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+#endif
+}
+
+inline uint64_t rotateLeft64(uint64_t value, unsigned int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+/// <summary>
+/// Adapts a 64 bits mixer (Mixer::mix) to the substring key types {uint16_t, uint32_t, uint64_t, uint128_t}.
+/// </summary>
+template<typename Mixer>
+struct MixerHash {
+    template<typename K>
+    std::size_t operator()(const K key) const {
+        if constexpr (sizeof(K) > sizeof(uint64_t)) {
+            return static_cast<std::size_t>(Mixer::mix(static_cast<uint64_t>(key) ^ Mixer::mix(static_cast<uint64_t>(key >> 64))));
+        }
+        else {
+            return static_cast<std::size_t>(Mixer::mix(static_cast<uint64_t>(key)));
+        }
+    }
+};
+
+struct WyMixer {
+    static uint64_t mix(uint64_t key) {
+        uint64_t low;
+        uint64_t high = multiply128(key ^ WYHASH_P0_UINT64_T, HASH_SEED_UINT64_T ^ WYHASH_P1_UINT64_T, &low);
+        high = multiply128(low ^ WYHASH_P0_UINT64_T, high ^ WYHASH_P1_UINT64_T, &low);
+        return high ^ low;
+    }
+};
+
+struct Xxh3Mixer {
+    static uint64_t mix(uint64_t key) {
+        uint64_t hash = key ^ XXH3_BITFLIP_UINT64_T;
+        hash ^= rotateLeft64(hash, 49) ^ rotateLeft64(hash, 24);
+        hash *= XXH3_RRMXMX_MULTIPLIER_UINT64_T;
+        hash ^= (hash >> 35) + sizeof(uint64_t);
+        hash *= XXH3_RRMXMX_MULTIPLIER_UINT64_T;
+        return hash ^ (hash >> 28);
+    }
+};
+
+struct MultiplyShiftMixer {
+    static uint64_t mix(uint64_t key) {
+        uint64_t low;
+        uint64_t high = multiply128(key, MULTIPLY_SHIFT_A_UINT64_T, &low);
+        low += MULTIPLY_SHIFT_B_UINT64_T;
+        return high + (low < MULTIPLY_SHIFT_B_UINT64_T);      // carry of the addition
+    }
+};
+
+/// <summary>
+/// Lookup table of the (reflected) CRC32C of each byte, for CPUs without SSE4.2.
+/// </summary>
+struct Crc32cTable {
+    std::array<uint32_t, 256> table;
+    constexpr Crc32cTable() : table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLYNOMIAL_UINT32_T : (crc >> 1);
+            }
+            table[i] = crc;
+        }
+    }
+};
+constexpr Crc32cTable CRC32C_TABLE;
+
+/// <summary>
+/// CRC32C of 8 bytes (little endian), without the initial and final inversions: the same value as the SSE4.2 crc32 instruction.
+/// </summary>
+inline uint32_t crc32c64Software(uint32_t crc, uint64_t data) {
+    for (int i = 0; i < 8; ++i) {
+        crc = CRC32C_TABLE.table[(crc ^ static_cast<uint32_t>(data)) & 0xff] ^ (crc >> 8);
+        data >>= 8;
+    }
+    return crc;
+}
+
+#if defined CRC32C_HAS_SSE42_DISPATCH
+__attribute__((target("sse4.2"))) inline uint32_t crc32c64Sse42(uint32_t crc, uint64_t data) {
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, data));
+}
+#endif
+
+inline uint32_t crc32c64(uint32_t crc, uint64_t data) {
+#if defined CRC32C_HAS_SSE42_DISPATCH
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42) {
+        return crc32c64Sse42(crc, data);
+    }
+#endif
+    return crc32c64Software(crc, data);
+}
+
+struct Crc32cMixer {
+    static uint64_t mix(uint64_t key) {
+        uint64_t hash = (static_cast<uint64_t>(crc32c64(CRC32C_SEED_HIGH_UINT32_T, key)) << 32) | crc32c64(CRC32C_SEED_LOW_UINT32_T, key);
+        hash ^= hash >> 33;
+        hash *= FMIX64_MULTIPLIER_1_UINT64_T;
+        hash ^= hash >> 33;
+        hash *= FMIX64_MULTIPLIER_2_UINT64_T;
+        return hash ^ (hash >> 33);
+    }
+};
+
+typedef MixerHash<WyMixer> WyHash;
+typedef MixerHash<Xxh3Mixer> Xxh3Hash;
+typedef MixerHash<MultiplyShiftMixer> MultiplyShiftHash;
+typedef MixerHash<Crc32cMixer> Crc32cHash;
+
+
 #endif /* _CUSTOM_HASH_H */
\ No newline at end of file
@@ -1,61 +1,101 @@
 #ifndef _EXACTMATCHES_H
 #define _EXACTMATCHES_H
 
-#include <set>
+#include "Span.h"
+#include "RulePool.h"
+#include <algorithm>
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <iostream>
 
-// ExactMatch class
-class ExactMatch {
-public:
-	ExactMatch() : exact_match("") {};
-	ExactMatch(const ExactMatch& other)
-		: rules_number(other.rules_number), exact_match(other.exact_match) {};
-	ExactMatch(std::set<int> rules_number, std::string exact_match)
-		: rules_number(rules_number), exact_match(exact_match) {};
-	~ExactMatch() = default;
-
-	std::set<int> getRulesNumbers() { return rules_number; }
-	std::string getExactMatch() { return exact_match; }
-	void setExactMatch(const std::string& new_exact_match) { exact_match = new_exact_match; }
-	
-private:
-	std::set<int> rules_number;
-	std::string exact_match;
+/// <summary>
+/// A read-only, zero-copy view of a compiled ruleset (see Ruleset.h).
+/// For every exact match it exposes the decoded pattern bytes and the sorted list of rules (SIDs) it belongs to.
+/// The arrays are owned elsewhere (an ExactMatches store or a memory mapped ruleset file), so the view is cheap to copy and pass around.
+/// </summary>
+struct RulesetView {
+	std::size_t num_patterns = 0;
+	const uint32_t* pattern_offsets = nullptr;		// num_patterns + 1 offsets into pattern_bytes
+	const uint32_t* pattern_rules = nullptr;		// index of the rule list of each pattern
+	const uint32_t* rule_offsets = nullptr;			// num_rule_lists + 1 offsets into rule_ids
+	const uint32_t* rule_ids = nullptr;				// all the rule lists (each one sorted), back to back
+	const uint8_t* pattern_bytes = nullptr;			// all the patterns' bytes, back to back
+
+	std::size_t size() const { return num_patterns; }
+
+	Span<uint8_t> getExactMatch(std::size_t i) const {
+		return Span<uint8_t>(pattern_bytes + pattern_offsets[i], pattern_offsets[i + 1] - pattern_offsets[i]);
+	}
+
+	Span<uint32_t> getRulesNumbers(std::size_t i) const {
+		uint32_t list = pattern_rules[i];
+		return Span<uint32_t>(rule_ids + rule_offsets[list], rule_offsets[list + 1] - rule_offsets[list]);
+	}
 };
 
 
 // ExactMatches class
+/// <summary>
+/// A contiguous (structure of arrays) store of the exact matches: the decoded bytes of all the exact matches live in one arena,
+/// and the rules of each exact match are a handle into a RulePool of interned, sorted rule lists.
+/// Accessors return Spans into the store, so nothing is copied when reading an exact match or its rules.
+/// </summary>
 class ExactMatches {
 public:
-	ExactMatches();
-	~ExactMatches();
-	void insert(const ExactMatch& to_insert);
+	ExactMatches() : pattern_offsets(1, 0) {}
+
+	void insert(const uint8_t* exact_match, std::size_t length, std::vector<uint32_t>& rules_number);
 	void clear();
-	std::vector<ExactMatch*>* exact_matches;
+
+	std::size_t size() const { return pattern_rules.size(); }
+	Span<uint8_t> getExactMatch(std::size_t i) const {
+		return Span<uint8_t>(pattern_bytes.data() + pattern_offsets[i], pattern_offsets[i + 1] - pattern_offsets[i]);
+	}
+	Span<uint32_t> getRulesNumbers(std::size_t i) const { return rules.getRules(pattern_rules[i]); }
+	uint32_t getRulesHandle(std::size_t i) const { return pattern_rules[i]; }
+	const RulePool& getRulePool() const { return rules; }
+	RulesetView view() const;
+
+private:
+	std::vector<uint8_t> pattern_bytes;			// the decoded bytes of all the exact matches, back to back
+	std::vector<uint32_t> pattern_offsets;		// size() + 1 offsets into pattern_bytes
+	std::vector<uint32_t> pattern_rules;		// handle (in rules) of the rule list of each exact match
+	RulePool rules;
 }; 
 
 
-ExactMatches::ExactMatches() {
-	exact_matches = new std::vector<ExactMatch*>();
-}
+/// <summary>
+/// Append an exact match to the store.
+/// </summary>
+/// <param name="exact_match">The decoded bytes of the exact match</param>
+/// <param name="length">The number of bytes in the exact match</param>
+/// <param name="rules_number">The rules (SIDs) of the exact match. Sorted and deduplicated in place.</param>
+void ExactMatches::insert(const uint8_t* exact_match, std::size_t length, std::vector<uint32_t>& rules_number) {
+	std::sort(rules_number.begin(), rules_number.end());
+	rules_number.erase(std::unique(rules_number.begin(), rules_number.end()), rules_number.end());
 
-ExactMatches::~ExactMatches() {
-	clear();
-	delete exact_matches;
+	pattern_bytes.insert(pattern_bytes.end(), exact_match, exact_match + length);
+	pattern_offsets.push_back(static_cast<uint32_t>(pattern_bytes.size()));
+	pattern_rules.push_back(rules.intern(rules_number.data(), rules_number.size()));
 }
 
-void ExactMatches::insert(const ExactMatch& to_insert) {
-	ExactMatch* exact_match = new ExactMatch(to_insert);
-	exact_matches->push_back(exact_match);
+void ExactMatches::clear() {
+	pattern_bytes.clear();
+	pattern_offsets.assign(1, 0);
+	pattern_rules.clear();
+	rules.clear();
 }
 
-
-void ExactMatches::clear() {
-	for (auto it = exact_matches->begin(); it != exact_matches->end(); ++it)
-	{
-		delete* it;
-	}
+RulesetView ExactMatches::view() const {
+	RulesetView ruleset;
+	ruleset.num_patterns = size();
+	ruleset.pattern_offsets = pattern_offsets.data();
+	ruleset.pattern_rules = pattern_rules.data();
+	ruleset.rule_offsets = rules.offsets();
+	ruleset.rule_ids = rules.ids();
+	ruleset.pattern_bytes = pattern_bytes.data();
+	return ruleset;
 }
 
 #endif // _EXACTMATCHES_H
\ No newline at end of file
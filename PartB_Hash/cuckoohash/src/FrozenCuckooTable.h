@@ -0,0 +1,577 @@
+#ifndef _FROZEN_CUCKOO_TABLE_H
+#define _FROZEN_CUCKOO_TABLE_H
+
+#include "CustomHash.h"
+#include "BatchHash.h"
+#include <libcuckoo/cuckoohash_map.hh>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+#if defined __SSE2__ || defined _M_X64
+#include <emmintrin.h>
+#define FROZEN_CUCKOO_HAS_SSE2
+#endif
+
+#define FROZEN_CUCKOO_SLOTS_PER_BUCKET 8
+#define FROZEN_CUCKOO_TARGET_LOAD_FACTOR 0.9            // initial sizing (the table doubles if the keys do not fit)
+#define FROZEN_CUCKOO_MAX_KICKS 512                     // evictions per insertion before the table is rebuilt larger
+#define FROZEN_CUCKOO_ALT_INDEX_MULTIPLIER 0xc6a4a7935bd1e995  // same as libcuckoo's alt_index
+#define FROZEN_CUCKOO_EVICTION_SEED 0x2545f4914f6cdd1d
+#define FROZEN_CUCKOO_BATCH_SIZE 16                     // keys whose buckets are prefetched before the first of them is probed
+#define FROZEN_CUCKOO_BATCHED_SCAN false                // findBatch looks the keys up one at a time (the batched lookups are slower on small or mostly missing tables)
+
+/*
+A read-only ("frozen") cuckoo hash table: built once (from a set of keys, or from the contents of a libcuckoo table),
+then only looked up - without libcuckoo's locks, version counters and generic bucket iteration.
+    > 8-way buckets. The tags of a bucket (8 x 8 or 16 bits fingerprints, 0 = empty slot) are a single 8 / 16 Bytes block,
+      compared to the looked up tag at once (SSE2), so a miss (most windows) reads only the tags of its 2 buckets.
+      The keys of a bucket are a block of 8 keys (a 64 Bytes cache line for 8 Bytes keys), read only on a tag match.
+    > Partial-key cuckoo hashing (as libcuckoo): bucket 1 = hash & mask, bucket 2 = bucket 1 ^ f(tag), so every key is
+      in one of its 2 buckets and the alternate bucket of an entry is known from its tag alone.
+The hash is H's (CustomHash by default), so the batched hashes of the scan (BatchHash.h) can be passed to the lookups.
+The batched lookups (contains_batch / find_batch) compute the buckets of FROZEN_CUCKOO_BATCH_SIZE keys and prefetch their tags
+before probing the first one, then prefetch the keys of the buckets whose tags matched before comparing any key, so the cache
+misses of a group overlap instead of stalling each lookup in turn.
+The lookups read the buckets through plain pointers: to the table's own arrays once built, or to arrays it does not own
+(attach(), e.g. the sections of a snapshot file mapped read-only, see TableSnapshot.h).
+*/
+
+
+/// <summary>
+/// The index of the lowest set bit (mask != 0).
+/// </summary>
+inline unsigned int lowestSetBit(uint32_t mask) {
+#if defined __GNUC__
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#else
+    unsigned int index = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+
+/// <summary>
+/// A read-only, bucketized (8-way) cuckoo hash table with SIMD tag probing. Lookup interface as libcuckoo::cuckoohash_map's.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+/// <typeparam name="V">Type of the value</typeparam>
+/// <typeparam name="Tag">Type of the fingerprint tags {uint8_t, uint16_t}</typeparam>
+/// <typeparam name="H">The hasher of the keys</typeparam>
+template<typename K, typename V, typename Tag = uint16_t, typename H = CustomHash>
+class FrozenCuckooTable {
+    static_assert(std::is_same<Tag, uint8_t>::value || std::is_same<Tag, uint16_t>::value, "Tags are 8 or 16 bits");
+
+public:
+    FrozenCuckooTable() : bucket_tags(nullptr), bucket_keys(nullptr), slot_values(nullptr), num_of_buckets(0), mask(0), num_of_elements(0) {}
+    FrozenCuckooTable(const std::vector<K>& keys, const std::vector<V>& values) : FrozenCuckooTable() { build(keys, values); }
+    template<typename H2, typename E, typename A, std::size_t S>
+    explicit FrozenCuckooTable(libcuckoo::cuckoohash_map<K, V, H2, E, A, S>& table);
+    FrozenCuckooTable(const FrozenCuckooTable& other) : FrozenCuckooTable() { *this = other; }
+    FrozenCuckooTable(FrozenCuckooTable&&) = default;      // the arrays keep their storage: the pointers stay valid
+    FrozenCuckooTable& operator=(const FrozenCuckooTable& other);
+    FrozenCuckooTable& operator=(FrozenCuckooTable&&) = default;
+
+    void build(const std::vector<K>& keys, const std::vector<V>& values);
+    bool attach(const void* tags, const void* keys, const V* values, std::size_t num_of_buckets, std::size_t num_of_elements);
+
+    bool find(const K& key, V& value) const { return find(key, H()(key), value); }
+    bool find(const K& key, std::size_t hash, V& value) const;
+    V find(const K& key) const;
+    bool contains(const K& key) const { return contains(key, H()(key)); }
+    bool contains(const K& key, std::size_t hash) const;
+    void contains_batch(const K* keys, std::size_t n, uint8_t* results) const;
+    void contains_batch(const K* keys, const std::size_t* hashes, std::size_t n, uint8_t* results) const;
+    void find_batch(const K* keys, std::size_t n, V* values, uint8_t* found) const;
+    void find_batch(const K* keys, const std::size_t* hashes, std::size_t n, V* values, uint8_t* found) const;
+
+    std::size_t size() const { return num_of_elements; }
+    std::size_t bucket_count() const { return num_of_buckets; }
+    std::size_t capacity() const { return bucket_count() * FROZEN_CUCKOO_SLOTS_PER_BUCKET; }
+    double load_factor() const { return capacity() ? double(num_of_elements) / capacity() : 0; }
+    static constexpr std::size_t slot_per_bucket() { return FROZEN_CUCKOO_SLOTS_PER_BUCKET; }
+    std::size_t memoryBytes() const { return tagBytes() + keyBytes() + valueBytes(); }
+
+    // The arrays of the table (read by the lookups, whether owned or attached), e.g. to write them to a snapshot
+    const void* tagData() const { return bucket_tags; }
+    const void* keyData() const { return bucket_keys; }
+    const V* valueData() const { return slot_values; }
+    std::size_t tagBytes() const { return num_of_buckets * sizeof(TagBlock); }
+    std::size_t keyBytes() const { return num_of_buckets * sizeof(KeyBlock); }
+    std::size_t valueBytes() const { return capacity() * sizeof(V); }
+    static constexpr std::size_t blockAlignment() { return std::max(alignof(TagBlock), alignof(KeyBlock)); }
+    static constexpr std::size_t tagBlockBytes() { return sizeof(TagBlock); }      // the tags / keys of a bucket
+    static constexpr std::size_t keyBlockBytes() { return sizeof(KeyBlock); }
+
+    static Tag tagOf(std::size_t hash) {
+        uint64_t folded = static_cast<uint64_t>(hash);
+        folded ^= folded >> 32;
+        folded ^= folded >> 16;
+        if (sizeof(Tag) == sizeof(uint8_t)) {
+            folded ^= folded >> 8;
+        }
+        Tag tag = static_cast<Tag>(folded);
+        return (tag == 0) ? 1 : tag;        // 0 marks an empty slot
+    }
+    std::size_t primaryBucket(std::size_t hash) const { return hash & mask; }
+    std::size_t alternateBucket(std::size_t bucket, Tag tag) const {
+        return (bucket ^ ((static_cast<std::size_t>(tag) + 1) * static_cast<std::size_t>(FROZEN_CUCKOO_ALT_INDEX_MULTIPLIER))) & mask;
+    }
+    /// <summary>
+    /// Prefetch the tags of a bucket (see the batched lookups).
+    /// </summary>
+    void prefetchBucket(std::size_t bucket) const {
+#if defined __GNUC__
+        __builtin_prefetch(&bucket_tags[bucket]);
+#else
+        (void)bucket;
+#endif
+    }
+    /// <summary>
+    /// Prefetch the keys of a bucket: only once its tags matched (most lookups miss, and never read them).
+    /// </summary>
+    void prefetchKeys(std::size_t bucket) const {
+#if defined __GNUC__
+        __builtin_prefetch(&bucket_keys[bucket]);
+#else
+        (void)bucket;
+#endif
+    }
+
+private:
+    struct alignas(FROZEN_CUCKOO_SLOTS_PER_BUCKET * sizeof(Tag)) TagBlock {
+        Tag tags[FROZEN_CUCKOO_SLOTS_PER_BUCKET];
+    };
+    struct alignas(FROZEN_CUCKOO_SLOTS_PER_BUCKET * sizeof(K)) KeyBlock {
+        K keys[FROZEN_CUCKOO_SLOTS_PER_BUCKET];
+    };
+
+    uint32_t matchTags(std::size_t bucket, Tag tag) const;
+    bool findInBucket(std::size_t bucket, Tag tag, const K& key, std::size_t* slot) const;
+    bool insert(K key, V value, uint64_t& random_state);
+    template<typename F>
+    void probeBatch(const K* keys, const std::size_t* hashes, std::size_t n, F on_probe) const;
+    template<typename F>
+    void hashBatch(const K* keys, std::size_t n, F on_hashed) const;
+
+    void bindOwnedArrays();
+
+    std::vector<TagBlock> tag_blocks;   // the arrays of a built table (empty if attached)
+    std::vector<KeyBlock> key_blocks;
+    std::vector<V> values;              // values[bucket * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot]
+    const TagBlock* bucket_tags;        // the arrays the lookups read: the ones above, or attached ones
+    const KeyBlock* bucket_keys;
+    const V* slot_values;
+    std::size_t num_of_buckets;
+    std::size_t mask;
+    std::size_t num_of_elements;
+};
+
+
+/// <summary>
+/// Freeze the contents of a libcuckoo table.
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+template<typename H2, typename E, typename A, std::size_t S>
+FrozenCuckooTable<K, V, Tag, H>::FrozenCuckooTable(libcuckoo::cuckoohash_map<K, V, H2, E, A, S>& table) : FrozenCuckooTable() {
+    std::vector<K> table_keys;
+    std::vector<V> table_values;
+    table_keys.reserve(table.size());
+    table_values.reserve(table.size());
+    auto locked_table = table.lock_table();
+    for (const auto& entry : locked_table) {
+        table_keys.push_back(entry.first);
+        table_values.push_back(entry.second);
+    }
+    locked_table.unlock();
+    build(table_keys, table_values);
+}
+
+template<typename K, typename V, typename Tag, typename H>
+FrozenCuckooTable<K, V, Tag, H>& FrozenCuckooTable<K, V, Tag, H>::operator=(const FrozenCuckooTable& other) {
+    tag_blocks = other.tag_blocks;
+    key_blocks = other.key_blocks;
+    values = other.values;
+    num_of_buckets = other.num_of_buckets;
+    mask = other.mask;
+    num_of_elements = other.num_of_elements;
+    if (other.bucket_tags == other.tag_blocks.data()) {
+        bindOwnedArrays();
+    }
+    else {      // attached arrays are shared
+        bucket_tags = other.bucket_tags;
+        bucket_keys = other.bucket_keys;
+        slot_values = other.slot_values;
+    }
+    return *this;
+}
+
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::bindOwnedArrays() {
+    bucket_tags = tag_blocks.data();
+    bucket_keys = key_blocks.data();
+    slot_values = values.data();
+}
+
+/// <summary>
+/// Look up arrays the table does not own (laid out as tagData() / keyData() / valueData() of a table of num_of_buckets buckets),
+/// which must outlive the table. The table's own arrays are released.
+/// </summary>
+/// <returns>false if num_of_buckets is not a power of 2, or an array is not aligned as the lookups load it</returns>
+template<typename K, typename V, typename Tag, typename H>
+bool FrozenCuckooTable<K, V, Tag, H>::attach(const void* tags, const void* keys, const V* values, std::size_t num_of_buckets,
+                                             std::size_t num_of_elements) {
+    if (num_of_buckets == 0 || (num_of_buckets & (num_of_buckets - 1)) != 0
+        || reinterpret_cast<uintptr_t>(tags) % alignof(TagBlock) != 0 || reinterpret_cast<uintptr_t>(keys) % alignof(KeyBlock) != 0
+        || reinterpret_cast<uintptr_t>(values) % alignof(V) != 0) {
+        return false;
+    }
+    tag_blocks = std::vector<TagBlock>();
+    key_blocks = std::vector<KeyBlock>();
+    this->values = std::vector<V>();
+    bucket_tags = static_cast<const TagBlock*>(tags);
+    bucket_keys = static_cast<const KeyBlock*>(keys);
+    slot_values = values;
+    this->num_of_buckets = num_of_buckets;
+    mask = num_of_buckets - 1;
+    this->num_of_elements = num_of_elements;
+    return true;
+}
+
+/// <summary>
+/// Build the table from (unique) keys and their values. The number of buckets is the smallest power of 2 holding the keys
+/// at FROZEN_CUCKOO_TARGET_LOAD_FACTOR; it is doubled until all the keys are placed.
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::build(const std::vector<K>& keys, const std::vector<V>& values) {
+    num_of_buckets = 1;
+    while (num_of_buckets * FROZEN_CUCKOO_SLOTS_PER_BUCKET * FROZEN_CUCKOO_TARGET_LOAD_FACTOR < keys.size()) {
+        num_of_buckets <<= 1;
+    }
+    for (;;) {
+        tag_blocks.assign(num_of_buckets, TagBlock());
+        key_blocks.assign(num_of_buckets, KeyBlock());
+        this->values.assign(num_of_buckets * FROZEN_CUCKOO_SLOTS_PER_BUCKET, V());
+        bindOwnedArrays();
+        mask = num_of_buckets - 1;
+        num_of_elements = 0;
+        uint64_t random_state = FROZEN_CUCKOO_EVICTION_SEED;
+        std::size_t i = 0;
+        while (i < keys.size() && insert(keys[i], values[i], random_state)) {
+            ++i;
+        }
+        if (i == keys.size()) {
+            return;
+        }
+        num_of_buckets <<= 1;       // an insertion failed (and evicted an entry): rebuild everything in a larger table
+    }
+}
+
+/// <summary>
+/// Place a key in one of its 2 buckets, evicting entries to their alternate buckets (random walk) if both are full.
+/// </summary>
+/// <returns>false if no place was found within FROZEN_CUCKOO_MAX_KICKS evictions (the last evicted entry is then lost)</returns>
+template<typename K, typename V, typename Tag, typename H>
+bool FrozenCuckooTable<K, V, Tag, H>::insert(K key, V value, uint64_t& random_state) {
+    std::size_t hash = H()(key);
+    Tag tag = tagOf(hash);
+    std::size_t bucket = primaryBucket(hash);
+    for (std::size_t kick = 0; kick <= FROZEN_CUCKOO_MAX_KICKS; ++kick) {
+        std::size_t buckets[2] = { bucket, alternateBucket(bucket, tag) };
+        for (std::size_t candidate : buckets) {
+            uint32_t empty_slots = matchTags(candidate, 0);
+            if (empty_slots != 0) {
+                std::size_t slot = lowestSetBit(empty_slots);
+                tag_blocks[candidate].tags[slot] = tag;
+                key_blocks[candidate].keys[slot] = key;
+                values[candidate * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot] = value;
+                ++num_of_elements;
+                return true;
+            }
+        }
+        // Both buckets are full: evict a random entry of one of them, and place it in its alternate bucket next
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        bucket = buckets[random_state & 1];
+        std::size_t slot = (random_state >> 1) % FROZEN_CUCKOO_SLOTS_PER_BUCKET;
+        std::swap(tag, tag_blocks[bucket].tags[slot]);
+        std::swap(key, key_blocks[bucket].keys[slot]);
+        std::swap(value, values[bucket * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot]);
+        bucket = alternateBucket(bucket, tag);
+        // the evicted entry goes to its other bucket: buckets[] of the next round are {its alternate, its current}
+    }
+    return false;
+}
+
+/// <summary>
+/// Bitmask of the slots of the bucket whose tag equals the given tag (bit i = slot i).
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+uint32_t FrozenCuckooTable<K, V, Tag, H>::matchTags(std::size_t bucket, Tag tag) const {
+#if defined FROZEN_CUCKOO_HAS_SSE2
+    if constexpr (sizeof(Tag) == sizeof(uint16_t)) {
+        __m128i tags = _mm_load_si128(reinterpret_cast<const __m128i*>(bucket_tags[bucket].tags));
+        __m128i matches = _mm_cmpeq_epi16(tags, _mm_set1_epi16(static_cast<short>(tag)));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(matches, matches))) & 0xff;
+    }
+    else {
+        __m128i tags = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bucket_tags[bucket].tags));
+        __m128i matches = _mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(tag)));
+        return static_cast<uint32_t>(_mm_movemask_epi8(matches)) & 0xff;
+    }
+#else
+    uint32_t matches = 0;
+    for (std::size_t slot = 0; slot < FROZEN_CUCKOO_SLOTS_PER_BUCKET; ++slot) {
+        matches |= static_cast<uint32_t>(bucket_tags[bucket].tags[slot] == tag) << slot;
+    }
+    return matches;
+#endif
+}
+
+template<typename K, typename V, typename Tag, typename H>
+bool FrozenCuckooTable<K, V, Tag, H>::findInBucket(std::size_t bucket, Tag tag, const K& key, std::size_t* slot) const {
+    uint32_t matches = matchTags(bucket, tag);
+    while (matches != 0) {
+        std::size_t candidate = lowestSetBit(matches);
+        if (bucket_keys[bucket].keys[candidate] == key) {
+            *slot = candidate;
+            return true;
+        }
+        matches &= matches - 1;
+    }
+    return false;
+}
+
+/// <summary>
+/// Look up a key whose hash (H's) is already known.
+/// </summary>
+/// <returns>true if the key is in the table (its value is stored into value)</returns>
+template<typename K, typename V, typename Tag, typename H>
+bool FrozenCuckooTable<K, V, Tag, H>::find(const K& key, std::size_t hash, V& value) const {
+    if (num_of_buckets == 0) {
+        return false;
+    }
+    Tag tag = tagOf(hash);
+    std::size_t bucket = primaryBucket(hash);
+    std::size_t slot = 0;
+    if (!findInBucket(bucket, tag, key, &slot)) {
+        bucket = alternateBucket(bucket, tag);
+        if (!findInBucket(bucket, tag, key, &slot)) {
+            return false;
+        }
+    }
+    value = slot_values[bucket * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot];
+    return true;
+}
+
+/// <summary>
+/// Look up a key (as libcuckoo's find).
+/// </summary>
+/// <returns>The value of the key. Throws std::out_of_range if the key is not in the table.</returns>
+template<typename K, typename V, typename Tag, typename H>
+V FrozenCuckooTable<K, V, Tag, H>::find(const K& key) const {
+    V value;
+    if (!find(key, value)) {
+        throw std::out_of_range("Key not found in the frozen cuckoo table.");
+    }
+    return value;
+}
+
+template<typename K, typename V, typename Tag, typename H>
+bool FrozenCuckooTable<K, V, Tag, H>::contains(const K& key, std::size_t hash) const {
+    if (num_of_buckets == 0) {
+        return false;
+    }
+    Tag tag = tagOf(hash);
+    std::size_t bucket = primaryBucket(hash);
+    std::size_t slot = 0;
+    return findInBucket(bucket, tag, key, &slot) || findInBucket(alternateBucket(bucket, tag), tag, key, &slot);
+}
+
+/// <summary>
+/// Probe n keys in groups of FROZEN_CUCKOO_BATCH_SIZE, in 3 passes over a group: compute the 2 buckets of every key and prefetch
+/// their tags; match the tags of every key and prefetch the keys of the buckets which matched; compare the keys.
+/// </summary>
+/// <param name="on_probe">Called for each key, in order: on_probe(i, position, found), position = index of its value</param>
+template<typename K, typename V, typename Tag, typename H>
+template<typename F>
+void FrozenCuckooTable<K, V, Tag, H>::probeBatch(const K* keys, const std::size_t* hashes, std::size_t n, F on_probe) const {
+    if (num_of_buckets == 0) {
+        for (std::size_t i = 0; i < n; ++i) {
+            on_probe(i, 0, false);
+        }
+        return;
+    }
+    const std::size_t not_found = static_cast<std::size_t>(-1);
+    std::size_t buckets[2][FROZEN_CUCKOO_BATCH_SIZE];   // the 2 buckets of each key of the group
+    uint32_t matches[2][FROZEN_CUCKOO_BATCH_SIZE];      // the slots of each of them whose tag is the key's
+    std::size_t positions[FROZEN_CUCKOO_BATCH_SIZE];    // bucket * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot of each key, or not_found
+    for (std::size_t begin = 0; begin < n; begin += FROZEN_CUCKOO_BATCH_SIZE) {
+        std::size_t group_size = std::min<std::size_t>(FROZEN_CUCKOO_BATCH_SIZE, n - begin);
+        const K* group_keys = keys + begin;
+        const std::size_t* group_hashes = hashes + begin;
+        for (std::size_t j = 0; j < group_size; ++j) {
+            buckets[0][j] = primaryBucket(group_hashes[j]);
+            buckets[1][j] = alternateBucket(buckets[0][j], tagOf(group_hashes[j]));
+            prefetchBucket(buckets[0][j]);
+            prefetchBucket(buckets[1][j]);
+        }
+        for (std::size_t j = 0; j < group_size; ++j) {
+            Tag tag = tagOf(group_hashes[j]);
+            for (std::size_t k = 0; k < 2; ++k) {
+                matches[k][j] = matchTags(buckets[k][j], tag);
+                if (matches[k][j] != 0) {
+                    prefetchKeys(buckets[k][j]);
+                }
+            }
+        }
+        // The results of the group are reported only once it is probed: the callers store them as bytes, which may alias
+        // the table and would force reloading it.
+        for (std::size_t j = 0; j < group_size; ++j) {
+            positions[j] = not_found;
+            for (std::size_t k = 0; k < 2 && positions[j] == not_found; ++k) {
+                for (uint32_t candidates = matches[k][j]; candidates != 0; candidates &= candidates - 1) {
+                    std::size_t slot = lowestSetBit(candidates);
+                    if (bucket_keys[buckets[k][j]].keys[slot] == group_keys[j]) {
+                        positions[j] = buckets[k][j] * FROZEN_CUCKOO_SLOTS_PER_BUCKET + slot;
+                        break;
+                    }
+                }
+            }
+        }
+        for (std::size_t j = 0; j < group_size; ++j) {
+            on_probe(begin + j, positions[j], positions[j] != not_found);
+        }
+    }
+}
+
+/// <summary>
+/// Hash n keys in blocks of BATCH_HASH_BLOCK_SIZE (with the SIMD kernels when H is CustomHash).
+/// </summary>
+/// <param name="on_hashed">Called for each block: on_hashed(offset, block_size, hashes)</param>
+template<typename K, typename V, typename Tag, typename H>
+template<typename F>
+void FrozenCuckooTable<K, V, Tag, H>::hashBatch(const K* keys, std::size_t n, F on_hashed) const {
+    std::size_t hashes[BATCH_HASH_BLOCK_SIZE];
+    for (std::size_t begin = 0; begin < n; begin += BATCH_HASH_BLOCK_SIZE) {
+        std::size_t block_size = std::min<std::size_t>(BATCH_HASH_BLOCK_SIZE, n - begin);
+        if constexpr (std::is_same<H, CustomHash>::value) {
+            hashKeys<K>(keys + begin, block_size, hashes);
+        }
+        else {
+            for (std::size_t j = 0; j < block_size; ++j) {
+                hashes[j] = H()(keys[begin + j]);
+            }
+        }
+        on_hashed(begin, block_size, hashes);
+    }
+}
+
+/// <summary>
+/// Look up n keys whose hashes (H's) are already known.
+/// </summary>
+/// <param name="results">results[i] = 1 if keys[i] is in the table, 0 otherwise</param>
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::contains_batch(const K* keys, const std::size_t* hashes, std::size_t n, uint8_t* results) const {
+    probeBatch(keys, hashes, n, [&](std::size_t i, std::size_t, bool found) {
+        results[i] = found;
+    });
+}
+
+/// <summary>
+/// Look up n keys (hashed in blocks first).
+/// </summary>
+/// <param name="results">results[i] = 1 if keys[i] is in the table, 0 otherwise</param>
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::contains_batch(const K* keys, std::size_t n, uint8_t* results) const {
+    hashBatch(keys, n, [&](std::size_t begin, std::size_t block_size, const std::size_t* hashes) {
+        contains_batch(keys + begin, hashes, block_size, results + begin);
+    });
+}
+
+/// <summary>
+/// Look up n keys whose hashes (H's) are already known, and get their values.
+/// </summary>
+/// <param name="values">values[i] = the value of keys[i], if found (unchanged otherwise)</param>
+/// <param name="found">found[i] = 1 if keys[i] is in the table, 0 otherwise</param>
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::find_batch(const K* keys, const std::size_t* hashes, std::size_t n, V* values, uint8_t* found) const {
+    probeBatch(keys, hashes, n, [&](std::size_t i, std::size_t position, bool is_found) {
+        found[i] = is_found;
+        if (is_found) {
+            values[i] = slot_values[position];
+        }
+    });
+}
+
+/// <summary>
+/// Look up n keys (hashed in blocks first), and get their values.
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+void FrozenCuckooTable<K, V, Tag, H>::find_batch(const K* keys, std::size_t n, V* values, uint8_t* found) const {
+    hashBatch(keys, n, [&](std::size_t begin, std::size_t block_size, const std::size_t* hashes) {
+        find_batch(keys + begin, hashes, block_size, values + begin, found + begin);
+    });
+}
+
+/// <summary>
+/// Batched lookup of n keys and their (H's) hashes in any table: the lookups of a FrozenCuckooTable, batched if
+/// FROZEN_CUCKOO_BATCHED_SCAN (the 'prefetch' benchmark compares both)...
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+void findBatch(const FrozenCuckooTable<K, V, Tag, H>& table, const K* keys, const std::size_t* hashes, std::size_t n, V* values, uint8_t* found) {
+    if (FROZEN_CUCKOO_BATCHED_SCAN) {
+        table.find_batch(keys, hashes, n, values, found);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        found[i] = table.find(keys[i], hashes[i], values[i]);
+    }
+}
+
+/// <summary>
+/// ...or one lookup per key in a libcuckoo table. The hashes reach its hasher only if it is a PrehashedHash (they must then be
+/// the hashes of the hasher it wraps); any other hasher hashes the keys again.
+/// </summary>
+template<typename K, typename V, typename H, typename E, typename A, std::size_t S>
+void findBatch(const libcuckoo::cuckoohash_map<K, V, H, E, A, S>& table, const K* keys, const std::size_t* hashes, std::size_t n,
+               V* values, uint8_t* found) {
+    for (std::size_t i = 0; i < n; ++i) {
+        if constexpr (IsPrehashedHash<H>::value) {
+            H::arm(keys[i], hashes[i]);
+        }
+        found[i] = table.find(keys[i], values[i]);
+    }
+}
+
+
+/// <summary>
+/// The table a scan looks up, given the libcuckoo table holding the substrings: a FrozenCuckooTable built from its contents
+/// (stored into storage)...
+/// </summary>
+template<typename T, typename K, typename V, typename H, typename E, typename A, std::size_t S>
+const T& lookupTableOf(libcuckoo::cuckoohash_map<K, V, H, E, A, S>& table, std::unique_ptr<T>& storage) {
+    storage.reset(new T(table));
+    return *storage;
+}
+
+/// <summary>
+/// ...or the libcuckoo table itself.
+/// </summary>
+template<typename K, typename V, typename H, typename E, typename A, std::size_t S>
+const libcuckoo::cuckoohash_map<K, V, H, E, A, S>& lookupTableOf(libcuckoo::cuckoohash_map<K, V, H, E, A, S>& table,
+    std::unique_ptr<libcuckoo::cuckoohash_map<K, V, H, E, A, S>>&) {
+    return table;
+}
+
+#endif // _FROZEN_CUCKOO_TABLE_H
@@ -0,0 +1,378 @@
+#ifndef _HUGE_PAGES_H
+#define _HUGE_PAGES_H
+
+#include "FrozenCuckooTable.h"
+#include "SidArena.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <new>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+#if defined __GNUC__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define HUGE_PAGES_HAS_PERF_EVENTS
+#endif
+
+#define HUGE_PAGE_SIZE (std::size_t(2) << 20)      // 2 [MB]: the huge pages of x86-64 (and of arm64 with 4 [KB] base pages)
+#define HUGE_PAGES_BASE_PAGE_SIZE 4096              // the regions are touched once per base page when they are mapped
+
+/*
+An allocation backend for the structures a scan reads (the buckets of a table, the lists of SIDs): a bump arena over regions
+of whole huge pages, so that a table of 256 - 512 [KB] and its lists are covered by a single dTLB entry instead of ~100 4 [KB]
+ones. A region is, in order of preference:
+    > HugeTlb: a MAP_HUGETLB mapping (explicit huge pages, from the pool reserved in /proc/sys/vm/nr_hugepages);
+    > Transparent: an anonymous mapping aligned to a huge page and madvise(MADV_HUGEPAGE)'d, touched once so it is faulted in
+      (as huge pages when the kernel has them: transparent_hugepage "madvise" or "always");
+    > BasePages: the same mapping where madvise is refused, or std::malloc where mmap is not available (or failed).
+The arena never frees a single allocation: its regions are released with it (the structures are built once, then only read).
+HugePageAllocator<T> allocates from an arena (e.g. the buckets and locks of the libcuckoo table of searchTest, reserved so it
+does not resize); moveToHugePages() copies a built FrozenCuckooTable or SidArena into an arena, and attaches it there.
+DtlbMissCounter counts the dTLB load misses of the calling thread (perf_event_open) to check the effect, where the CPU exposes
+the event: in a VM without a PMU it is not available(), and the results have no count (not a count of 0).
+*/
+
+
+enum class HugePageBacking { HugeTlb, Transparent, BasePages };     // from the most to the least favorable
+
+inline const char* hugePageBackingName(HugePageBacking backing) {
+    switch (backing) {
+        case HugePageBacking::HugeTlb:
+            return "hugetlb";
+        case HugePageBacking::Transparent:
+            return "transparent";
+        default:
+            return "base_pages";
+    }
+}
+
+/// <summary>
+/// The transparent huge pages mode of the kernel (the selected one of "always", "madvise", "never"), "" where unknown.
+/// </summary>
+inline std::string transparentHugePagesMode() {
+    std::ifstream mode_file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string modes;
+    std::getline(mode_file, modes);
+    std::size_t begin = modes.find('['), end = modes.find(']');
+    return (begin != std::string::npos && end != std::string::npos && end > begin) ? modes.substr(begin + 1, end - begin - 1) : "";
+}
+
+/// <summary>
+/// A bump allocator over huge page regions (see above). Not thread safe: the structures are allocated while they are built.
+/// </summary>
+class HugePageArena {
+public:
+    HugePageArena() {}
+    ~HugePageArena() { release(); }
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    /// <summary>
+    /// Copy n elements into the arena.
+    /// </summary>
+    template<typename T>
+    T* copy(const T* data, std::size_t n, std::size_t alignment = alignof(T)) {
+        T* copied = static_cast<T*>(allocate(std::max<std::size_t>(1, n) * sizeof(T), alignment));
+        if (n > 0) {
+            std::memcpy(static_cast<void*>(copied), static_cast<const void*>(data), n * sizeof(T));
+        }
+        return copied;
+    }
+    void release();
+
+    std::size_t usedBytes() const;
+    std::size_t mappedBytes() const;
+    std::size_t hugePageBytes() const;
+    /// <summary>
+    /// The backing of the arena: the least favorable one of its regions (BasePages if it has none yet).
+    /// </summary>
+    HugePageBacking backing() const {
+        HugePageBacking weakest = regions.empty() ? HugePageBacking::BasePages : HugePageBacking::HugeTlb;
+        for (const Region& region : regions) {
+            weakest = std::max(weakest, region.backing);
+        }
+        return weakest;
+    }
+
+private:
+    struct Region {
+        uint8_t* base;
+        std::size_t size;
+        std::size_t used;
+        HugePageBacking backing;
+        bool is_mapped;         // by mmap, else by std::malloc
+    };
+
+    static Region mapRegion(std::size_t size);
+
+    std::vector<Region> regions;
+};
+
+/// <summary>
+/// Allocate bytes aligned to alignment (a power of 2) from the last region, or from a new one of whole huge pages.
+/// </summary>
+inline void* HugePageArena::allocate(std::size_t bytes, std::size_t alignment) {
+    if (!regions.empty()) {
+        Region& region = regions.back();
+        uintptr_t begin = reinterpret_cast<uintptr_t>(region.base) + region.used;
+        uintptr_t aligned = (begin + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        if (aligned + bytes <= reinterpret_cast<uintptr_t>(region.base) + region.size) {
+            region.used = aligned + bytes - reinterpret_cast<uintptr_t>(region.base);
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+    std::size_t size = (bytes + alignment + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    regions.push_back(mapRegion(size));
+    return allocate(bytes, alignment);
+}
+
+inline HugePageArena::Region HugePageArena::mapRegion(std::size_t size) {
+#if defined __GNUC__
+    void* addr = MAP_FAILED;
+#if defined MAP_HUGETLB
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+        return { static_cast<uint8_t*>(addr), size, 0, HugePageBacking::HugeTlb, true };
+    }
+#endif
+    // Map a huge page more than the region, and unmap what is before and after its aligned part
+    addr = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr != MAP_FAILED) {
+        uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+        uintptr_t aligned = (begin + HUGE_PAGE_SIZE - 1) & ~static_cast<uintptr_t>(HUGE_PAGE_SIZE - 1);
+        if (aligned > begin) {
+            munmap(addr, aligned - begin);
+        }
+        if (begin + HUGE_PAGE_SIZE > aligned) {
+            munmap(reinterpret_cast<void*>(aligned + size), begin + HUGE_PAGE_SIZE - aligned);
+        }
+        uint8_t* base = reinterpret_cast<uint8_t*>(aligned);
+        HugePageBacking backing = HugePageBacking::BasePages;
+#if defined MADV_HUGEPAGE
+        if (madvise(base, size, MADV_HUGEPAGE) == 0) {
+            backing = HugePageBacking::Transparent;
+        }
+#endif
+        for (std::size_t offset = 0; offset < size; offset += HUGE_PAGES_BASE_PAGE_SIZE) {
+            base[offset] = 0;
+        }
+        return { base, size, 0, backing, true };
+    }
+#endif
+    uint8_t* base = static_cast<uint8_t*>(std::malloc(size));
+    if (base == nullptr) {
+        throw std::bad_alloc();
+    }
+    return { base, size, 0, HugePageBacking::BasePages, false };
+}
+
+inline void HugePageArena::release() {
+    for (const Region& region : regions) {
+#if defined __GNUC__
+        if (region.is_mapped) {
+            munmap(region.base, region.size);
+            continue;
+        }
+#endif
+        std::free(region.base);
+    }
+    regions.clear();
+}
+
+inline std::size_t HugePageArena::usedBytes() const {
+    std::size_t bytes = 0;
+    for (const Region& region : regions) {
+        bytes += region.used;
+    }
+    return bytes;
+}
+
+inline std::size_t HugePageArena::mappedBytes() const {
+    std::size_t bytes = 0;
+    for (const Region& region : regions) {
+        bytes += region.size;
+    }
+    return bytes;
+}
+
+/// <summary>
+/// The bytes of the arena actually backed by huge pages: its HugeTlb regions, and the AnonHugePages the kernel reports
+/// (/proc/self/smaps) for its Transparent ones. 0 where /proc is not available.
+/// </summary>
+inline std::size_t HugePageArena::hugePageBytes() const {
+    std::size_t bytes = 0;
+    bool has_transparent = false;
+    for (const Region& region : regions) {
+        bytes += (region.backing == HugePageBacking::HugeTlb) ? region.size : 0;
+        has_transparent = has_transparent || region.backing == HugePageBacking::Transparent;
+    }
+    if (!has_transparent) {
+        return bytes;
+    }
+    std::ifstream smaps_file("/proc/self/smaps");
+    std::string line;
+    bool is_region = false;     // the lines of the current mapping are about one of the Transparent regions
+    while (std::getline(smaps_file, line)) {
+        std::size_t dash = line.find('-');
+        std::size_t space = line.find(' ');
+        if (dash != std::string::npos && space != std::string::npos && dash < space && line.find(':') > space) {
+            uintptr_t begin = static_cast<uintptr_t>(std::stoull(line.substr(0, dash), nullptr, 16));
+            uintptr_t end = static_cast<uintptr_t>(std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16));
+            is_region = false;
+            for (const Region& region : regions) {
+                uintptr_t region_begin = reinterpret_cast<uintptr_t>(region.base);
+                is_region = is_region || (region.backing == HugePageBacking::Transparent && begin < region_begin + region.size && region_begin < end);
+            }
+        }
+        else if (is_region && line.compare(0, 14, "AnonHugePages:") == 0) {
+            bytes += static_cast<std::size_t>(std::stoull(line.substr(14))) * 1024;     // the values are in kB
+        }
+    }
+    return bytes;
+}
+
+
+/// <summary>
+/// An allocator from a HugePageArena (std::allocator without an arena). Deallocating is a no-op: the arena releases its
+/// memory at once. The copies and rebinds of an allocator allocate from the same arena.
+/// </summary>
+template<typename T>
+class HugePageAllocator {
+public:
+    typedef T value_type;
+    template<typename U>
+    struct rebind {
+        typedef HugePageAllocator<U> other;
+    };
+
+    HugePageAllocator() : arena(nullptr) {}
+    explicit HugePageAllocator(HugePageArena* arena) : arena(arena) {}
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (arena == nullptr) {
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) {
+        if (arena == nullptr) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const HugePageAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const HugePageAllocator<U>& other) const { return arena != other.arena; }
+
+    HugePageArena* arena;
+};
+
+
+/// <summary>
+/// Copy the arrays of a built table into the arena, and look them up there.
+/// </summary>
+template<typename K, typename V, typename Tag, typename H>
+void moveToHugePages(FrozenCuckooTable<K, V, Tag, H>& table, HugePageArena& arena) {
+    if (table.bucket_count() == 0) {
+        return;
+    }
+    const std::size_t alignment = FrozenCuckooTable<K, V, Tag, H>::blockAlignment();
+    const void* tags = arena.copy(static_cast<const uint8_t*>(table.tagData()), table.tagBytes(), alignment);
+    const void* keys = arena.copy(static_cast<const uint8_t*>(table.keyData()), table.keyBytes(), alignment);
+    const V* values = arena.copy(table.valueData(), table.capacity());
+    table.attach(tags, keys, values, table.bucket_count(), table.size());
+}
+
+/// <summary>
+/// ...a libcuckoo table owns its buckets: it is left in place (allocate them from the arena with a HugePageAllocator instead).
+/// </summary>
+template<typename K, typename V, typename H, typename E, typename A, std::size_t S>
+void moveToHugePages(libcuckoo::cuckoohash_map<K, V, H, E, A, S>&, HugePageArena&) {}
+
+/// <summary>
+/// Copy the lists of an arena (once all of them are added) into the huge page arena, and read them there.
+/// </summary>
+inline void moveToHugePages(SidArena& sid_arena, HugePageArena& arena) {
+    if (sid_arena.sizeWords() == 0) {
+        return;
+    }
+    std::size_t num_of_words = sid_arena.sizeWords();
+    const uint32_t* words = arena.copy(sid_arena.data(), num_of_words);
+    sid_arena.attach(words, num_of_words);
+}
+
+
+/// <summary>
+/// Counts the dTLB load misses of the calling thread (user space) between start() and stop(), where perf events are
+/// available and permitted (kernel.perf_event_paranoid <= 2); available() tells.
+/// </summary>
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() : fd(-1) {
+#if defined HUGE_PAGES_HAS_PERF_EVENTS
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~DtlbMissCounter() {
+#if defined HUGE_PAGES_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+    DtlbMissCounter(const DtlbMissCounter&) = delete;
+    DtlbMissCounter& operator=(const DtlbMissCounter&) = delete;
+
+    bool available() const { return fd >= 0; }
+    void start() {
+#if defined HUGE_PAGES_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    /// <summary>
+    /// The misses since start() (0 if not available).
+    /// </summary>
+    uint64_t stop() {
+        uint64_t count = 0;
+#if defined HUGE_PAGES_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd;
+};
+
+#endif // _HUGE_PAGES_H
@@ -0,0 +1,175 @@
+#ifndef _LATENCY_HISTOGRAM_H
+#define _LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#include <x86intrin.h>
+#define LATENCY_CLOCK_HAS_TSC
+#endif
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 5         // a bucket spans at most 1 / 2^(5 - 1) = 6.25% of its values
+#define LATENCY_CLOCK_CALIBRATION_NS 2000000        // the time stamp counter is calibrated against steady_clock over 2 [ms]
+
+/*
+Per-operation latency recording (insertions and lookups, in [ns]).
+    > LatencyClock reads the time stamp counter (rdtsc, a few [ns]) where available, converted to [ns] with a rate calibrated
+      once against std::chrono::steady_clock; elsewhere it is steady_clock itself.
+    > LatencyHistogram buckets the latencies log-linearly (as HdrHistogram): exact below 2^(B-1) [ns], then 2^(B-1) buckets
+      per power of 2, so every percentile is within 6.25% of the recorded latencies (B = LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+      and recording a latency is a few arithmetic ops and an increment. Histograms are merged by adding their counts.
+*/
+
+
+/// <summary>
+/// The percentiles (in [ns]) of a LatencyHistogram: the upper bound of the bucket holding each of them (the max is exact).
+/// </summary>
+struct LatencySummary {
+    std::size_t count;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+};
+
+/// <summary>
+/// A low overhead clock for timing single operations.
+/// </summary>
+class LatencyClock {
+public:
+    typedef uint64_t ticks_type;
+
+    static ticks_type now() {
+#if defined LATENCY_CLOCK_HAS_TSC
+        return __rdtsc();
+#else
+        return static_cast<ticks_type>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static double toNanoseconds(ticks_type ticks) { return ticks * nanosecondsPerTick(); }
+
+    static double nanosecondsPerTick() {
+#if defined LATENCY_CLOCK_HAS_TSC
+        static const double ns_per_tick = calibrate();
+        return ns_per_tick;
+#else
+        return 1.0;
+#endif
+    }
+
+private:
+    static double calibrate() {
+        auto begin = std::chrono::steady_clock::now();
+        ticks_type begin_ticks = now();
+        std::chrono::steady_clock::time_point end;
+        do {
+            end = std::chrono::steady_clock::now();
+        } while (std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() < LATENCY_CLOCK_CALIBRATION_NS);
+        ticks_type end_ticks = now();
+        return std::chrono::duration<double, std::nano>(end - begin).count() / double(end_ticks - begin_ticks);
+    }
+};
+
+/// <summary>
+/// A log-linear histogram of latencies in [ns].
+/// </summary>
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts(), count(0), max_ns(0) {}
+
+    void record(uint64_t ns) {
+        ++counts[bucketOf(ns)];
+        ++count;
+        max_ns = std::max(max_ns, ns);
+    }
+    /// <summary>
+    /// Record the latency between two LatencyClock::now() readings.
+    /// </summary>
+    void recordTicks(LatencyClock::ticks_type begin, LatencyClock::ticks_type end) {
+        record(static_cast<uint64_t>(LatencyClock::toNanoseconds(end - begin) + 0.5));
+    }
+    void merge(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < NUM_OF_BUCKETS; ++i) {
+            counts[i] += other.counts[i];
+        }
+        count += other.count;
+        max_ns = std::max(max_ns, other.max_ns);
+    }
+    void clear() { *this = LatencyHistogram(); }
+
+    std::size_t size() const { return count; }
+    uint64_t max() const { return max_ns; }
+    uint64_t percentile(double fraction) const;
+    LatencySummary summary() const {
+        return { count, double(percentile(0.5)), double(percentile(0.9)), double(percentile(0.99)), double(percentile(0.999)), double(max_ns) };
+    }
+
+private:
+    static constexpr std::size_t HALF_BUCKETS = std::size_t(1) << (LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1);
+    static constexpr std::size_t NUM_OF_BUCKETS = (64 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 2) * HALF_BUCKETS;
+
+    /// <summary>
+    /// Latencies below 2 * HALF_BUCKETS have a bucket each; above, the bucket of a latency is its power of 2 (its top bit)
+    /// and its next B - 1 bits.
+    /// </summary>
+    static std::size_t bucketOf(uint64_t ns) {
+        if (ns < 2 * HALF_BUCKETS) {
+            return static_cast<std::size_t>(ns);
+        }
+        std::size_t shift = topBit(ns) - (LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1);
+        return shift * HALF_BUCKETS + static_cast<std::size_t>(ns >> shift);
+    }
+    /// <summary>
+    /// The largest latency of a bucket.
+    /// </summary>
+    static uint64_t bucketUpperBound(std::size_t bucket) {
+        if (bucket < 2 * HALF_BUCKETS) {
+            return bucket;
+        }
+        std::size_t shift = bucket / HALF_BUCKETS - 1;
+        uint64_t mantissa = bucket % HALF_BUCKETS + HALF_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+    static std::size_t topBit(uint64_t value) {
+#if defined __GNUC__
+        return 63 - static_cast<std::size_t>(__builtin_clzll(value));
+#else
+        std::size_t bit = 0;
+        while (value >>= 1) {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    std::array<uint64_t, NUM_OF_BUCKETS> counts;
+    std::size_t count;
+    uint64_t max_ns;
+};
+
+/// <summary>
+/// The latency below which the given fraction of the recorded latencies are (0 if none was recorded).
+/// </summary>
+inline uint64_t LatencyHistogram::percentile(double fraction) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+    uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < NUM_OF_BUCKETS; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(bucket), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+#endif // _LATENCY_HISTOGRAM_H
@@ -0,0 +1,251 @@
+#ifndef _PARALLEL_SCAN_H
+#define _PARALLEL_SCAN_H
+
+#include "WindowScanner.h"
+#include "BatchHash.h"
+#include "BinaryFuseFilter.h"
+#include "FrozenCuckooTable.h"
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Parallel scanning of independent payloads (flows) against one shared, read-only substrings table.
+Every worker thread owns a ScanWorker: its window buffers and its match histogram, so the scan shares nothing writable.
+The payloads are handed out dynamically (an atomic index), and the histograms are merged once all the workers are done.
+The table is only looked up: a FrozenCuckooTable / BinaryFuseFilter are immutable, and libcuckoo's lookups are thread-safe
+(PrehashedHash arms a thread local slot).
+Two tables of different window lengths (e.g. L = 4 for the short signatures, L = 8 for the long ones) can be scanned in a single
+pass (MultiLengthScanWorker): the windows of both lengths come from the same loads, and the SIDs hit by both are reported once.
+*/
+
+
+/// <summary>
+/// The number of scanning threads: the requested number, or the number of hardware threads if 0.
+/// </summary>
+inline std::size_t scanThreadCount(std::size_t requested) {
+    if (requested != 0) {
+        return requested;
+    }
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// <summary>
+/// Run work(thread_index, item_index) for every item in [0, num_of_items), on num_of_threads threads.
+/// The items are taken one at a time from a shared counter (payloads differ in size), so the assignment of the items to the
+/// threads varies between runs: work must only write to the item and to the state of its thread.
+/// </summary>
+template<typename F>
+void parallelFor(std::size_t num_of_items, std::size_t num_of_threads, F work) {
+    num_of_threads = std::max<std::size_t>(1, std::min(num_of_threads, num_of_items));
+    if (num_of_threads == 1) {
+        for (std::size_t item = 0; item < num_of_items; ++item) {
+            work(0, item);
+        }
+        return;
+    }
+    std::atomic<std::size_t> next_item(0);
+    std::vector<std::thread> threads;
+    threads.reserve(num_of_threads);
+    for (std::size_t thread_index = 0; thread_index < num_of_threads; ++thread_index) {
+        threads.emplace_back([&, thread_index]() {
+            for (std::size_t item = next_item++; item < num_of_items; item = next_item++) {
+                work(thread_index, item);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+
+/// <summary>
+/// The scanning state of a worker thread: the buffers of a payload's windows (allocated once), the hits of the last payload,
+/// and the thread's totals and match histogram.
+/// </summary>
+/// <typeparam name="K">Type of the key</typeparam>
+/// <typeparam name="V">Type of the value of the table</typeparam>
+template<typename K, typename V>
+struct ScanWorker {
+    WindowSet<K> seen_windows;
+    std::vector<K> windows;                 // the unique windows of the payload which passed the prefilter
+    std::vector<std::size_t> window_hashes;
+    std::vector<V> window_values;
+    std::vector<uint8_t> window_found;
+    std::vector<K> hits;                    // the windows of the payload found in the table
+    std::vector<V> hit_values;              // and their values
+    std::map<int, int> sids_hit;            // histogram of the SIDs hit in all the payloads of this thread
+    std::size_t scanned_bytes;
+    std::size_t unique_windows;
+    std::size_t lookups;
+    double scan_time;                       // in seconds
+
+    ScanWorker() : scanned_bytes(0), unique_windows(0), lookups(0), scan_time(0) {}
+
+    /// <summary>
+    /// Allocate room for the windows of the largest payload.
+    /// </summary>
+    void reserve(std::size_t max_windows) {
+        seen_windows.reserve(max_windows);
+        windows.reserve(max_windows);
+        window_hashes.reserve(max_windows);
+        window_values.resize(max_windows);
+        window_found.resize(max_windows);
+        hits.reserve(max_windows);
+        hit_values.reserve(max_windows);
+    }
+};
+
+/// <summary>
+/// Scan a payload: the unique windows (L bytes, every G bytes, lowercase) which pass the prefilter (if any) are looked up in
+/// the table in a batch. The hits are left in worker.hits / worker.hit_values.
+/// </summary>
+/// <param name="prefilter">A filter of the keys of the table, or nullptr</param>
+template<typename K, std::size_t L, std::size_t G, typename T, typename V>
+void scanPayload(const T& table, const BinaryFuseFilter<K>* prefilter, const uint8_t* payload, std::size_t length, ScanWorker<K, V>& worker) {
+    worker.seen_windows.reset();
+    worker.windows.clear();
+    worker.window_hashes.clear();
+    worker.hits.clear();
+    worker.hit_values.clear();
+    // The windows are hashed in batches (SIMD) and each lookup uses its window's hash (see PrehashedHash).
+    forEachHashedWindow<K, L, G>(payload, length, true, [&](K key, std::size_t hash) {
+        if (worker.seen_windows.insert(key, hash)) {
+            ++worker.unique_windows;
+            if (prefilter == nullptr || prefilter->contains(key)) {
+                worker.windows.push_back(key);
+                worker.window_hashes.push_back(hash);
+            }
+        }
+    });
+    // The lookups of the windows, with their hashes (batched or not, see findBatch)
+    findBatch(table, worker.windows.data(), worker.window_hashes.data(), worker.windows.size(), worker.window_values.data(),
+              worker.window_found.data());
+    worker.lookups += worker.windows.size();
+    for (std::size_t i = 0; i < worker.windows.size(); ++i) {
+        if (worker.window_found[i]) {
+            worker.hits.push_back(worker.windows[i]);
+            worker.hit_values.push_back(worker.window_values[i]);
+        }
+    }
+    worker.scanned_bytes += length;
+}
+
+/// <summary>
+/// The scanning state of a worker thread scanning every payload against two tables at once, of windows of LS and LL bytes
+/// (see scanPayloadMultiLength): the state of the scan of each length, and the distinct SIDs of the last payload.
+/// </summary>
+template<typename KS, typename KL, typename V>
+struct MultiLengthScanWorker {
+    ScanWorker<KS, V> short_scan;           // the windows and hits of the short windows
+    ScanWorker<KL, V> long_scan;            // ...and of the long ones
+    WindowSet<uint32_t> seen_sids;
+    std::vector<uint32_t> sids;             // the distinct SIDs hit in the payload (by either length)
+    std::map<int, int> sids_hit;            // histogram of the SIDs hit in all the payloads of this thread (once per payload)
+    std::size_t scanned_bytes;
+    std::size_t duplicate_sids;             // SIDs hit again in the same payload (by both lengths, or by several windows)
+    double scan_time;                       // in seconds
+
+    MultiLengthScanWorker() : scanned_bytes(0), duplicate_sids(0), scan_time(0) {}
+
+    /// <summary>
+    /// Allocate room for the windows of the largest payload, and for max_sids distinct SIDs per payload.
+    /// </summary>
+    void reserve(std::size_t max_windows, std::size_t max_sids) {
+        short_scan.reserve(max_windows);
+        long_scan.reserve(max_windows);
+        seen_sids.reserve(max_sids);
+        sids.reserve(max_sids);
+    }
+
+    std::size_t lookups() const { return short_scan.lookups + long_scan.lookups; }
+};
+
+/// <summary>
+/// Scan a payload against a table of windows of LS bytes and a table of windows of LL bytes in a single pass: the windows of
+/// both lengths come from the same loads (see forEachHashedWindowPair), the unique ones of each length are looked up in their
+/// table in a batch, and the SIDs of the hits of both tables are merged into worker.sids, each SID once.
+/// </summary>
+/// <param name="short_sids">short_sids(value): the SIDs of a value of the short table (an iterable of uint32_t)</param>
+/// <param name="long_sids">long_sids(value): the SIDs of a value of the long table</param>
+template<typename KS, std::size_t LS, typename KL, std::size_t LL, std::size_t G, typename TS, typename TL, typename V, typename FS, typename FL>
+void scanPayloadMultiLength(const TS& short_table, const TL& long_table, const uint8_t* payload, std::size_t length,
+                            MultiLengthScanWorker<KS, KL, V>& worker, FS short_sids, FL long_sids) {
+    ScanWorker<KS, V>& short_scan = worker.short_scan;
+    ScanWorker<KL, V>& long_scan = worker.long_scan;
+    short_scan.seen_windows.reset();
+    long_scan.seen_windows.reset();
+    short_scan.windows.clear();
+    short_scan.window_hashes.clear();
+    long_scan.windows.clear();
+    long_scan.window_hashes.clear();
+    forEachHashedWindowPair<KS, LS, KL, LL, G>(payload, length, true,
+        [&](KS key, std::size_t hash) {
+            if (short_scan.seen_windows.insert(key, hash)) {
+                short_scan.windows.push_back(key);
+                short_scan.window_hashes.push_back(hash);
+            }
+        },
+        [&](KL key, std::size_t hash) {
+            if (long_scan.seen_windows.insert(key, hash)) {
+                long_scan.windows.push_back(key);
+                long_scan.window_hashes.push_back(hash);
+            }
+        });
+    findBatch(short_table, short_scan.windows.data(), short_scan.window_hashes.data(), short_scan.windows.size(),
+              short_scan.window_values.data(), short_scan.window_found.data());
+    findBatch(long_table, long_scan.windows.data(), long_scan.window_hashes.data(), long_scan.windows.size(),
+              long_scan.window_values.data(), long_scan.window_found.data());
+    short_scan.unique_windows += short_scan.windows.size();
+    long_scan.unique_windows += long_scan.windows.size();
+    short_scan.lookups += short_scan.windows.size();
+    long_scan.lookups += long_scan.windows.size();
+
+    worker.seen_sids.reset();
+    worker.sids.clear();
+    auto add_sid = [&](uint32_t sid) {
+        if (worker.seen_sids.insert(sid)) {
+            worker.sids.push_back(sid);
+        }
+        else {
+            ++worker.duplicate_sids;
+        }
+    };
+    for (std::size_t i = 0; i < short_scan.windows.size(); ++i) {
+        if (short_scan.window_found[i]) {
+            for (uint32_t sid : short_sids(short_scan.window_values[i])) {
+                add_sid(sid);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < long_scan.windows.size(); ++i) {
+        if (long_scan.window_found[i]) {
+            for (uint32_t sid : long_sids(long_scan.window_values[i])) {
+                add_sid(sid);
+            }
+        }
+    }
+    worker.scanned_bytes += length;
+}
+
+/// <summary>
+/// Merge the histograms of the workers (once they are done).
+/// </summary>
+/// <typeparam name="W">Type of the workers: ScanWorker or MultiLengthScanWorker</typeparam>
+template<typename W>
+std::map<int, int> mergeHistograms(const std::vector<W>& workers) {
+    std::map<int, int> sids_hit;
+    for (const W& worker : workers) {
+        for (const auto& sid : worker.sids_hit) {
+            sids_hit[sid.first] += sid.second;
+        }
+    }
+    return sids_hit;
+}
+
+#endif // _PARALLEL_SCAN_H
@@ -3,7 +3,9 @@
 
 #include "ExactMatches.h"
 #include "Substring.h"
+#include "SubstringIndex.h"
 #include "Statistics.h"
+#include "Ruleset.h"
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
@@ -12,38 +14,55 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <chrono>
 
 
 /// <summary>
 /// Parse the ExactMatches and extract Substrings of L bytes with parsing of G bytes jump gap per substring.
 /// </summary>
-/// <typeparam name="T">Type of the unsigned int which will represent the substring {uint32_t, uint64_t, ...}</typeparam>
-/// <param name="exact_matches">Element of class ExactMatches, which is a vector of ExactMatch (rules,type,string) for each exact match extracted from the snort rules' signatures</param>
+/// <typeparam name="T">Type of the unsigned int which will represent the substring {uint32_t, uint64_t, ...}, see SubstringKey<L></typeparam>
+/// <typeparam name="L">Length of the substrings (L <= sizeof(T))</typeparam>
+/// <typeparam name="G">Gap between 2 substrings</typeparam>
+/// <param name="exact_matches">A view of the compiled ruleset, holding the (rules, decoded bytes) of each exact match extracted from the snort rules' signatures</param>
 /// <param name="substrings">The set of Substrings in which the results will be stored</param>
-template<typename T, std::size_t G = SUBSTRING_DEFAULT_GAP>
-std::size_t parseExactMatches(const ExactMatches& exact_matches, std::vector<Substring<T>>& substrings, SubstringLogger& log) {
-    std::set<int> total_unique_rules;
+/// <param name="rule_pool">The RulePool in which the substrings' rule lists will be stored</param>
+template<typename T, std::size_t L = sizeof(T), std::size_t G = SUBSTRING_DEFAULT_GAP>
+std::size_t parseExactMatches(const RulesetView& exact_matches, std::vector<Substring<T>>& substrings, RulePool& rule_pool, SubstringLogger& log) {
+    static_assert(L <= sizeof(T), "The key type is too small for substrings of L bytes (see SubstringKey<L>)");
+    std::vector<uint32_t> total_unique_rules;
     
-    // Extract substrings for each exact match string and store it into the substrings vector
-    for (auto it = exact_matches.exact_matches->begin(); it != exact_matches.exact_matches->end(); ++it) {
-        std::string hexString = (*it)->getExactMatch();
-        std::set<int> rules = (*it)->getRulesNumbers();
-        total_unique_rules.insert(rules.begin(), rules.end());
-        Substring<T>::extractSubstrings(hexString, substrings, rules, G);
+    // Extract substrings for each exact match and store it into the substrings vector
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    SubstringIndex<T> index(substrings, rule_pool);
+    for (std::size_t i = 0; i < exact_matches.size(); ++i) {
+        Span<uint8_t> exact_match = exact_matches.getExactMatch(i);
+        Span<uint32_t> rules = exact_matches.getRulesNumbers(i);
+        total_unique_rules.insert(total_unique_rules.end(), rules.begin(), rules.end());
+        index.extract(exact_match.data(), exact_match.size(), rules, G, L);
     }
+    index.finalize();
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double extraction_time = std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+    std::cout << "Extracted " << index.getNumOfWindows() << " window(s) (" << substrings.size() << " unique) from "    \
+        << index.getNumOfBytes() << " Bytes in " << extraction_time * 1000 << "[ms] ("                               \
+        << index.getNumOfWindows() / extraction_time / 1e6 << " M windows/s, "                                      \
+        << index.getNumOfBytes() / extraction_time / (1024 * 1024) << " MB/s)." << std::endl;
 
     // Parse the unique* substrings to log them into the substrings_log.json
     // (*see extractSubstrings implementation)
-    for (Substring<T> substring : substrings) {
+    for (const Substring<T>& substring : substrings) {
+        Span<uint32_t> rules = rule_pool.getRules(substring.rules);
         log.logSubstringData({
             static_cast<std::size_t>(substring.getSubstring()),
-            substring.toStringHex(),
-            substring.str(),        // for full representation use: "substring.toStringFull()," instead
+            substring.toStringHex(L),
+            substring.str(L),       // for full representation use: "substring.toStringFull(L)," instead
             static_cast<std::size_t>(substring.getNumOfDups()),
-            std::set<int>(substring.rules->begin(), substring.rules->end())
+            std::set<int>(rules.begin(), rules.end())
         });
     }
-    std::size_t num_of_unique_rules = total_unique_rules.size();
+    std::sort(total_unique_rules.begin(), total_unique_rules.end());
+    std::size_t num_of_unique_rules = std::unique(total_unique_rules.begin(), total_unique_rules.end()) - total_unique_rules.begin();
     return num_of_unique_rules;
 }
 
@@ -57,37 +76,26 @@ std::size_t getTotalNumOfDups(const std::vector<Substring<T>>& substrings) {
 }
 
 /**
- * Parse a line in 'exact_matches_hex.json' to extract items of class ExactMatch.
+ * Parse a line in 'exact_matches_hex.json' to extract an exact match (decoded bytes and rules).
  *
  * @param line string representing a line in the parsed .json file
  * @param exact_matches reference to a member of class ExactMaches,
  * that the results of the parsing will be inserted to
  */
-void parseLine(std::string line, ExactMatches& exact_matches) {
+void parseLine(const std::string& line, ExactMatches& exact_matches) {
     nlohmann::json jsonObj = nlohmann::json::parse(line);
 
-    
-    std::vector<std::string> exact_match_str = jsonObj["exact_match"];
-    std::vector<std::string> exact_match_hex = jsonObj["exact_match_hex"];
-    std::vector<int> non_unique_rules = jsonObj["rules"];
-    std::set<int> rules(non_unique_rules.begin(), non_unique_rules.end());
-
-    std::string match = "0x";
-
-    int j = 0;
-    for (const auto& hex : exact_match_hex) {
-        std::string value_to_concat = "";
-        if ((hex.substr(0, 2) == "0x")) {
-            value_to_concat = hex.substr(2);
-        }
-        match = match + value_to_concat;
-        ++j;
+    // Each byte is given as "0x.." with 1 or 2 hex digits
+    std::vector<uint8_t> exact_match;
+    for (const auto& hex : jsonObj["exact_match_hex"]) {
+        exact_match.push_back(static_cast<uint8_t>(std::stoul(hex.get<std::string>(), nullptr, 16)));
     }
-    exact_matches.insert(ExactMatch(rules, match));
+    std::vector<uint32_t> rules = jsonObj["rules"].get<std::vector<uint32_t>>();
+    exact_matches.insert(exact_match.data(), exact_match.size(), rules);
 }
 
  /**
-  * Parse 'parta_data.json' to extract items of class ExactMatch.
+  * Parse 'parta_data.json' to extract the exact matches.
   *
   * @param file_path string representing a .json file to be parsed
   * @param exact_matches reference to a member of class ExactMaches,
@@ -113,6 +121,48 @@ void parseFile(std::string file_path, ExactMatches& exact_matches) {
     }
 }
 
+/// <summary>
+/// The compiler step: parse the .json file generated by Part A a single time, and write its exact matches as a compiled ruleset file.
+/// </summary>
+/// <param name="json_path">Path to the .json file generated by Part A</param>
+/// <param name="bin_path">Path to the compiled ruleset file to create</param>
+void compileRuleset(const std::string& json_path, const std::string& bin_path) {
+    ExactMatches exact_matches;
+    parseFile(json_path, exact_matches);
+    if (exact_matches.size() == 0) {
+        throw std::runtime_error("No exact matches were parsed from " + json_path + ".");
+    }
+    writeRuleset(exact_matches, bin_path);
+}
+
+/// <summary>
+/// Load the ruleset: map the compiled ruleset file, (re)compiling it first from the .json file
+/// if it is missing, invalid or older than the .json file.
+/// </summary>
+/// <param name="json_path">Path to the .json file generated by Part A</param>
+/// <param name="bin_path">Path to the compiled ruleset file</param>
+/// <param name="ruleset">The RulesetFile to map the compiled ruleset into</param>
+void loadRuleset(const std::string& json_path, const std::string& bin_path, RulesetFile& ruleset) {
+    try {
+        std::error_code error;
+        bool is_stale = std::filesystem::exists(json_path, error) && (!std::filesystem::exists(bin_path, error)
+            || std::filesystem::last_write_time(bin_path, error) < std::filesystem::last_write_time(json_path, error));
+        if (is_stale || !ruleset.open(bin_path)) {
+            std::cout << "Compiling " << json_path << " into " << bin_path << std::endl;
+            compileRuleset(json_path, bin_path);
+            if (!ruleset.open(bin_path)) {
+                throw std::runtime_error("Invalid compiled ruleset file " + bin_path + ".");
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "Loaded " << ruleset.view().size() << " exact match(es) from " << bin_path << std::endl;
+}
+
+
 
 /// <summary>
 /// Parse a JSON test file containing hexStrings of signatures patterns to search.
@@ -147,6 +197,13 @@ void parseFile(std::string file_path, std::vector<SearchResults>& res) {
         }
         
         search_item.search_key = oss.str();
+
+        // Decode the search key once, to the bytes that are scanned {FF FF FF FF ...} -> {0xFF, 0xFF, 0xFF, 0xFF, ...}
+        std::istringstream iss(tmp_string);
+        std::string byte_string;
+        while (iss >> byte_string) {
+            search_item.payload.push_back(static_cast<uint8_t>(std::stoul(byte_string, nullptr, 16)));
+        }
         res.push_back(search_item);
     }
 }
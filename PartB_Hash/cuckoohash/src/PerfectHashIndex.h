@@ -0,0 +1,232 @@
+#ifndef _PERFECT_HASH_INDEX_H
+#define _PERFECT_HASH_INDEX_H
+
+#include "CustomHash.h"
+#include "BinaryFuseFilter.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#define PERFECT_HASH_BUCKET_FACTOR 5.0              // c: the keys are split into c * n / log2(n) buckets
+#define PERFECT_HASH_LOAD_FACTOR 0.98               // alpha: the pilots place the keys in n / alpha positions (see the remapping below)
+#define PERFECT_HASH_DENSE_KEYS 0.6                 // skewed bucket assignment: 60% of the keys go to
+#define PERFECT_HASH_DENSE_BUCKETS 0.3              // 30% of the buckets
+#define PERFECT_HASH_MAX_PILOT 0xffff               // the pilots are 16 bits
+#define PERFECT_HASH_MAX_ITERATIONS 100             // seeds tried before giving up the construction
+#define PERFECT_HASH_SEED_STATE 0x3c6ef372fe94f82b
+#define PERFECT_HASH_POSITION_SALT 0x9e3779b97f4a7c15
+
+/*
+A static minimal perfect hash index of a set of keys (PTHash, Pibiri & Trani, "PTHash: Revisiting FCH Minimal Perfect Hashing"):
+every one of the n keys has its own position in [0, n), computed from the key and a 16 bits pilot of its bucket.
+    > The keys are split into ~c * n / log2(n) buckets (skewed: 60% of the keys in 30% of the buckets). The buckets are placed
+      from the largest one: the pilot of a bucket is the first value p such that position(key, p) of all its keys are free.
+    > Positions are drawn in [0, n / alpha): the last buckets find a free position quickly. The few keys placed at a position
+      >= n are remapped to the positions < n left free (a small array read only for them), so the index stays minimal.
+Paired with the keys in position order (membership: a key not in the set lands on some other key) and their values, a lookup
+is a single probe: a pilot, a key and a value, with no collisions to resolve.
+*/
+
+
+/// <summary>
+/// A minimal perfect hash index of (unique) keys of type K, with the keys and their values stored in position order.
+/// Lookup interface as FrozenCuckooTable's (and libcuckoo::cuckoohash_map's).
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+/// <typeparam name="V">Type of the value</typeparam>
+template<typename K, typename V>
+class PerfectHashIndex {
+public:
+    PerfectHashIndex() : seed(0), num_of_buckets(0), num_of_dense_buckets(0), num_of_positions(0) {}
+    PerfectHashIndex(const std::vector<K>& keys, const std::vector<V>& values) : PerfectHashIndex() { build(keys, values); }
+
+    bool build(const std::vector<K>& keys, const std::vector<V>& values);
+
+    /// <summary>
+    /// The position of a key in [0, size()). A key which is not in the set gets the position of some key of the set.
+    /// </summary>
+    std::size_t position(const K& key) const {
+        uint64_t hash = hashOf(key);
+        uint64_t pilot_hash = murmur64(pilots[bucketOf(hash)] ^ seed);
+        uint64_t low = 0;
+        std::size_t pos = static_cast<std::size_t>(multiply128(murmur64(hash ^ PERFECT_HASH_POSITION_SALT) ^ pilot_hash, num_of_positions, &low));
+        return (pos < keys.size()) ? pos : remapped[pos - keys.size()];
+    }
+    bool find(const K& key, V& value) const {
+        if (keys.empty()) {
+            return false;
+        }
+        std::size_t pos = position(key);
+        if (keys[pos] != key) {
+            return false;
+        }
+        value = values[pos];
+        return true;
+    }
+    bool contains(const K& key) const { return !keys.empty() && keys[position(key)] == key; }
+
+    std::size_t size() const { return keys.size(); }
+    std::size_t hashBytes() const { return pilots.size() * sizeof(uint16_t) + remapped.size() * sizeof(uint32_t); }  // the MPHF alone
+    std::size_t memoryBytes() const { return hashBytes() + keys.size() * sizeof(K) + values.size() * sizeof(V); }
+    double hashBitsPerKey() const { return keys.empty() ? 0 : 8.0 * hashBytes() / keys.size(); }
+    double bitsPerKey() const { return keys.empty() ? 0 : 8.0 * memoryBytes() / keys.size(); }
+
+private:
+    uint64_t hashOf(const K& key) const {
+#if SUBSTRING_MAX_LENGTH > 8
+        if constexpr (sizeof(K) > sizeof(uint64_t)) {
+            return murmur64(murmur64(static_cast<uint64_t>(key >> 64) + seed) ^ static_cast<uint64_t>(key));
+        }
+        else
+#endif
+        {
+            return murmur64(static_cast<uint64_t>(key) + seed);
+        }
+    }
+    std::size_t bucketOf(uint64_t hash) const {
+        uint64_t low = 0;
+        uint64_t spread = rotateLeft64(hash, 32);
+        if (hash < static_cast<uint64_t>(PERFECT_HASH_DENSE_KEYS * 18446744073709551616.0)) {
+            return static_cast<std::size_t>(multiply128(spread, num_of_dense_buckets, &low));
+        }
+        return num_of_dense_buckets + static_cast<std::size_t>(multiply128(spread, num_of_buckets - num_of_dense_buckets, &low));
+    }
+
+    std::vector<uint16_t> pilots;       // the pilot of each bucket
+    std::vector<uint32_t> remapped;     // the position (< n) of each position >= n, for the keys placed there
+    std::vector<K> keys;                // keys[position(key)] = key
+    std::vector<V> values;              // values[position(key)] = the value of key
+    uint64_t seed;
+    std::size_t num_of_buckets;
+    std::size_t num_of_dense_buckets;
+    std::size_t num_of_positions;       // n / alpha
+};
+
+
+/// <summary>
+/// Build the index of the given (unique) keys and their values: place the buckets from the largest one (search of each bucket's
+/// pilot), remap the positions >= n, then store the keys and values at their positions. A seed whose buckets can not all be
+/// placed with 16 bits pilots is replaced by another one.
+/// </summary>
+/// <returns>false if no seed of PERFECT_HASH_MAX_ITERATIONS could be placed (the index is then empty)</returns>
+template<typename K, typename V>
+bool PerfectHashIndex<K, V>::build(const std::vector<K>& keys, const std::vector<V>& values) {
+    std::size_t n = keys.size();
+    this->keys.clear();
+    this->values.clear();
+    pilots.clear();
+    remapped.clear();
+    if (n == 0) {
+        return true;
+    }
+    double log2_n = std::max(1.0, std::log2(double(n)));
+    num_of_buckets = std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(PERFECT_HASH_BUCKET_FACTOR * n / log2_n)));
+    num_of_dense_buckets = std::max<std::size_t>(1, static_cast<std::size_t>(PERFECT_HASH_DENSE_BUCKETS * num_of_buckets));
+    num_of_positions = std::max<std::size_t>(n, static_cast<std::size_t>(std::ceil(n / PERFECT_HASH_LOAD_FACTOR)));
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<uint32_t> bucket_starts(num_of_buckets + 1);
+    std::vector<uint32_t> bucket_keys(n);           // the indices of the keys, grouped by bucket
+    std::vector<uint32_t> bucket_order(num_of_buckets);
+    std::vector<uint32_t> key_positions(n);
+    std::vector<uint8_t> taken(num_of_positions);
+    std::vector<std::size_t> candidate_positions;
+    uint64_t seed_state = PERFECT_HASH_SEED_STATE;
+
+    for (std::size_t iteration = 0; iteration < PERFECT_HASH_MAX_ITERATIONS; ++iteration) {
+        seed = splitMix64(&seed_state);
+        pilots.assign(num_of_buckets, 0);
+        std::fill(taken.begin(), taken.end(), 0);
+
+        // Group the keys by bucket (counting sort), and order the buckets by decreasing size
+        std::fill(bucket_starts.begin(), bucket_starts.end(), 0);
+        std::size_t max_bucket_size = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            hashes[i] = hashOf(keys[i]);
+            ++bucket_starts[bucketOf(hashes[i]) + 1];
+        }
+        for (std::size_t b = 0; b < num_of_buckets; ++b) {
+            max_bucket_size = std::max<std::size_t>(max_bucket_size, bucket_starts[b + 1]);
+            bucket_starts[b + 1] += bucket_starts[b];
+        }
+        std::vector<uint32_t> next(bucket_starts.begin(), bucket_starts.end() - 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            bucket_keys[next[bucketOf(hashes[i])]++] = static_cast<uint32_t>(i);
+        }
+        std::vector<uint32_t> size_starts(max_bucket_size + 2, 0);
+        for (std::size_t b = 0; b < num_of_buckets; ++b) {
+            ++size_starts[max_bucket_size - (bucket_starts[b + 1] - bucket_starts[b]) + 1];
+        }
+        for (std::size_t s = 0; s <= max_bucket_size; ++s) {
+            size_starts[s + 1] += size_starts[s];
+        }
+        for (std::size_t b = 0; b < num_of_buckets; ++b) {
+            bucket_order[size_starts[max_bucket_size - (bucket_starts[b + 1] - bucket_starts[b])]++] = static_cast<uint32_t>(b);
+        }
+
+        // Search the pilot of each bucket, from the largest one
+        bool placed = true;
+        for (uint32_t bucket : bucket_order) {
+            std::size_t begin = bucket_starts[bucket], end = bucket_starts[bucket + 1];
+            if (begin == end) {
+                break;      // the buckets are ordered by size: the rest are empty
+            }
+            bool found = false;
+            for (uint64_t pilot = 0; pilot <= PERFECT_HASH_MAX_PILOT && !found; ++pilot) {
+                uint64_t pilot_hash = murmur64(pilot ^ seed);
+                candidate_positions.clear();
+                found = true;
+                for (std::size_t j = begin; j < end && found; ++j) {
+                    uint64_t low = 0;
+                    std::size_t pos = static_cast<std::size_t>(multiply128(murmur64(hashes[bucket_keys[j]] ^ PERFECT_HASH_POSITION_SALT) ^ pilot_hash,
+                                                                           num_of_positions, &low));
+                    found = !taken[pos] && std::find(candidate_positions.begin(), candidate_positions.end(), pos) == candidate_positions.end();
+                    candidate_positions.push_back(pos);
+                }
+                if (found) {
+                    pilots[bucket] = static_cast<uint16_t>(pilot);
+                    for (std::size_t j = begin; j < end; ++j) {
+                        std::size_t pos = candidate_positions[j - begin];
+                        taken[pos] = 1;
+                        key_positions[bucket_keys[j]] = static_cast<uint32_t>(pos);
+                    }
+                }
+            }
+            if (!found) {
+                placed = false;
+                break;
+            }
+        }
+        if (!placed) {
+            continue;
+        }
+
+        // Remap the positions >= n to the free positions < n (as many as the taken positions >= n), in increasing order
+        remapped.assign(num_of_positions - n, 0);
+        std::size_t free_position = 0;
+        for (std::size_t pos = n; pos < num_of_positions; ++pos) {
+            if (taken[pos]) {
+                while (taken[free_position]) {
+                    ++free_position;
+                }
+                remapped[pos - n] = static_cast<uint32_t>(free_position++);
+            }
+        }
+        this->keys.resize(n);
+        this->values.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t pos = key_positions[i];
+            pos = (pos < n) ? pos : remapped[pos - n];
+            this->keys[pos] = keys[i];
+            this->values[pos] = values[i];
+        }
+        return true;
+    }
+    pilots.clear();
+    remapped.clear();
+    return false;
+}
+
+#endif // _PERFECT_HASH_INDEX_H
@@ -0,0 +1,80 @@
+#ifndef _RULE_POOL_H
+#define _RULE_POOL_H
+
+#include "Span.h"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#define FNV1A_OFFSET_BASIS_UINT64_T 0xcbf29ce484222325
+#define FNV1A_PRIME_UINT64_T 0x100000001b3
+
+
+/// <summary>
+/// FNV-1a hash of a byte range. Used for interning rule lists and as the checksum of a compiled ruleset.
+/// </summary>
+uint64_t fnv1a(const uint8_t* data, std::size_t length, uint64_t hash = FNV1A_OFFSET_BASIS_UINT64_T) {
+	for (std::size_t i = 0; i < length; ++i) {
+		hash ^= data[i];
+		hash *= FNV1A_PRIME_UINT64_T;
+	}
+	return hash;
+}
+
+
+/// <summary>
+/// A pool of rule lists (sorted SIDs), stored back to back in a single CSR-style array.
+/// Identical lists are interned: many exact matches share the very same SID list, and all of them get the same handle.
+/// </summary>
+class RulePool {
+public:
+	RulePool() : rule_offsets(1, 0) {}
+
+	uint32_t intern(const uint32_t* rules, std::size_t count);
+	void clear();
+
+	Span<uint32_t> getRules(uint32_t handle) const {
+		return Span<uint32_t>(rule_ids.data() + rule_offsets[handle], rule_offsets[handle + 1] - rule_offsets[handle]);
+	}
+	std::size_t size() const { return rule_offsets.size() - 1; }		// number of (unique) rule lists
+	const uint32_t* offsets() const { return rule_offsets.data(); }	// size() + 1 offsets into ids()
+	const uint32_t* ids() const { return rule_ids.data(); }
+
+private:
+	std::vector<uint32_t> rule_offsets;
+	std::vector<uint32_t> rule_ids;
+	std::unordered_multimap<uint64_t, uint32_t> index;		// hash of a rule list -> handle(s) of the list(s) with this hash
+};
+
+/// <summary>
+/// Add a rule list to the pool, unless an identical list is already in it.
+/// </summary>
+/// <param name="rules">The rule list, sorted and without duplicates</param>
+/// <param name="count">The number of rules in the list</param>
+/// <returns>The handle of the (interned) rule list</returns>
+uint32_t RulePool::intern(const uint32_t* rules, std::size_t count) {
+	uint64_t hash = fnv1a(reinterpret_cast<const uint8_t*>(rules), count * sizeof(uint32_t));
+	auto range = index.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		Span<uint32_t> existing = getRules(it->second);
+		if (existing.size() == count && std::equal(existing.begin(), existing.end(), rules)) {
+			return it->second;
+		}
+	}
+
+	uint32_t handle = static_cast<uint32_t>(size());
+	rule_ids.insert(rule_ids.end(), rules, rules + count);
+	rule_offsets.push_back(static_cast<uint32_t>(rule_ids.size()));
+	index.emplace(hash, handle);
+	return handle;
+}
+
+void RulePool::clear() {
+	rule_offsets.assign(1, 0);
+	rule_ids.clear();
+	index.clear();
+}
+
+#endif // _RULE_POOL_H
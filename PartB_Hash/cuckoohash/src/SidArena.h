@@ -0,0 +1,193 @@
+#ifndef _SID_ARENA_H
+#define _SID_ARENA_H
+
+#include "Span.h"
+#include "RulePool.h"
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+#if defined __GLIBC__
+#include <malloc.h>
+#define SID_ARENA_HAS_MALLOC_USABLE_SIZE
+#endif
+
+#define SID_ARENA_NO_OFFSET 0xffffffff
+#define SID_ARENA_MIN_CAPACITY 1024		// in words
+
+
+/// <summary>
+/// The lists of SIDs of the table entries, packed in a single block of 32 bits words: each list is its length followed by its
+/// SIDs, and is referred to by the 32 bits offset (in words) of its length. An offset is the value of a table entry, i.e. the
+/// "pointer" of the x32 memory model: a hit reads its list with one indirection, and the arena has no per-list allocations.
+/// The entries sharing a list (the same RulePool handle) share its copy in the arena.
+/// An arena can also read the words of lists it does not own (attach(), e.g. a snapshot file mapped read-only).
+/// The block grows by doubling; an arena which grows exactly reallocates it to its used words at every change instead, so its
+/// residentBytes() are at any time the bytes its lists need (e.g. to hold a byte budget, see runTests).
+/// </summary>
+class SidArena {
+public:
+	explicit SidArena(bool grows_exactly = false) : block(nullptr), used_words(0), capacity_words(0), is_attached(false),
+		grows_exactly(grows_exactly) {}
+	~SidArena() { release(); }
+	SidArena(const SidArena&) = delete;
+	SidArena& operator=(const SidArena&) = delete;
+
+	uint32_t add(Span<uint32_t> sids);
+	uint32_t add(const RulePool& rule_pool, uint32_t handle);
+	void undoAdd(uint32_t handle);
+	void shrinkToFit();
+	void attach(const uint32_t* words, std::size_t num_of_words);
+
+	Span<uint32_t> getSids(uint32_t offset) const {
+		return Span<uint32_t>(block + offset + 1, block[offset]);
+	}
+	const uint32_t* data() const { return block; }								// the words of the lists (sizeWords() words)
+	std::size_t sizeWords() const { return used_words; }
+	std::size_t sizeBytes() const { return used_words * sizeof(uint32_t); }		// bytes used by the lists
+	std::size_t residentBytes() const;											// bytes allocated for the lists
+
+private:
+	void reserve(std::size_t min_words);
+	void release();
+
+	uint32_t* block;
+	std::size_t used_words;
+	std::size_t capacity_words;
+	bool is_attached;						// block is not owned (and not written)
+	bool grows_exactly;
+	std::vector<uint32_t> pool_offsets;		// offset of the list of each RulePool handle already added (bookkeeping of the build)
+};
+
+/// <summary>
+/// Append a list of SIDs to the arena.
+/// </summary>
+/// <returns>The offset of the list</returns>
+uint32_t SidArena::add(Span<uint32_t> sids) {
+	if (is_attached) {
+		throw std::logic_error("Lists can not be added to an attached SID arena.");
+	}
+	std::size_t offset = used_words;
+	if (offset + 1 + sids.size() > SID_ARENA_NO_OFFSET) {
+		throw std::length_error("The SID arena exceeds 32 bits offsets.");
+	}
+	reserve(offset + 1 + sids.size());
+	block[offset] = static_cast<uint32_t>(sids.size());
+	std::copy(sids.begin(), sids.end(), block + offset + 1);
+	used_words += 1 + sids.size();
+	return static_cast<uint32_t>(offset);
+}
+
+/// <summary>
+/// Append the list of a RulePool handle to the arena, unless it was already added (then its offset is shared).
+/// </summary>
+/// <returns>The offset of the list</returns>
+uint32_t SidArena::add(const RulePool& rule_pool, uint32_t handle) {
+	if (handle >= pool_offsets.size()) {
+		pool_offsets.resize(rule_pool.size(), SID_ARENA_NO_OFFSET);
+	}
+	if (pool_offsets[handle] == SID_ARENA_NO_OFFSET) {
+		pool_offsets[handle] = add(rule_pool.getRules(handle));
+	}
+	return pool_offsets[handle];
+}
+
+/// <summary>
+/// Remove the list of a RulePool handle, which must be the last list added (e.g. a list which did not fit a byte budget).
+/// </summary>
+void SidArena::undoAdd(uint32_t handle) {
+	if (is_attached || handle >= pool_offsets.size() || pool_offsets[handle] == SID_ARENA_NO_OFFSET) {
+		return;
+	}
+	used_words = pool_offsets[handle];
+	pool_offsets[handle] = SID_ARENA_NO_OFFSET;
+	if (used_words == 0) {
+		std::free(block);
+		block = nullptr;
+		capacity_words = 0;
+	}
+	else if (grows_exactly) {
+		// A new block, rather than realloc: a shrunk block may keep more than its words (as the block was before the list)
+		uint32_t* shrunk = static_cast<uint32_t*>(std::malloc(used_words * sizeof(uint32_t)));
+		if (shrunk != nullptr) {
+			std::copy(block, block + used_words, shrunk);
+			std::free(block);
+			block = shrunk;
+			capacity_words = used_words;
+		}
+	}
+}
+
+/// <summary>
+/// Release the unused capacity of the block (once all the lists are added).
+/// </summary>
+void SidArena::shrinkToFit() {
+	if (is_attached || used_words == 0 || used_words == capacity_words) {
+		return;
+	}
+	uint32_t* shrunk = static_cast<uint32_t*>(std::realloc(block, used_words * sizeof(uint32_t)));
+	if (shrunk != nullptr) {
+		block = shrunk;
+		capacity_words = used_words;
+	}
+}
+
+/// <summary>
+/// Read the lists from words the arena does not own (the data() of an arena, which must outlive this one).
+/// The arena's own lists are released.
+/// </summary>
+void SidArena::attach(const uint32_t* words, std::size_t num_of_words) {
+	release();
+	block = const_cast<uint32_t*>(words);		// never written while attached
+	used_words = num_of_words;
+	capacity_words = num_of_words;
+	is_attached = true;
+}
+
+void SidArena::release() {
+	if (!is_attached) {
+		std::free(block);
+	}
+	block = nullptr;
+	used_words = 0;
+	capacity_words = 0;
+	is_attached = false;
+	pool_offsets.clear();
+}
+
+/// <summary>
+/// The bytes actually allocated for the block, as reported by the allocator when it can (glibc), else its capacity.
+/// An attached arena allocates nothing.
+/// </summary>
+std::size_t SidArena::residentBytes() const {
+	if (block == nullptr || is_attached) {
+		return 0;
+	}
+#if defined SID_ARENA_HAS_MALLOC_USABLE_SIZE
+	return malloc_usable_size(block);
+#else
+	return capacity_words * sizeof(uint32_t);
+#endif
+}
+
+void SidArena::reserve(std::size_t min_words) {
+	if (min_words <= capacity_words) {
+		return;
+	}
+	std::size_t new_capacity = grows_exactly ? min_words : std::max<std::size_t>(SID_ARENA_MIN_CAPACITY, capacity_words);
+	while (new_capacity < min_words) {
+		new_capacity *= 2;
+	}
+	uint32_t* grown = static_cast<uint32_t*>(std::realloc(block, new_capacity * sizeof(uint32_t)));
+	if (grown == nullptr) {
+		throw std::bad_alloc();
+	}
+	block = grown;
+	capacity_words = new_capacity;
+}
+
+#endif // _SID_ARENA_H
@@ -0,0 +1,30 @@
+#ifndef _SPAN_H
+#define _SPAN_H
+
+#include <cstddef>
+
+
+/// <summary>
+/// A non-owning, read-only view of a contiguous range of T (a minimal stand-in for C++20's std::span).
+/// Used to hand out patterns and rule lists straight from their storage, without copying them.
+/// </summary>
+/// <typeparam name="T">Type of the viewed elements {uint8_t for pattern bytes, uint32_t for SIDs, ...}</typeparam>
+template<typename T>
+class Span {
+public:
+	Span() : ptr(nullptr), count(0) {}
+	Span(const T* ptr, std::size_t count) : ptr(ptr), count(count) {}
+
+	const T* data() const { return ptr; }
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const T* begin() const { return ptr; }
+	const T* end() const { return ptr + count; }
+	const T& operator[](std::size_t i) const { return ptr[i]; }
+
+private:
+	const T* ptr;
+	std::size_t count;
+};
+
+#endif // _SPAN_H
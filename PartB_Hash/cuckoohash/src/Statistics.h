@@ -7,20 +7,87 @@
 #include <map>
 #include <set>
 #include <cstdio>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include "LatencyHistogram.h"
+#include "CuckooCounters.h"
+
+
+/// <summary>
+/// The json object of the percentiles of a latency histogram: {"count", "p50", "p90", "p99", "p99_9", "max"} (in [ns]).
+/// </summary>
+inline nlohmann::json latencyToJson(const LatencySummary& latency) {
+    return {
+        {"count", latency.count},
+        {"p50", latency.p50},
+        {"p90", latency.p90},
+        {"p99", latency.p99},
+        {"p99_9", latency.p999},
+        {"max", latency.max}
+    };
+}
+
+/// <summary>
+/// Add the cuckoo insertion counters (summed over the trials) to a json object: displacements per insertion, max / histogram of
+/// the cuckoo path lengths, failed insertions, resizes, and the displacements per insertion for each 5% of load factor.
+/// </summary>
+inline void cuckooCountersToJson(const CuckooCounters& counters, nlohmann::json& dataItem) {
+    std::vector<double> displacements_by_load_factor;
+    for (std::size_t i = 0; i < CUCKOO_COUNTERS_LOAD_FACTOR_BINS; ++i) {
+        std::size_t inserts = counters.inserts_by_load_factor[i];
+        displacements_by_load_factor.push_back(inserts ? double(counters.displacements_by_load_factor[i]) / inserts : 0);
+    }
+    dataItem["displacements_per_insert"] = counters.inserts ? double(counters.displacements) / counters.inserts : 0;
+    dataItem["max_path_length"] = counters.max_path_length;
+    dataItem["path_lengths"] = counters.path_lengths;
+    dataItem["failed_inserts"] = counters.failed_inserts;
+    dataItem["resizes"] = counters.resizes;
+    dataItem["rehashed_elements"] = counters.rehashed_elements;
+    dataItem["displacements_per_insert_by_load_factor"] = displacements_by_load_factor;
+}
 
 
 struct TestStatistics {
 public:
     std::size_t hash_table_size;                    // an std::size_t represents the size (in [KB]) allocated to the hash table tested
     std::size_t additional_size;                    // an std::size_t represents the additional size (in [KB]) allocated for the lists of SID for each entry of the hash table.
+    std::size_t measured_additional_size;           // an std::size_t represents the size (in [KB]) actually allocated for the lists of SID, packed in a SidArena
     double load_factor;                             // a double represents the load factor of the hash table in the end of the test
     double avg_number_of_rules_inserted;            // a double represents the average number of rules inserted to the hash table
     double percentage_of_rules_inserted;            // a double represents the percentage of rules inserted to the hash table
     double avg_number_of_substrings_inserted;       // a double represents the average number of substrings inserted to the hash table
     double percentage_of_all_substrings_inserted;   // a double represents the percentage of substrings inserted to the hash table
-    double hash_power;                              // a double represents the pre-determined of the hash table tested (0 = not restricted)
+    double hash_power;                              // a double represents the pre-determined (maximum) hashpower of the hash table tested (0 = not restricted)
     double average_run_time;                        // a double represents the average run time (in [ms]) of the test
+    double bytes_per_key;                           // a double represents the size (in Bytes) of the hash table per key inserted
+    double false_positive_rate;                     // a double represents the rate of keys not inserted found in the table (fingerprints only, before their verification)
+    double lookup_throughput;                       // a double represents the lookups per second (in [M lookups/s]) of the table
+    std::size_t fingerprint_bits;                   // an std::size_t represents the bits of a fingerprint of a cuckoo filter table (0 = the table stores full keys)
+    std::size_t slot_per_bucket;                    // an std::size_t represents the number of slots in a bucket (associativity) of the hash table
+    LatencySummary insert_latency;                  // percentiles (in [ns]) of the latency of an insertion, over all the trials
+    LatencySummary lookup_latency;                  // percentiles (in [ns]) of the latency of a lookup, over all the trials
+    CuckooCounters cuckoo_counters;                 // the displacements, cuckoo paths, failed insertions and resizes of the insertions, summed over all the trials
+    std::size_t measured_table_bytes;               // an std::size_t represents the size (in Bytes) actually allocated for the hash table (buckets and locks), on average
+    std::size_t measured_additional_bytes;          // an std::size_t represents the size (in Bytes) actually allocated for the lists of SID, on average
+};
+
+struct TrialResult {
+public:
+    double max_load_factor;                         // the maximal load factor of the hash table during the trial
+    std::size_t substrings_inserted;                // number of substrings inserted to the hash table
+    std::size_t unique_rules_covered;               // number of rules with at least one of their substrings in the hash table
+    std::size_t additional_size_bytes;              // size (in Bytes) of the lists of SID for the entries of the hash table
+    std::size_t measured_additional_size_bytes;     // size (in Bytes) actually allocated for these lists in a SidArena
+    std::size_t table_bytes;                        // size (in Bytes) of the hash table in the end of the trial
+    std::size_t measured_table_bytes;               // size (in Bytes) actually allocated for the hash table in the end of the trial, as counted by its allocator
+    std::size_t hash_power;                         // the hashpower of the hash table (it may not grow past it)
+    std::size_t num_of_lookups;                     // number of keys looked up in the hash table once built
+    double lookup_time;                             // time (in [s]) of these lookups
+    std::size_t num_of_hits;                        // number of these lookups which found their key (keeps the timed lookups from being optimized away)
+    double runtime;                                 // run time (in [ms]) of the trial (insertions, without the lookups)
+    LatencyHistogram insert_latency;                // latency (in [ns]) of each insertion
+    LatencyHistogram lookup_latency;                // latency (in [ns]) of each lookup
+    CuckooCounters cuckoo_counters;                 // the displacements, cuckoo paths, failed insertions and resizes of the insertions
 };
 
 /// <summary>
@@ -33,8 +100,10 @@ public:
 
     /// <summary>
     /// Usage: 
-    ///     stats.addData({hash_table_size, load_factor, avg_number_of_rules_inserted, percentage_of_rules_inserted,            
-    ///         avg_number_of_substrings_inserted, percentage_of_all_substrings_inserted, hash_power, average_run_time});
+    ///     stats.addData({hash_table_size, additional_size, measured_additional_size, load_factor, avg_number_of_rules_inserted, percentage_of_rules_inserted,            
+    ///         avg_number_of_substrings_inserted, percentage_of_all_substrings_inserted, hash_power, average_run_time,
+    ///         bytes_per_key, false_positive_rate, lookup_throughput, fingerprint_bits, slot_per_bucket, insert_latency, lookup_latency, cuckoo_counters,
+    ///         measured_table_bytes, measured_additional_bytes});
     /// </summary>
     /// <param name="testStatistics">A struct to contain the logged test statistics.</param>
     void addData(const TestStatistics& testStatistics) {
@@ -48,6 +117,9 @@ public:
             nlohmann::json dataItem;
             dataItem["hash_table_size"] = test.hash_table_size;
             dataItem["additional_size"] = test.additional_size;
+            dataItem["additional_size_measured"] = test.measured_additional_size;
+            dataItem["hash_table_bytes_measured"] = test.measured_table_bytes;
+            dataItem["additional_bytes_measured"] = test.measured_additional_bytes;
             dataItem["load_factor"] = test.load_factor;
             dataItem["number_of_rules_inserted"] = test.avg_number_of_rules_inserted;
             dataItem["percentage_of_rules_inserted"] = test.percentage_of_rules_inserted;
@@ -55,6 +127,14 @@ public:
             dataItem["percentage_of_all_substrings_inserted"] = test.percentage_of_all_substrings_inserted;
             dataItem["hash_power"] = test.hash_power;
             dataItem["average_run_time"] = test.average_run_time;
+            dataItem["bytes_per_key"] = test.bytes_per_key;
+            dataItem["false_positive_rate"] = test.false_positive_rate;
+            dataItem["lookup_throughput"] = test.lookup_throughput;
+            dataItem["fingerprint_bits"] = test.fingerprint_bits;
+            dataItem["slot_per_bucket"] = test.slot_per_bucket;
+            dataItem["insert_latency_ns"] = latencyToJson(test.insert_latency);
+            dataItem["lookup_latency_ns"] = latencyToJson(test.lookup_latency);
+            cuckooCountersToJson(test.cuckoo_counters, dataItem);
             jsonData.push_back(dataItem);
         }
 
@@ -80,14 +160,19 @@ private:
 struct SearchResults {
 public:
     std::string search_key;                         // an std::string represents a search pattern that could be assosiated with a specific SID
+    std::vector<uint8_t> payload;                   // the search pattern's bytes (search_key decoded), which are the bytes actually scanned
     std::vector<int> original_sids;                 // a vector of integers that represent the Snort IDs of the wanted rules to search
     std::map<int,int> sids_hit;                     // a histogram of pairs (sid, number of hits)
     std::size_t size;                               // an std::size_t that represents the size of the data structure in Bytes
     std::size_t full_list_size;                     // number of bytes required to store all rules' SID(s) for all entries in the data structure
+    std::size_t full_list_size_measured;            // number of bytes actually allocated for the rules' SID(s) of all entries, packed in a SidArena
     std::size_t iblt_size_optimal;                  // number of bytes required for an iblt that ensures optimal success rate restoring all the rules for all entries in the data structure
     std::size_t iblt_size_100_rate;                 // number of bytes required for an iblt that ensures 100 success rate restoring all the rules for all entries in the data structure
     std::size_t iblt_size_99_rate;                  // number of bytes required for an iblt that ensures 99 success rate restoring all the rules for all entries in the data structure
     std::size_t iblt_size_95_rate;                  // number of bytes required for an iblt that ensures 95 success rate restoring all the rules for all entries in the data structure
+    double scan_ns;                                 // time (in [ns]) of the scan of the payload
+    LatencySummary insert_latency;                  // percentiles (in [ns]) of the latency of an insertion while building the data structure
+    LatencySummary lookup_latency;                  // percentiles (in [ns]) of the latency of a lookup of a (unique) window of the payload
 
 };
 
@@ -118,10 +203,14 @@ public:
             dataItem["sids_hit"] = data.sids_hit;
             dataItem["size"] = data.size;
             dataItem["additional_size_full_list"] = data.full_list_size;
+            dataItem["additional_size_measured"] = data.full_list_size_measured;
             dataItem["additional_size_iblt_optimal"] = data.iblt_size_optimal;
             dataItem["additional_size_iblt_success_rate_100"] = data.iblt_size_100_rate;
             dataItem["additional_size_iblt_success_rate_99"] = data.iblt_size_99_rate;
             dataItem["additional_size_iblt_success_rate_95"] = data.iblt_size_95_rate;
+            dataItem["scan_ns"] = data.scan_ns;
+            dataItem["insert_latency_ns"] = latencyToJson(data.insert_latency);
+            dataItem["lookup_latency_ns"] = latencyToJson(data.lookup_latency);
             jsonData.push_back(dataItem);
         }
 
@@ -146,7 +235,7 @@ private:
 
 struct SubstringData {
 public:
-    std::size_t uint_representation;        // an std::size_t of the substring unsigned int value
+    std::size_t uint_representation;        // an std::size_t of the substring unsigned int value (its lower 8 bytes for substrings longer than 8 bytes)
     std::string hex_representation;         // an std::string of the substring in hex representation
     std::string full_representation;        // an std::string of the substring in full representation 
     std::size_t num_of_duplicates;          // an std::size_t of the number of same substrings duplicates removed
@@ -203,4 +292,40 @@ private:
 };
 
 
+/// <summary>
+/// Class dedicated to store the results of the micro benchmarks (see bench.cpp) to a .json file.
+/// Each benchmark mode logs one json object per measurement (its fields depend on the benchmark).
+/// </summary>
+class BenchmarkLog {
+public:
+    BenchmarkLog() : data(nlohmann::json::array()) {}
+
+    /// <summary>
+    /// Usage: 
+    ///     bench_log.addData({{"L", L}, {"lookup_ns", lookup_ns}, ...});
+    /// </summary>
+    /// <param name="item">A json object of the logged measurement.</param>
+    void addData(const nlohmann::json& item) {
+        data.push_back(item);
+    }
+
+    void writeToFile(const std::string& path, const std::string& filename) {
+        // Print the JSON object to a file
+        std::string file_path = path + "/" + filename;
+        std::ofstream outputFile(file_path);
+        if (outputFile.is_open()) {
+            outputFile << std::setw(4) << data; // Print with indentation of 4 spaces (= 1 tab)
+            outputFile.close();
+            std::cout << "Benchmark results have been written to " << file_path << " successfully." << std::endl;
+        }
+        else {
+            std::cerr << "Unable to open file " << file_path << "." << std::endl;
+        }
+    }
+
+private:
+    nlohmann::json data;
+};
+
+
 #endif // _STATISTICS_H
@@ -1,43 +1,48 @@
 #ifndef _SUBSTRING_H
 #define _SUBSTRING_H
 
+#include "RulePool.h"
+#include "SubstringKey.h"
+#include "Span.h"
 #include <string>
-#include <set>
+#include <type_traits>
 #include <vector>
 #include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
 #define SUBSTRING_DEFAULT_GAP 1
 
 
 /// <summary>
-/// A string of L=sizeof(T) chars, represented as an unsigned int
+/// A string of L <= sizeof(T) chars, represented as an unsigned int (masked: when L < sizeof(T) the upper bytes are zero, see SubstringKey)
+/// The rules of the substring are not owned by it: rules is a handle of the substring's rule list in a RulePool shared by all the substrings,
+/// so a Substring is a small, trivially copyable value (copying, moving or shuffling it never allocates).
 /// </summary>
 /// <typeparam name="T">
 ///	T the type of the unsigned int which will represent the substring, 
-/// the caller must use an unsigned int which correlates to the L chosen,
-/// i.e., T = { uint8_t, uint16_t, uint32_t, uint64_t,... } for L = { 1, 2, 4, 8,... } respectively.
+/// the caller must use an unsigned int which holds the L chosen, i.e. SubstringKey<L>::type:
+/// T = { uint16_t, uint32_t, uint64_t, uint128_t } for L = { 1-2, 3-4, 5-8, 9-16 } respectively.
 /// </typeparam>
 template <typename T>
 class Substring {
 public:
 	T substring;
-	std::set<int>* rules;
+	uint32_t rules;			// handle of the rule list (in the substrings' RulePool)
 
-	Substring(const std::string hexString, const std::set<int>& rules);
-	Substring(const T& substring, const std::set<int>& rules);
-	Substring(const Substring<T>& other);
-	Substring();
-	~Substring();
+	Substring(const std::string& hexString, uint32_t rules = 0);
+	Substring(const T& substring, uint32_t rules = 0) : substring(substring), rules(rules), num_of_dups(0) {}
+	Substring() : substring(0), rules(0), num_of_dups(0) {}
 
 	T getSubstring() const { return this->substring; }
 	void setSubstring(T substring) { this->substring = substring; }
+	uint32_t getRules() const { return this->rules; }
+	void setRules(uint32_t rules) { this->rules = rules; }
 	std::size_t getNumOfDups() const { return this->num_of_dups; }
 	void logDuplicate() { this->num_of_dups++; }
 	
-	Substring<T>& operator=(const Substring<T>& other);
 	bool operator<(const Substring<T>& other) const;
 	bool operator>(const Substring<T>& other) const;
 	bool operator>=(const Substring<T>& other) const;
@@ -45,16 +50,18 @@ public:
 	bool operator==(const Substring<T>& other) const;
 	bool operator!=(const Substring<T>& other) const;
 
-	std::string toStringHex() const;
-	std::string str() const;
-	std::string toStringFull() const;
+	std::string toStringHex(std::size_t L = sizeof(T)) const;
+	std::string str(std::size_t L = sizeof(T)) const;
+	std::string toStringFull(std::size_t L = sizeof(T)) const;
 	template<class S> friend std::ostream& operator<<(std::ostream& os, const Substring<S>& substring);
 
-	static void extractSubstrings(const std::string& hexString, std::vector<Substring<T>>& substrings,
-		const std::set<int>& rules, std::size_t G = SUBSTRING_DEFAULT_GAP, std::size_t L = sizeof(T), bool tolower = false);
+	static void extractSubstrings(const std::string& hexString, std::vector<Substring<T>>& substrings, RulePool& rule_pool,
+		Span<uint32_t> rules, std::size_t G = SUBSTRING_DEFAULT_GAP, std::size_t L = sizeof(T), bool tolower = false);
+	static void extractSubstrings(const uint8_t* bytes, std::size_t length, std::vector<Substring<T>>& substrings, RulePool& rule_pool,
+		Span<uint32_t> rules, std::size_t G = SUBSTRING_DEFAULT_GAP, std::size_t L = sizeof(T), bool tolower = false);
 	
 private:
-	std::size_t num_of_dups;
+	uint32_t num_of_dups;
 	static uint8_t hexCharToInt(const char hexChar);
 };
 
@@ -72,70 +79,16 @@ private:
 /// The respective T substring would be: 0b0111001101101110011011110111001001110100 = 8581144067694250176.
 /// </summary>
 /// <param name="hexString">A string of sizeof(T) or less bytes represented in hex (for example: "0x736E6F7274" for "snort").</param>
-/// <param name="rules">A set of integers representing the rule nubmers that match this substring.</param>
+/// <param name="rules">The handle of the list of rule numbers that match this substring.</param>
 template<typename T>
-Substring<T>::Substring(const std::string hexString, const std::set<int>& rules) : num_of_dups(0) {
-	this->substring = 0;
+Substring<T>::Substring(const std::string& hexString, uint32_t rules) : substring(0), rules(rules), num_of_dups(0) {
 	std::size_t len = hexString.size();
 	for (std::size_t i = 0; i < len; i++) {
 		// since a char in hexString is only 1 hex, it is half a byte => 4 bits shift only
 		this->substring = (this->substring << 4) | hexCharToInt(hexString[i]);
 	}
-	this->rules = new std::set<int>(rules);
 }
 
-template<typename T>
-Substring<T>::Substring(const T& substring, const std::set<int>& rules) : substring(substring), num_of_dups(0) {
-	this->rules = new std::set<int>(rules);
-}
-
-
-/// <summary>
-/// Copy C'tor. Must have for correct copying of substrings to a set / a vector (deep copy and not ptr value only).
-/// </summary>
-/// <typeparam name="T"></typeparam>
-/// <param name="other"></param>
-template<typename T>
-Substring<T>::Substring(const Substring<T>& other) : substring(other.substring), num_of_dups(other.num_of_dups) {
-	this->rules = new std::set<int>(*other.rules);
-}
-
-
-// use for debug and testing, remove before release
-template<typename T>
-Substring<T>::Substring() : substring(0), num_of_dups(0) {
-	this->rules = new std::set<int>();
-}
-
-template<typename T>
-Substring<T>::~Substring() {
-	delete this->rules;
-	this->rules = nullptr;
-}
-
-template<typename T>
-Substring<T>& Substring<T>::operator=(const Substring<T>& other) {
-	if (this != &other) {
-		this->substring = other.substring;
-		this->num_of_dups = other.num_of_dups;
-		if (this->rules != nullptr) {
-			delete this->rules;
-		}
-		this->rules = new std::set<int>(*other.rules);
-	}
-	return *this;
-}
-
-/* template<typename T>
-Substring<T>& Substring<T>::operator=(const Substring<T>& other) {
-	if (this->substring != other.substring) {
-		this->substring = other.substring;
-		this->rules->clear();	// clearing rules only if they were different
-	}							// otherwise we want to append the added rules
-	this->rules->insert(other.rules->begin(), other.rules->end());
-	return *this;
-} */
-
 template<typename T>
 bool Substring<T>::operator<(const Substring<T>& other) const {
 	return this->substring < other.substring;
@@ -167,9 +120,9 @@ bool Substring<T>::operator!=(const Substring<T>& other) const {
 }
 
 template<typename T>
-std::string Substring<T>::toStringHex() const {
+std::string Substring<T>::toStringHex(std::size_t L) const {
 	std::ostringstream oss;
-	std::size_t iterations = sizeof(T);
+	std::size_t iterations = std::min(L, sizeof(T));
 	oss << "0x";
 	for (std::size_t i = iterations; i > 0; --i) {
 		uint8_t current_byte = (this->substring >> ((i - 1) * 8)) & 0xFF;
@@ -179,9 +132,9 @@ std::string Substring<T>::toStringHex() const {
 }
 
 template<typename T>
-std::string Substring<T>::str() const {
+std::string Substring<T>::str(std::size_t L) const {
 	std::ostringstream oss;
-	std::size_t iterations = sizeof(T);
+	std::size_t iterations = std::min(L, sizeof(T));
 	for (std::size_t i = iterations; i > 0; --i) {
 		uint8_t current_byte = (this->substring >> ((i - 1) * 8)) & 0xFF;
 		if (std::isprint(current_byte)) {
@@ -195,9 +148,9 @@ std::string Substring<T>::str() const {
 }
 
 template<typename T>
-std::string Substring<T>::toStringFull() const {
+std::string Substring<T>::toStringFull(std::size_t L) const {
 	std::ostringstream oss;
-	std::size_t iterations = sizeof(T);
+	std::size_t iterations = std::min(L, sizeof(T));
 	for (std::size_t i = iterations; i > 0; --i) {
 		uint8_t current_byte = (this->substring >> ((i - 1) * 8)) & 0xFF;
 		oss << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(current_byte) << " ('";
@@ -229,53 +182,28 @@ std::ostream& operator<<(std::ostream& os, const Substring<T>& substring) {
 /// <typeparam name="T">Type of the substring to be created (uint16_t, uint32_t, uint64_t, ...)</typeparam>
 /// <param name="hexString">The hexString to be processed and split ("0x736E6F7274") </param>
 /// <param name="substrings">The set of Substrings in which the results will be stored</param>
+/// <param name="rule_pool">The RulePool of the substrings, in which the (combined) rule lists will be stored</param>
+/// <param name="rules">The rules of the hexString (empty when extracting the substrings of a search key)</param>
 /// <param name="G">The gap in which the parser advances on the original string (default: G = 1)</param>
 /// <param name="L">The length of each splitted substring (default: L = sizeof(T))</param>
 template <typename T>
-void Substring<T>::extractSubstrings(const std::string& hexString, std::vector<Substring<T>>& substrings, 
-									 const std::set<int>& rules, std::size_t G, std::size_t L, bool tolower) {
+void Substring<T>::extractSubstrings(const std::string& hexString, std::vector<Substring<T>>& substrings, RulePool& rule_pool,
+									 Span<uint32_t> rules, std::size_t G, std::size_t L, bool tolower) {
 	// Defaults for G and L are provided in function's declaration.
 	std::string hexOnlyStr = (hexString.substr(0, 2) == "0x") ? hexString.substr(2) : hexString;
 	std::size_t len = hexOnlyStr.size();
 
-	// Create a new string to hold the lowercase hex representation
-	std::string lowerHexStr;
-	if (tolower) {
-		lowerHexStr.reserve(len); // Reserve space to avoid multiple allocations
-		for (std::size_t i = 0; i < len; i += 2) {
-			std::string byteStr = hexOnlyStr.substr(i, 2);
-			int byteValue = std::stoi(byteStr, nullptr, 16);
-
-			// Check if the byte represents an uppercase letter (A=0x41 to Z=0x5A)
-			if (byteValue >= 'A' && byteValue <= 'Z') {
-				byteValue += 'a' - 'A'; // Convert to lowercase (a=0x61 to z=0x7A)
-			}
-
-			// Convert the byte back to a hex string and append to result
-			std::stringstream ss;
-			ss << std::hex << std::setfill('0') << std::setw(2) << byteValue;
-			lowerHexStr.append(ss.str());
-		}
-	}
-
-	// Jumping by 2*L and 2*G because in hex representation each char = 2 hexDigits.
-	for (std::size_t i = 0; (i < len) && ((i + L * 2) <= len); i += G * 2) {
-		std::string hexSubstring = (tolower) ? lowerHexStr.substr(i, L * 2) : hexOnlyStr.substr(i, L * 2);
-		Substring<T> substring(hexSubstring, rules);
-		auto it = std::find(substrings.begin(), substrings.end(), substring);
-		// check if an equivalent substring is already in the vector
-		if (it != substrings.end()) {	// substring found in vector - it will now represent the combined set of rules.
-			if (rules.size() != 0) {		// used when extracting substrings from a test string (to search in the hash table and not insert)
-				it->rules->insert(rules.begin(), rules.end());
-			}
-			it->logDuplicate();
-		}
-		else {							// substring is not in vector - add substring to vector
-			substrings.push_back(substring);
-		}
+	// Decode the hex representation (2 hex digits per byte) and split the bytes themselves
+	std::vector<uint8_t> bytes;
+	bytes.reserve(len / 2);
+	for (std::size_t i = 0; i + 1 < len; i += 2) {
+		bytes.push_back(static_cast<uint8_t>((hexCharToInt(hexOnlyStr[i]) << 4) | hexCharToInt(hexOnlyStr[i + 1])));
 	}
+	extractSubstrings(bytes.data(), bytes.size(), substrings, rule_pool, rules, G, L, tolower);
 }
 
+// The extraction from decoded bytes (the overload called above) is implemented by SubstringIndex, see SubstringIndex.h.
+
 template <typename T>
 uint8_t Substring<T>::hexCharToInt(const char hexChar) {
 	if (hexChar >= 'a' && hexChar <= 'f') {
@@ -290,4 +218,6 @@ uint8_t Substring<T>::hexCharToInt(const char hexChar) {
 	return 0; // Invalid hex.
 }
 
+static_assert(std::is_trivially_copyable<Substring<uint64_t>>::value, "Substring must stay trivially copyable");
+
 #endif // _SUBSTRING_H
@@ -0,0 +1,157 @@
+#ifndef _SUBSTRING_INDEX_H
+#define _SUBSTRING_INDEX_H
+
+#include "Substring.h"
+#include "RulePool.h"
+#include "CustomHash.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+
+/// <summary>
+/// Builds the vector of unique Substrings of a ruleset in linear time.
+/// Every window of L bytes is looked up in a hash map (key -> position in the substrings vector) instead of
+/// scanning the whole vector, so duplicates are found in O(1) and merged into the existing Substring.
+/// The substrings vector keeps the order of first appearance, exactly as the linear scan did.
+/// The rules of each window are only recorded while extracting; finalize() merges the rules of every substring once
+/// and interns the combined lists into the substrings' RulePool.
+/// </summary>
+/// <typeparam name="T">Type of the unsigned int which represents the substring {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+template<typename T>
+class SubstringIndex {
+public:
+	SubstringIndex(std::vector<Substring<T>>& substrings, RulePool& rule_pool);
+
+	void extract(const uint8_t* bytes, std::size_t length, Span<uint32_t> rules,
+		std::size_t G = SUBSTRING_DEFAULT_GAP, std::size_t L = sizeof(T), bool tolower = false);
+	void finalize();
+
+	std::size_t getNumOfWindows() const { return num_of_windows; }
+	std::size_t getNumOfBytes() const { return num_of_bytes; }
+
+private:
+	// The rules a window contributed to a substring: a rule list outside the pool (ids != nullptr),
+	// or the list the substring already had in the pool (ids == nullptr, handle is used).
+	struct Contribution {
+		uint32_t substring;
+		uint32_t handle;
+		const uint32_t* ids;
+		uint32_t count;
+	};
+
+	std::vector<Substring<T>>& substrings;
+	RulePool& rule_pool;
+	std::unordered_map<T, std::size_t, CustomHash> index;		// substring key -> position in substrings
+	std::vector<Contribution> contributions;
+	std::size_t num_of_windows;
+	std::size_t num_of_bytes;
+};
+
+
+/// <summary>
+/// Create an index over the given substrings vector. Substrings already in the vector are indexed as well (keeping their rules).
+/// </summary>
+/// <param name="substrings">The vector of Substrings in which the results will be stored</param>
+/// <param name="rule_pool">The RulePool of the substrings, in which the (combined) rule lists will be stored</param>
+template<typename T>
+SubstringIndex<T>::SubstringIndex(std::vector<Substring<T>>& substrings, RulePool& rule_pool)
+	: substrings(substrings), rule_pool(rule_pool), num_of_windows(0), num_of_bytes(0) {
+	index.reserve(substrings.size());
+	for (std::size_t i = 0; i < substrings.size(); ++i) {
+		index.emplace(substrings[i].substring, i);
+		contributions.push_back({ static_cast<uint32_t>(i), substrings[i].rules, nullptr, 0 });
+	}
+}
+
+/// <summary>
+/// Split the bytes to windows of length L, advancing G bytes every time (see Substring::extractSubstrings).
+/// A new window is appended to the substrings vector, a duplicate one is counted (logDuplicate) on the existing Substring.
+/// </summary>
+/// <param name="bytes">The bytes to be split</param>
+/// <param name="length">The number of bytes</param>
+/// <param name="rules">The rules of the bytes (empty when extracting the substrings of a search key). Must outlive finalize().</param>
+/// <param name="G">The gap in which the parser advances on the bytes (default: G = 1)</param>
+/// <param name="L">The length of each window, L <= sizeof(T) (default: L = sizeof(T))</param>
+/// <param name="tolower">Force lowercase on the windows (used on search keys)</param>
+template<typename T>
+void SubstringIndex<T>::extract(const uint8_t* bytes, std::size_t length, Span<uint32_t> rules,
+								std::size_t G, std::size_t L, bool tolower) {
+	if (L > sizeof(T)) {		// the window would be silently truncated to its last sizeof(T) bytes
+		throw std::invalid_argument("Substrings of " + std::to_string(L) + " bytes do not fit in a key of " + std::to_string(sizeof(T)) + " bytes.");
+	}
+	num_of_bytes += length;
+	for (std::size_t i = 0; i + L <= length; i += G) {
+		T key = 0;
+		for (std::size_t j = 0; j < L; ++j) {
+			uint8_t byte = bytes[i + j];
+			// Check if the byte represents an uppercase letter (A=0x41 to Z=0x5A)
+			if (tolower && byte >= 'A' && byte <= 'Z') {
+				byte += 'a' - 'A'; // Convert to lowercase (a=0x61 to z=0x7A)
+			}
+			key = static_cast<T>((key << 8) | byte);
+		}
+		++num_of_windows;
+
+		auto inserted = index.try_emplace(key, substrings.size());
+		if (inserted.second) {			// substring is not in vector - add substring to vector
+			substrings.emplace_back(key);
+		}
+		else {							// substring found in vector - it will now represent the combined set of rules.
+			substrings[inserted.first->second].logDuplicate();
+		}
+		if (!rules.empty()) {			// used when extracting substrings from a test string (to search in the hash table and not insert)
+			contributions.push_back({ static_cast<uint32_t>(inserted.first->second), 0, rules.data(), static_cast<uint32_t>(rules.size()) });
+		}
+	}
+}
+
+/// <summary>
+/// Merge the rules contributed to each substring (sorted union) and set the substring's handle to the interned combined list.
+/// </summary>
+template<typename T>
+void SubstringIndex<T>::finalize() {
+	std::sort(contributions.begin(), contributions.end(),
+		[](const Contribution& a, const Contribution& b) { return a.substring < b.substring; });
+
+	uint32_t empty_rules = rule_pool.intern(nullptr, 0);
+	std::vector<uint32_t> merged;
+	std::size_t next = 0;
+	for (std::size_t i = 0; i < substrings.size(); ++i) {
+		merged.clear();
+		std::size_t first = next;
+		while (next < contributions.size() && contributions[next].substring == i) {
+			const Contribution& contribution = contributions[next];
+			Span<uint32_t> rules = (contribution.ids == nullptr) ? rule_pool.getRules(contribution.handle)
+				: Span<uint32_t>(contribution.ids, contribution.count);
+			merged.insert(merged.end(), rules.begin(), rules.end());
+			++next;
+		}
+		if (next - first > 1) {
+			std::sort(merged.begin(), merged.end());
+			merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+		}
+		substrings[i].rules = (next == first) ? empty_rules : rule_pool.intern(merged.data(), merged.size());
+	}
+	contributions.clear();
+}
+
+
+/// <summary>
+/// Substring::extractSubstrings for an exact match which is already decoded to raw bytes (e.g. a pattern of a compiled ruleset).
+/// Example: bytes = {0x73, 0x6E, 0x6F, 0x72, 0x74} ("snort"), with L = 2, G = 1:
+///		Substring([736E, 6E6F, 6F72, 7274]) will be created.
+/// Note: when extracting many exact matches into the same vector, use a single SubstringIndex instead (indexing the vector once).
+/// </summary>
+template <typename T>
+void Substring<T>::extractSubstrings(const uint8_t* bytes, std::size_t length, std::vector<Substring<T>>& substrings, RulePool& rule_pool,
+									 Span<uint32_t> rules, std::size_t G, std::size_t L, bool tolower) {
+	SubstringIndex<T> index(substrings, rule_pool);
+	index.extract(bytes, length, rules, G, L, tolower);
+	index.finalize();
+}
+
+#endif // _SUBSTRING_INDEX_H
@@ -0,0 +1,38 @@
+#ifndef _SUBSTRING_KEY_H
+#define _SUBSTRING_KEY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+/*
+Key types of the substrings.
+A substring of L bytes is stored in the smallest unsigned int which holds L bytes, the first byte of the substring being
+its most significant byte. When L < sizeof(key) the key is masked: its (sizeof(key) - L) upper bytes are always zero,
+so e.g. a 3 bytes substring is the uint32_t 0x00XXYYZZ and a 12 bytes substring is a 128 bits key with 4 zero bytes on top.
+*/
+#if defined __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128_t;		// __extension__: the 128 bits type is a GNU extension (silences -pedantic)
+#define SUBSTRING_MAX_LENGTH 16
+#else
+#define SUBSTRING_MAX_LENGTH 8
+#endif
+
+
+/// <summary>
+/// The key type of a substring of L bytes: uint16_t (L <= 2), uint32_t (L <= 4), uint64_t (L <= 8) or uint128_t (L <= 16).
+/// </summary>
+/// <typeparam name="L">Length of the substring, 1 <= L <= SUBSTRING_MAX_LENGTH</typeparam>
+template<std::size_t L>
+struct SubstringKey {
+	static_assert(L >= 1 && L <= SUBSTRING_MAX_LENGTH, "Unsupported substring length");
+#if SUBSTRING_MAX_LENGTH > 8
+	typedef typename std::conditional<(L > 8), uint128_t, uint64_t>::type wide_type;
+#else
+	typedef uint64_t wide_type;
+#endif
+	typedef typename std::conditional<(L <= 2), uint16_t,
+		typename std::conditional<(L <= 4), uint32_t, wide_type>::type>::type type;
+};
+
+#endif // _SUBSTRING_KEY_H
@@ -0,0 +1,237 @@
+#ifndef _TABLE_SNAPSHOT_H
+#define _TABLE_SNAPSHOT_H
+
+#include "FrozenCuckooTable.h"
+#include "SidArena.h"
+#include "Ruleset.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+/*
+Snapshot file of a built substrings table (all integers are stored in the host's byte order):
+	[TableSnapshotHeader]
+	[tags]			the tag blocks of the FrozenCuckooTable		(num_of_buckets blocks)
+	[keys]			its key blocks								(num_of_buckets blocks)
+	[values]		its values: the offsets of the SID lists		(num_of_buckets * slots per bucket values)
+	[sid_words]		the words of the SidArena					(num_of_sid_words uint32_t)
+Every section starts on a TABLE_SNAPSHOT_SECTION_ALIGNMENT boundary (as the blocks are aligned in memory), so the file is
+mapped read-only and looked up in place: restoring a table is an mmap (and a pass over it, verifying its checksum and bounds),
+and the processes scanning with the same snapshot share its physical pages. A snapshot records the checksum of the compiled
+ruleset it was built from, and is only restored for that very ruleset (and the same key / value / tag types, L and G).
+The buckets of the keys depend on the hash function, which the types do not tell: the header also records the hashes of
+TABLE_SNAPSHOT_NUM_OF_HASHER_PROBES fixed probe keys, and a snapshot is only restored with a hash function that hashes them alike.
+*/
+#define TABLE_SNAPSHOT_MAGIC "SNTTABLE"
+#define TABLE_SNAPSHOT_VERSION 2
+#define TABLE_SNAPSHOT_SECTION_ALIGNMENT 128
+#define TABLE_SNAPSHOT_FILE_EXTENSION ".snap"
+#define TABLE_SNAPSHOT_NUM_OF_HASHER_PROBES 4
+#define TABLE_SNAPSHOT_HASHER_PROBE_MULTIPLIER 0x9e3779b97f4a7c15		// probe key i is (i + 1) * this, truncated to K
+
+struct TableSnapshotHeader {
+	char magic[8];					// TABLE_SNAPSHOT_MAGIC (without the terminating null)
+	uint32_t version;				// TABLE_SNAPSHOT_VERSION
+	uint32_t key_size;				// sizeof(K), sizeof(V), sizeof(Tag) of the table
+	uint32_t value_size;
+	uint32_t tag_size;
+	uint32_t substring_length;		// L and G of the substrings
+	uint32_t substring_gap;
+	uint64_t num_of_buckets;
+	uint64_t num_of_elements;
+	uint64_t num_of_sid_words;
+	uint64_t ruleset_checksum;		// the checksum of the compiled ruleset (RulesetHeader::checksum) the table was built from
+	uint64_t hasher_probes[TABLE_SNAPSHOT_NUM_OF_HASHER_PROBES];	// the hashes of the probe keys (see hasherProbe)
+	uint64_t checksum;				// FNV-1a of everything following the header
+	uint64_t tags_pos;				// file offsets of each of the sections
+	uint64_t keys_pos;
+	uint64_t values_pos;
+	uint64_t sid_words_pos;
+	uint64_t file_size;
+};
+
+
+std::size_t alignSnapshotSection(std::size_t pos) {
+	return (pos + TABLE_SNAPSHOT_SECTION_ALIGNMENT - 1) & ~static_cast<std::size_t>(TABLE_SNAPSHOT_SECTION_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// The hash of the given probe key: tables hashed by 2 hash functions that differ on any probe key are not interchangeable.
+/// </summary>
+template<typename K, typename H>
+uint64_t hasherProbe(std::size_t probe) {
+	K key = static_cast<K>(static_cast<uint64_t>(TABLE_SNAPSHOT_HASHER_PROBE_MULTIPLIER) * (probe + 1));
+	return static_cast<uint64_t>(H()(key));
+}
+
+/// <summary>
+/// Write a built table and the SID lists its values point to as a snapshot file (see the file format above).
+/// The file is replaced atomically (see writeFileAtomically), so processes scanning with the previous snapshot are unaffected.
+/// </summary>
+/// <param name="L">Length of the substrings of the table</param>
+/// <param name="G">Gap between 2 substrings</param>
+/// <param name="ruleset_checksum">The checksum of the compiled ruleset the table was built from</param>
+template<typename K, typename V, typename Tag, typename H>
+void writeTableSnapshot(const std::string& snapshot_path, const FrozenCuckooTable<K, V, Tag, H>& table, const SidArena& sid_arena,
+						std::size_t L, std::size_t G, uint64_t ruleset_checksum) {
+	static_assert(FrozenCuckooTable<K, V, Tag, H>::blockAlignment() <= TABLE_SNAPSHOT_SECTION_ALIGNMENT, "Sections are not aligned enough");
+	TableSnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, TABLE_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = TABLE_SNAPSHOT_VERSION;
+	header.key_size = sizeof(K);
+	header.value_size = sizeof(V);
+	header.tag_size = sizeof(Tag);
+	header.substring_length = static_cast<uint32_t>(L);
+	header.substring_gap = static_cast<uint32_t>(G);
+	header.num_of_buckets = table.bucket_count();
+	header.num_of_elements = table.size();
+	header.num_of_sid_words = sid_arena.sizeWords();
+	header.ruleset_checksum = ruleset_checksum;
+	for (std::size_t probe = 0; probe < TABLE_SNAPSHOT_NUM_OF_HASHER_PROBES; ++probe) {
+		header.hasher_probes[probe] = hasherProbe<K, H>(probe);
+	}
+	header.tags_pos = alignSnapshotSection(sizeof(TableSnapshotHeader));
+	header.keys_pos = alignSnapshotSection(header.tags_pos + table.tagBytes());
+	header.values_pos = alignSnapshotSection(header.keys_pos + table.keyBytes());
+	header.sid_words_pos = alignSnapshotSection(header.values_pos + table.valueBytes());
+	header.file_size = alignSnapshotSection(header.sid_words_pos + sid_arena.sizeBytes());
+
+	std::vector<uint8_t> image(header.file_size, 0);
+	if (table.bucket_count() != 0) {
+		std::memcpy(image.data() + header.tags_pos, table.tagData(), table.tagBytes());
+		std::memcpy(image.data() + header.keys_pos, table.keyData(), table.keyBytes());
+		std::memcpy(image.data() + header.values_pos, table.valueData(), table.valueBytes());
+	}
+	if (sid_arena.sizeWords() != 0) {
+		std::memcpy(image.data() + header.sid_words_pos, sid_arena.data(), sid_arena.sizeBytes());
+	}
+	header.checksum = fnv1a(image.data() + sizeof(TableSnapshotHeader), image.size() - sizeof(TableSnapshotHeader));
+	std::memcpy(image.data(), &header, sizeof(header));
+	writeFileAtomically(snapshot_path, image);
+}
+
+/// <summary>
+/// Validate a table snapshot image: its header (the current version, a table of the same types, L and G, hashed by the same
+/// hash function and built from the ruleset of the given checksum), its checksum, that its sections are in order within the
+/// image, and that the value of every occupied slot is the offset of a SID list within the SID words - so neither the table
+/// nor its SidArena read outside of it.
+/// </summary>
+/// <returns>true if the table of the image can be attached and looked up</returns>
+template<typename K, typename V, typename Tag, typename H>
+bool isValidTableSnapshotImage(const uint8_t* image, std::size_t image_size, std::size_t L, std::size_t G, uint64_t ruleset_checksum) {
+	typedef FrozenCuckooTable<K, V, Tag, H> table_type;
+	if (image_size < sizeof(TableSnapshotHeader)) {
+		return false;
+	}
+	const TableSnapshotHeader& header = *reinterpret_cast<const TableSnapshotHeader*>(image);
+	if (std::memcmp(header.magic, TABLE_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != TABLE_SNAPSHOT_VERSION || header.file_size != image_size
+		|| header.key_size != sizeof(K) || header.value_size != sizeof(V) || header.tag_size != sizeof(Tag)
+		|| header.substring_length != L || header.substring_gap != G || header.ruleset_checksum != ruleset_checksum) {
+		return false;
+	}
+	for (std::size_t probe = 0; probe < TABLE_SNAPSHOT_NUM_OF_HASHER_PROBES; ++probe) {
+		if (header.hasher_probes[probe] != hasherProbe<K, H>(probe)) {
+			return false;
+		}
+	}
+	// Each section ends at most where the next one starts (the counts are divided, never multiplied: no overflow)
+	if (header.tags_pos < sizeof(TableSnapshotHeader)
+		|| !isFileSectionValid(header.tags_pos, header.num_of_buckets, table_type::tagBlockBytes(), header.keys_pos, TABLE_SNAPSHOT_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.keys_pos, header.num_of_buckets, table_type::keyBlockBytes(), header.values_pos, TABLE_SNAPSHOT_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.values_pos, header.num_of_buckets, FROZEN_CUCKOO_SLOTS_PER_BUCKET * sizeof(V), header.sid_words_pos,
+							   TABLE_SNAPSHOT_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.sid_words_pos, header.num_of_sid_words, sizeof(uint32_t), image_size, TABLE_SNAPSHOT_SECTION_ALIGNMENT)) {
+		return false;
+	}
+	if (header.checksum != fnv1a(image + sizeof(TableSnapshotHeader), image_size - sizeof(TableSnapshotHeader))) {
+		return false;
+	}
+
+	const Tag* tags = reinterpret_cast<const Tag*>(image + header.tags_pos);
+	const V* values = reinterpret_cast<const V*>(image + header.values_pos);
+	const uint32_t* sid_words = reinterpret_cast<const uint32_t*>(image + header.sid_words_pos);
+	std::size_t num_of_slots = static_cast<std::size_t>(header.num_of_buckets) * FROZEN_CUCKOO_SLOTS_PER_BUCKET;
+	std::size_t num_of_elements = 0;
+	for (std::size_t slot = 0; slot < num_of_slots; ++slot) {
+		if (tags[slot] == 0) {
+			continue;		// an empty slot: its value is never read
+		}
+		++num_of_elements;
+		uint64_t offset = static_cast<uint64_t>(values[slot]);
+		if (offset >= header.num_of_sid_words || sid_words[offset] > header.num_of_sid_words - offset - 1) {
+			return false;
+		}
+	}
+	return num_of_elements == header.num_of_elements;
+}
+
+/// <summary>
+/// A table snapshot file, mapped read-only into memory (on Windows it is read into a buffer instead).
+/// table() and sidArena() look up the table and its SID lists in place, without building or copying them.
+/// </summary>
+template<typename K, typename V, typename Tag = uint16_t, typename H = CustomHash>
+class TableSnapshot {
+public:
+	TableSnapshot() : mapping(nullptr), mapping_size(0) {}
+	~TableSnapshot() { close(); }
+	TableSnapshot(const TableSnapshot&) = delete;
+	TableSnapshot& operator=(const TableSnapshot&) = delete;
+
+	bool open(const std::string& path, std::size_t L, std::size_t G, uint64_t ruleset_checksum);
+	void close();
+	const FrozenCuckooTable<K, V, Tag, H>& table() const { return frozen_table; }
+	const SidArena& sidArena() const { return sid_arena; }
+	const TableSnapshotHeader& header() const { return *reinterpret_cast<const TableSnapshotHeader*>(mapping); }
+	std::size_t sizeBytes() const { return mapping_size; }
+
+private:
+	const uint8_t* mapping;
+	std::size_t mapping_size;
+	std::vector<uint64_t> buffer;		// used only where mmap is not available
+	FrozenCuckooTable<K, V, Tag, H> frozen_table;
+	SidArena sid_arena;
+};
+
+/// <summary>
+/// Map a table snapshot file and validate it (see isValidTableSnapshotImage).
+/// </summary>
+/// <returns>true if the file was mapped and its table can be looked up, false otherwise (e.g. a stale or corrupt snapshot: rebuild it).</returns>
+template<typename K, typename V, typename Tag, typename H>
+bool TableSnapshot<K, V, Tag, H>::open(const std::string& path, std::size_t L, std::size_t G, uint64_t ruleset_checksum) {
+	close();
+	if (!mapReadOnlyFile(path, sizeof(TableSnapshotHeader), mapping, mapping_size, buffer)) {
+		return false;
+	}
+
+	const TableSnapshotHeader& file_header = header();
+	if (!isValidTableSnapshotImage<K, V, Tag, H>(mapping, mapping_size, L, G, ruleset_checksum)
+		|| !frozen_table.attach(mapping + file_header.tags_pos, mapping + file_header.keys_pos,
+								reinterpret_cast<const V*>(mapping + file_header.values_pos), file_header.num_of_buckets,
+								file_header.num_of_elements)) {
+		close();
+		return false;
+	}
+	sid_arena.attach(reinterpret_cast<const uint32_t*>(mapping + file_header.sid_words_pos), file_header.num_of_sid_words);
+	return true;
+}
+
+template<typename K, typename V, typename Tag, typename H>
+void TableSnapshot<K, V, Tag, H>::close() {
+	frozen_table = FrozenCuckooTable<K, V, Tag, H>();
+	sid_arena.attach(nullptr, 0);
+	unmapReadOnlyFile(mapping, mapping_size, buffer);
+}
+
+
+/// <summary>
+/// Default path of the snapshot of the table of substrings of L bytes every G bytes, in the given directory.
+/// </summary>
+std::string defaultSnapshotPath(const std::string& dir_path, std::size_t L, std::size_t G) {
+	return dir_path + "/table_L" + std::to_string(L) + "_G" + std::to_string(G) + TABLE_SNAPSHOT_FILE_EXTENSION;
+}
+
+#endif // _TABLE_SNAPSHOT_H
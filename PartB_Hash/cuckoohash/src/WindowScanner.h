@@ -0,0 +1,182 @@
+#ifndef _WINDOW_SCANNER_H
+#define _WINDOW_SCANNER_H
+
+#include "CustomHash.h"
+#include "SubstringKey.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if defined _MSC_VER
+#include <stdlib.h>
+#endif
+
+#define SWAR_ONES_UINT64_T 0x0101010101010101
+
+/*
+Scan-side window generator.
+The payload is read as raw bytes: each window of L <= 8 bytes is a single unaligned 8 bytes load (2 loads for L <= 16), which is case folded
+(8 bytes at a time, SWAR) and byte swapped, so the first byte of the window becomes the most significant byte of the key
+(the same key Substring<T> builds from the window). No strings, streams or rule sets are created while scanning.
+*/
+
+
+/// <summary>
+/// Lookup table mapping each byte to its lowercase (only 'A'-'Z' are changed). Used for the few tail bytes of a payload.
+/// </summary>
+struct CaseFoldTable {
+	std::array<uint8_t, 256> table;
+	constexpr CaseFoldTable() : table() {
+		for (int i = 0; i < 256; ++i) {
+			table[i] = static_cast<uint8_t>((i >= 'A' && i <= 'Z') ? i + ('a' - 'A') : i);
+		}
+	}
+	uint8_t operator[](uint8_t byte) const { return table[byte]; }
+};
+constexpr CaseFoldTable CASE_FOLD_TABLE;
+
+/// <summary>
+/// Lowercase the 8 bytes of a word at once (SWAR): a byte gets 0x20 added iff it is in ['A','Z'].
+/// </summary>
+inline uint64_t foldCase64(uint64_t word) {
+	constexpr uint64_t ones = SWAR_ONES_UINT64_T;
+	uint64_t heptets = word & (0x7F * ones);
+	uint64_t is_gt_Z = heptets + (0x7F - 'Z') * ones;	// MSB of a byte is set iff byte > 'Z'
+	uint64_t is_ge_A = heptets + (0x80 - 'A') * ones;	// MSB of a byte is set iff byte >= 'A'
+	uint64_t is_ascii = ~word & (0x80 * ones);			// MSB of a byte is set iff byte < 0x80
+	uint64_t is_upper = is_ascii & (is_ge_A ^ is_gt_Z);
+	return word | (is_upper >> 2);
+}
+
+/// <summary>
+/// Convert a word loaded from memory to big endian order (first byte in memory = most significant byte).
+/// </summary>
+inline uint64_t toBigEndian64(uint64_t word) {
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return word;
+#elif defined _MSC_VER
+	return _byteswap_uint64(word);
+#else
+	return __builtin_bswap64(word);
+#endif
+}
+
+/// <summary>
+/// Build the key of the window of L bytes starting at pos.
+/// A window of up to 8 bytes is a single load; a longer window (9 to 16 bytes, 128 bits key) is built from 2 loads:
+/// its first L - 8 bytes are the upper half of the key and its last 8 bytes the lower half.
+/// </summary>
+/// <typeparam name="L">Length of the window, 1 <= L <= SUBSTRING_MAX_LENGTH</typeparam>
+/// <param name="pos">Start of the window</param>
+/// <param name="end">End of the payload (used to avoid reading past the payload on its last windows)</param>
+/// <param name="tolower">Case fold the window</param>
+/// <returns>The window's bytes as a big endian unsigned int (masked to L bytes, see SubstringKey)</returns>
+template<std::size_t L>
+inline typename SubstringKey<L>::type loadWindow(const uint8_t* pos, const uint8_t* end, bool tolower) {
+	typedef typename SubstringKey<L>::type key_type;
+	if constexpr (L > sizeof(uint64_t)) {
+		key_type upper = loadWindow<L - sizeof(uint64_t)>(pos, end, tolower);
+		return (upper << 64) | loadWindow<sizeof(uint64_t)>(pos + L - sizeof(uint64_t), end, tolower);
+	}
+	else {
+		if (end - pos >= static_cast<std::ptrdiff_t>(sizeof(uint64_t))) {
+			uint64_t word;
+			std::memcpy(&word, pos, sizeof(word));		// unaligned load
+			if (tolower) {
+				word = foldCase64(word);
+			}
+			return static_cast<key_type>(toBigEndian64(word) >> (64 - 8 * L));
+		}
+		key_type key = 0;
+		for (std::size_t j = 0; j < L; ++j) {
+			key = static_cast<key_type>((key << 8) | (tolower ? CASE_FOLD_TABLE[pos[j]] : pos[j]));
+		}
+		return key;
+	}
+}
+
+/// <summary>
+/// Call callback(key) for every window of L bytes of the payload, advancing G bytes every time (the windows of Substring::extractSubstrings).
+/// The key type must hold the whole window (L <= sizeof(K)); a window shorter than K is zero extended (masked key).
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="L">Length of the windows</typeparam>
+/// <typeparam name="G">Gap between 2 windows</typeparam>
+/// <param name="payload">The payload bytes</param>
+/// <param name="length">The number of bytes in the payload</param>
+/// <param name="tolower">Case fold the windows</param>
+/// <param name="callback">Called with each window's key</param>
+template<typename K, std::size_t L, std::size_t G, typename F>
+inline void forEachWindow(const uint8_t* payload, std::size_t length, bool tolower, F&& callback) {
+	static_assert(L <= sizeof(K), "The key type is too small for windows of L bytes (see SubstringKey<L>)");
+	const uint8_t* end = payload + length;
+	for (std::size_t i = 0; i + L <= length; i += G) {
+		callback(static_cast<K>(loadWindow<L>(payload + i, end, tolower)));
+	}
+}
+
+/// <summary>
+/// A set of the window keys already seen in the current payload, so every unique window is looked up once.
+/// Open addressing over preallocated arrays; reset() starts a new payload in O(1) by bumping a generation stamp,
+/// so no memory is allocated or cleared per payload.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}</typeparam>
+template<typename K>
+class WindowSet {
+public:
+	WindowSet() : mask(0), stamp(1) {}
+
+	/// <summary>
+	/// Allocate room for the windows of the largest payload (call once, before scanning).
+	/// </summary>
+	void reserve(std::size_t max_windows) {
+		std::size_t capacity = 16;
+		while (capacity < 2 * max_windows) {
+			capacity <<= 1;
+		}
+		keys.assign(capacity, 0);
+		stamps.assign(capacity, 0);
+		mask = capacity - 1;
+		stamp = 1;
+	}
+
+	void reset() {
+		if (++stamp == 0) {		// generation counter wrapped around
+			std::fill(stamps.begin(), stamps.end(), 0);
+			stamp = 1;
+		}
+	}
+
+	/// <returns>true if the key was not seen yet in the current payload</returns>
+	bool insert(K key) {
+		return insert(key, hash(key));
+	}
+
+	/// <summary>
+	/// Insert a key whose CustomHash was already computed (see forEachHashedWindow).
+	/// </summary>
+	/// <returns>true if the key was not seen yet in the current payload</returns>
+	bool insert(K key, std::size_t key_hash) {
+		std::size_t i = key_hash & mask;
+		while (stamps[i] == stamp) {
+			if (keys[i] == key) {
+				return false;
+			}
+			i = (i + 1) & mask;
+		}
+		stamps[i] = stamp;
+		keys[i] = key;
+		return true;
+	}
+
+private:
+	std::vector<K> keys;
+	std::vector<uint32_t> stamps;
+	std::size_t mask;
+	uint32_t stamp;
+	CustomHash hash;
+};
+
+#endif // _WINDOW_SCANNER_H
@@ -0,0 +1,1481 @@
+#include "Auxiliary.h"
+
+/*
+Micro benchmarks of the cuckoohash engine. A single executable, the benchmark to run is selected with -m <mode>:
+    all     - run every benchmark (default)
+    lengths - lookup throughput and false-hit rate of the substrings table, for each substring length L
+    hashes  - the hash family (CustomHash.h): ns/hash, bucket distribution (chi-square), libcuckoo max load factor and insert time
+    batch   - batched (SIMD) window hashing (BatchHash.h) vs. hashing each window: bit-identity, ns/window, lookups on the corpus
+    frozen  - FrozenCuckooTable (8 / 16 bits tags) vs. libcuckoo: lookups/s on the windows of the corpus, load factor, size
+    prefetch- FrozenCuckooTable batched lookups (prefetching) vs. one lookup at a time, for each table size of TABLE_SIZES
+    prefilter - binary fuse prefilter (BinaryFuseFilter.h) for each (L, G): size, false positive rate, scan throughput with / without
+    threads - parallel scan (ParallelScan.h) of the test payloads and of a large synthetic corpus: throughput from 1 to N threads
+    multi   - single pass scan against the tables of L = 4 and L = 8 at once vs. the two scans back to back (test payloads, synthetic flows)
+    snapshot- scanner startup: building the table vs. restoring it from its snapshot (TableSnapshot.h): time, private / shared memory
+    mphf    - minimal perfect hash index (PerfectHashIndex.h) vs. libcuckoo for each table size of TABLE_SIZES: bits/key, build, latency
+    hugepages - tables and lists of SIDs in huge pages (HugePages.h) vs. the default allocator, on synthetic rulesets of each size
+              of BENCH_HUGE_PAGES_SIZES: ns/lookup and dTLB load misses per lookup (perf events, null where not counted)
+    layout  - libcuckoo layouts within each memory budget of TABLE_SIZES: slots per bucket (2/4/8/16) and the hashpower they allow,
+              for each (L, G): max load factor, insert time and lookup throughput (Statistics, bench_layout_L<L>_G<G>.json)
+Results of each benchmark are written to <dest_path>/bench_<mode>.json.
+*/
+#define BENCH_MODE_ALL "all"
+#define BENCH_MODE_LENGTHS "lengths"
+#define BENCH_MODE_HASHES "hashes"
+#define BENCH_MODE_BATCH "batch"
+#define BENCH_MODE_FROZEN "frozen"
+#define BENCH_MODE_PREFETCH "prefetch"
+#define BENCH_MODE_PREFILTER "prefilter"
+#define BENCH_MODE_THREADS "threads"
+#define BENCH_MODE_LAYOUT "layout"
+#define BENCH_MODE_MULTI_LENGTH "multi"
+#define BENCH_MODE_PERFECT_HASH "mphf"
+#define BENCH_MODE_SNAPSHOT "snapshot"
+#define BENCH_MODE_HUGE_PAGES "hugepages"
+
+// Sink for results computed only to be timed (keeps the compiler from dropping the timed loops)
+volatile std::size_t bench_sink = 0;
+
+
+/// <summary>
+/// Generate a synthetic corpus of printable ASCII bytes (text-like traffic, which is where short substrings hit the most).
+/// </summary>
+/// <param name="size">Size of the corpus in Bytes</param>
+/// <param name="seed">Seed of the generator (the corpus is the same on every run)</param>
+std::vector<uint8_t> generateCorpus(std::size_t size, uint64_t seed) {
+    std::mt19937_64 generator(seed);
+    std::uniform_int_distribution<int> printable(0x20, 0x7E);
+    std::vector<uint8_t> corpus(size);
+    for (uint8_t& byte : corpus) {
+        byte = static_cast<uint8_t>(printable(generator));
+    }
+    return corpus;
+}
+
+/// <summary>
+/// Benchmark the substrings table of substrings of L bytes (masked keys of SubstringKey<L>::type):
+///  > false-hit rate: a window of a test payload which is found in the table although none of the rules of its substring
+///    is one of the payload's original SIDs (a window shared with other rules, which the scan can not tell apart).
+///  > lookup throughput: every window of the test payloads (iterations times), and of the synthetic corpus.
+/// </summary>
+/// <typeparam name="L">Length of the substrings</typeparam>
+/// <typeparam name="G">Gap between 2 substrings</typeparam>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchLength(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<SearchResults>& search_items,
+                 const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+
+    // The value of each key is the handle of its rule list
+    libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> hash_table;
+    hash_table.reserve(substrings.size());
+    for (const Substring<K>& substring : substrings) {
+        hash_table.insert(substring.substring, substring.rules);
+    }
+
+    // False hits on the test payloads
+    std::size_t num_of_windows = 0;
+    std::size_t num_of_hits = 0;
+    std::size_t num_of_false_hits = 0;
+    std::size_t num_of_payload_bytes = 0;
+    for (const SearchResults& search_item : search_items) {
+        num_of_payload_bytes += search_item.payload.size();
+        forEachWindow<K, L, G>(search_item.payload.data(), search_item.payload.size(), true, [&](K key) {
+            ++num_of_windows;
+            uint32_t rules_handle = 0;
+            if (!hash_table.find(key, rules_handle)) {
+                return;
+            }
+            ++num_of_hits;
+            Span<uint32_t> rules = substrings_rules.getRules(rules_handle);
+            bool is_original_rule = std::any_of(rules.begin(), rules.end(), [&](uint32_t rule) {
+                return std::find(search_item.original_sids.begin(), search_item.original_sids.end(), static_cast<int>(rule)) != search_item.original_sids.end();
+            });
+            if (!is_original_rule) {
+                ++num_of_false_hits;
+            }
+        });
+    }
+
+    // Lookup throughput on the test payloads
+    std::size_t found = 0;
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        for (const SearchResults& search_item : search_items) {
+            forEachWindow<K, L, G>(search_item.payload.data(), search_item.payload.size(), true, [&](K key) {
+                found += hash_table.contains(key);
+            });
+        }
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double payload_time = std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+    bench_sink = found;
+
+    // Lookup throughput (and hit rate) on the synthetic corpus
+    std::size_t num_of_corpus_windows = 0;
+    std::size_t num_of_corpus_hits = 0;
+    timestamp_a = std::chrono::high_resolution_clock::now();
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        ++num_of_corpus_windows;
+        num_of_corpus_hits += hash_table.contains(key);
+    });
+    timestamp_b = std::chrono::high_resolution_clock::now();
+    double corpus_time = std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+
+    double num_of_lookups = double(num_of_windows) * iterations;
+    double lookup_ns = (num_of_lookups > 0) ? payload_time * 1e9 / num_of_lookups : 0;
+    double payload_gbps = (payload_time > 0) ? double(num_of_payload_bytes) * iterations / payload_time / 1e9 : 0;
+    double hit_rate = (num_of_windows > 0) ? double(num_of_hits) / num_of_windows : 0;
+    double false_hit_rate = (num_of_hits > 0) ? double(num_of_false_hits) / num_of_hits : 0;
+    double corpus_lookup_ns = (num_of_corpus_windows > 0) ? corpus_time * 1e9 / num_of_corpus_windows : 0;
+    double corpus_hit_rate = (num_of_corpus_windows > 0) ? double(num_of_corpus_hits) / num_of_corpus_windows : 0;
+    std::size_t table_size = hash_table.capacity() * sizeof(std::pair<K, uint32_t>);
+
+    std::cout << "L = " << std::setw(2) << L << " (" << sizeof(K) << " Bytes key): " << substrings.size() << " substring(s), "  \
+        << table_size / 1024 << "[KB]. Payloads: " << lookup_ns << "[ns/lookup], " << payload_gbps << " GB/s, hit rate "      \
+        << hit_rate * 100 << "%, false hits " << false_hit_rate * 100 << "%. Corpus: " << corpus_lookup_ns                   \
+        << "[ns/lookup], hit rate " << corpus_hit_rate * 100 << "%." << std::endl;
+
+    bench_log.addData({
+        {"L", L},
+        {"G", G},
+        {"key_size", sizeof(K)},
+        {"num_of_substrings", substrings.size()},
+        {"table_size", table_size},
+        {"num_of_windows", num_of_windows},
+        {"num_of_hits", num_of_hits},
+        {"num_of_false_hits", num_of_false_hits},
+        {"hit_rate", hit_rate},
+        {"false_hit_rate", false_hit_rate},
+        {"lookup_ns", lookup_ns},
+        {"payload_throughput_gbps", payload_gbps},
+        {"corpus_lookup_ns", corpus_lookup_ns},
+        {"corpus_hit_rate", corpus_hit_rate}
+    });
+}
+
+/// <summary>
+/// Benchmark a hasher on the keys of a real substrings set:
+///  > ns/hash: hashing all the keys, iterations times.
+///  > chi-square of the keys' distribution over the buckets of a libcuckoo table sized for the keys (bucket = hash & hashmask,
+///    as libcuckoo indexes its buckets). The normalized value (chi-square / (buckets - 1)) is ~1 for a uniform hash.
+///  > partial keys: the distinct values (of 256) and the normalized chi-square of libcuckoo's partial key of the hashes (the hash
+///    folded to a byte). The alternate bucket of a key is its bucket xor a function of its partial key, so a hash whose partial
+///    keys are skewed (or constant) has alternate buckets tied to the primary ones, whatever its chi-square above.
+///  > max load factor: the keys are inserted (in a fixed shuffled order) to a table which may not grow, until it is full.
+///  > insert time: all the keys are inserted to a table reserved for them.
+/// </summary>
+/// <typeparam name="K">Type of the keys</typeparam>
+/// <typeparam name="H">The hasher</typeparam>
+template<typename K, typename H>
+void benchHash(BenchmarkLog& bench_log, const std::string& hash_name, std::size_t L, const std::vector<K>& keys, std::size_t iterations) {
+    typedef libcuckoo::cuckoohash_map<K, uint32_t, H> table_type;
+    H hasher;
+
+    // ns/hash
+    std::size_t hashes_sum = 0;
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        for (K key : keys) {
+            hashes_sum += hasher(key);
+        }
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    bench_sink = hashes_sum;
+    double hash_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / (double(keys.size()) * iterations);
+
+    // Bucket distribution
+    table_type sized_table(keys.size());
+    std::size_t num_of_buckets = sized_table.bucket_count();
+    std::vector<std::size_t> bucket_sizes(num_of_buckets, 0);
+    for (K key : keys) {
+        ++bucket_sizes[hasher(key) & (num_of_buckets - 1)];
+    }
+    double expected = double(keys.size()) / num_of_buckets;
+    double chi_square = 0;
+    for (std::size_t bucket_size : bucket_sizes) {
+        chi_square += (bucket_size - expected) * (bucket_size - expected) / expected;
+    }
+    double chi_square_normalized = (num_of_buckets > 1) ? chi_square / (num_of_buckets - 1) : 0;
+
+    // Partial keys (as libcuckoo's partial_key: the hash folded to a byte), which the alternate buckets are taken from
+    std::vector<std::size_t> partial_key_counts(256, 0);
+    for (K key : keys) {
+        uint64_t folded = static_cast<uint64_t>(hasher(key));
+        folded ^= folded >> 32;
+        folded ^= folded >> 16;
+        folded ^= folded >> 8;
+        ++partial_key_counts[folded & 0xff];
+    }
+    std::size_t num_of_partial_keys = 0;
+    double partial_key_chi_square = 0;
+    double partial_key_expected = double(keys.size()) / partial_key_counts.size();
+    for (std::size_t count : partial_key_counts) {
+        num_of_partial_keys += (count > 0) ? 1 : 0;
+        partial_key_chi_square += (count - partial_key_expected) * (count - partial_key_expected) / partial_key_expected;
+    }
+    double partial_key_chi_square_normalized = partial_key_chi_square / (partial_key_counts.size() - 1);
+
+    // Max load factor: a table of (at most) keys.size() slots, which may not grow
+    std::vector<K> shuffled_keys(keys);
+    std::shuffle(shuffled_keys.begin(), shuffled_keys.end(), std::default_random_engine(SHUFFLE_SEED));
+    table_type full_table(keys.size() / 2);
+    full_table.maximum_hashpower(full_table.hashpower());
+    try {
+        for (K key : shuffled_keys) {
+            full_table.insert(key, 0);
+        }
+    }
+    catch (const libcuckoo::maximum_hashpower_exceeded&) {
+        // the table is full
+    }
+    double max_load_factor = full_table.load_factor();
+
+    // Insert time
+    timestamp_a = std::chrono::high_resolution_clock::now();
+    table_type insert_table(keys.size());
+    for (K key : shuffled_keys) {
+        insert_table.insert(key, 0);
+    }
+    timestamp_b = std::chrono::high_resolution_clock::now();
+    double insert_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / keys.size();
+
+    std::cout << "L = " << std::setw(2) << L << ", " << std::setw(18) << std::left << hash_name << std::right << ": "       \
+        << hash_ns << "[ns/hash], chi-square " << chi_square << " (" << chi_square_normalized << " normalized, "         \
+        << num_of_buckets << " buckets), " << num_of_partial_keys << " partial keys (chi-square " << partial_key_chi_square_normalized \
+        << " normalized), max load factor " << max_load_factor << ", insert " << insert_ns << "[ns]." << std::endl;
+    if (keys.size() >= 256 * BENCH_MIN_KEYS_PER_PARTIAL_KEY && partial_key_chi_square_normalized > BENCH_MAX_PARTIAL_KEY_CHI_SQUARE) {
+        std::cout << "WARNING: " << hash_name << " has skewed partial keys, its alternate buckets are not independent of its buckets"  \
+            << " (its max load factor and insert time are not those of a 2-choice table)." << std::endl;
+    }
+
+    bench_log.addData({
+        {"L", L},
+        {"hash", hash_name},
+        {"num_of_keys", keys.size()},
+        {"hash_ns", hash_ns},
+        {"num_of_buckets", num_of_buckets},
+        {"chi_square", chi_square},
+        {"chi_square_normalized", chi_square_normalized},
+        {"num_of_partial_keys", num_of_partial_keys},
+        {"partial_key_chi_square_normalized", partial_key_chi_square_normalized},
+        {"max_load_factor", max_load_factor},
+        {"insert_ns", insert_ns}
+    });
+}
+
+/// <summary>
+/// Benchmark every hasher of the hash family on the (unique) substrings of L bytes of the ruleset.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchHashes(BenchmarkLog& bench_log, const RulesetView& exact_matches, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    std::vector<K> keys;
+    keys.reserve(substrings.size());
+    for (const Substring<K>& substring : substrings) {
+        keys.push_back(substring.substring);
+    }
+
+    benchHash<K, CustomHash>(bench_log, "CustomHash", L, keys, iterations);
+    benchHash<K, WyHash>(bench_log, "WyHash", L, keys, iterations);
+    benchHash<K, Xxh3Hash>(bench_log, "Xxh3Hash", L, keys, iterations);
+    benchHash<K, MultiplyShiftHash>(bench_log, "MultiplyShiftHash", L, keys, iterations);
+    benchHash<K, Crc32cHash>(bench_log, "Crc32cHash", L, keys, iterations);
+}
+
+/// <summary>
+/// Time a hashing kernel over the keys, iterations times, and count the hashes which differ from CustomHash.
+/// </summary>
+template<typename K>
+void benchHashKernel(BenchmarkLog& bench_log, const std::string& kernel_name, std::size_t L, typename HashKeysKernel<K>::kernel_type kernel,
+                     const std::vector<K>& keys, const std::vector<std::size_t>& expected_hashes, std::size_t iterations) {
+    std::vector<std::size_t> hashes(keys.size());
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        kernel(keys.data(), keys.size(), hashes.data());
+        bench_sink = hashes[i % hashes.size()];
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double hash_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / (double(keys.size()) * iterations);
+    std::size_t num_of_mismatches = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        num_of_mismatches += (hashes[i] != expected_hashes[i]);
+    }
+
+    std::cout << "L = " << L << ", " << std::setw(7) << std::left << kernel_name << std::right << ": " << hash_ns << "[ns/hash], "    \
+        << num_of_mismatches << " mismatch(es) with CustomHash." << std::endl;
+    bench_log.addData({
+        {"L", L},
+        {"kernel", kernel_name},
+        {"hash_ns", hash_ns},
+        {"num_of_mismatches", num_of_mismatches}
+    });
+}
+
+/// <summary>
+/// Benchmark the batched hashing of the windows of L bytes (L = 4 or 8):
+///  > each kernel (scalar / AVX2 / AVX-512, as supported by the CPU) on the keys of all the windows of the corpus, checked against CustomHash.
+///  > a full scan of the corpus (build windows, hash, look up in a table of the ruleset's substrings):
+///    each window hashed by libcuckoo (CustomHash) vs. batched hashes handed to the lookups (PrehashedHash).
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchBatchHash(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<K> keys;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        keys.push_back(key);
+    });
+    std::vector<std::size_t> expected_hashes(keys.size());
+    CustomHash hasher;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        expected_hashes[i] = hasher(keys[i]);
+    }
+    std::size_t kernel_iterations = std::max<std::size_t>(1, iterations / 10);
+
+    benchHashKernel<K>(bench_log, "scalar", L, hashKeysScalar<K>, keys, expected_hashes, kernel_iterations);
+#if defined BATCH_HASH_HAS_X86_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        if constexpr (sizeof(K) == sizeof(uint32_t)) {
+            benchHashKernel<K>(bench_log, "avx2", L, hashKeys32Avx2, keys, expected_hashes, kernel_iterations);
+        }
+        else {
+            benchHashKernel<K>(bench_log, "avx2", L, hashKeys64Avx2, keys, expected_hashes, kernel_iterations);
+        }
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+        if constexpr (sizeof(K) == sizeof(uint32_t)) {
+            benchHashKernel<K>(bench_log, "avx512", L, hashKeys32Avx512, keys, expected_hashes, kernel_iterations);
+        }
+        else {
+            benchHashKernel<K>(bench_log, "avx512", L, hashKeys64Avx512, keys, expected_hashes, kernel_iterations);
+        }
+    }
+#endif
+
+    // Scan of the corpus, with per window hashing vs. batched hashing
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> table;
+    libcuckoo::cuckoohash_map<K, uint32_t, PrehashedHash<CustomHash>> prehashed_table;
+    table.reserve(substrings.size());
+    prehashed_table.reserve(substrings.size());
+    for (const Substring<K>& substring : substrings) {
+        table.insert(substring.substring, substring.rules);
+        prehashed_table.insert(substring.substring, substring.rules);
+    }
+
+    std::size_t hits = 0;
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        hits += table.contains(key);
+    });
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double scan_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / keys.size();
+
+    std::size_t batched_hits = 0;
+    timestamp_a = std::chrono::high_resolution_clock::now();
+    forEachHashedWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key, std::size_t hash) {
+        PrehashedHash<CustomHash>::arm(key, hash);
+        batched_hits += prehashed_table.contains(key);
+    });
+    timestamp_b = std::chrono::high_resolution_clock::now();
+    double batched_scan_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / keys.size();
+
+    std::cout << "L = " << L << ", scan: " << scan_ns << "[ns/window] hashing each window, " << batched_scan_ns                \
+        << "[ns/window] with batched hashes (" << hits << " / " << batched_hits << " hits)." << std::endl;
+    bench_log.addData({
+        {"L", L},
+        {"kernel", "scan"},
+        {"scan_ns", scan_ns},
+        {"batched_scan_ns", batched_scan_ns},
+        {"num_of_hits", hits},
+        {"num_of_batched_hits", batched_hits}
+    });
+}
+
+/// <summary>
+/// Time the lookups of the given windows in a table (rounds times).
+/// </summary>
+/// <returns>Lookups per second</returns>
+template<typename T, typename K>
+double timeLookups(const T& table, const std::vector<K>& windows, std::size_t rounds, std::size_t* hits) {
+    std::size_t found = 0;
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round) {
+        for (const K& window : windows) {
+            found += table.contains(window);
+        }
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    *hits = found / rounds;
+    return windows.size() * rounds / std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+}
+
+/// <summary>
+/// Benchmark a FrozenCuckooTable with tags of type Tag, frozen from the libcuckoo table of the substrings.
+/// </summary>
+template<typename K, typename Tag>
+void benchFrozenTable(BenchmarkLog& bench_log, std::size_t L, libcuckoo::cuckoohash_map<K, uint32_t, CustomHash>& hash_table,
+                      const std::vector<Substring<K>>& substrings, const std::vector<K>& windows, std::size_t rounds,
+                      double libcuckoo_lookups_per_sec, std::size_t libcuckoo_hits) {
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    FrozenCuckooTable<K, uint32_t, Tag> frozen_table(hash_table);
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double build_ms = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e3;
+
+    // Every substring is found, with the value of the libcuckoo table
+    std::size_t num_of_mismatches = 0;
+    for (const Substring<K>& substring : substrings) {
+        uint32_t value = 0;
+        num_of_mismatches += !frozen_table.find(substring.substring, value) || value != substring.rules;
+    }
+
+    std::size_t hits = 0;
+    double lookups_per_sec = timeLookups(frozen_table, windows, rounds, &hits);
+
+    std::cout << "L = " << L << ", frozen table (" << sizeof(Tag) * 8 << " bits tags): " << lookups_per_sec / 1e6      \
+        << "[M lookups/s] vs. libcuckoo " << libcuckoo_lookups_per_sec / 1e6 << "[M lookups/s], load factor "            \
+        << frozen_table.load_factor() << ", " << frozen_table.memoryBytes() / 1024 << "[KB], "                            \
+        << num_of_mismatches << " mismatches, " << hits << " / " << libcuckoo_hits << " hits." << std::endl;
+    bench_log.addData({
+        {"L", L},
+        {"tag_bits", sizeof(Tag) * 8},
+        {"num_of_keys", frozen_table.size()},
+        {"build_ms", build_ms},
+        {"load_factor", frozen_table.load_factor()},
+        {"size_bytes", frozen_table.memoryBytes()},
+        {"libcuckoo_size_bytes", hash_table.capacity() * sizeof(std::pair<K, uint32_t>)},
+        {"lookups_per_sec", lookups_per_sec},
+        {"libcuckoo_lookups_per_sec", libcuckoo_lookups_per_sec},
+        {"num_of_hits", hits},
+        {"num_of_libcuckoo_hits", libcuckoo_hits},
+        {"num_of_mismatches", num_of_mismatches}
+    });
+}
+
+/// <summary>
+/// Benchmark the frozen (read-only) cuckoo table vs. libcuckoo on the substrings of L bytes: lookups/s of the corpus windows.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchFrozen(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> hash_table;
+    hash_table.reserve(substrings.size());
+    for (const Substring<K>& substring : substrings) {
+        hash_table.insert(substring.substring, substring.rules);
+    }
+
+    std::vector<K> windows;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        windows.push_back(key);
+    });
+    std::size_t rounds = std::max<std::size_t>(1, iterations / 100);
+    std::size_t libcuckoo_hits = 0;
+    double libcuckoo_lookups_per_sec = timeLookups(hash_table, windows, rounds, &libcuckoo_hits);
+
+    benchFrozenTable<K, uint8_t>(bench_log, L, hash_table, substrings, windows, rounds, libcuckoo_lookups_per_sec, libcuckoo_hits);
+    benchFrozenTable<K, uint16_t>(bench_log, L, hash_table, substrings, windows, rounds, libcuckoo_lookups_per_sec, libcuckoo_hits);
+}
+
+/// <summary>
+/// The keys (and values) of a table of num_of_keys keys: the substrings, topped up with random keys (masked to L bytes, value 0)
+/// if there are fewer substrings.
+/// </summary>
+template<typename K, std::size_t L>
+void fillKeys(const std::vector<Substring<K>>& substrings, std::size_t num_of_keys, uint64_t seed, std::vector<K>& keys, std::vector<uint32_t>& values) {
+    for (std::size_t i = 0; i < substrings.size() && keys.size() < num_of_keys; ++i) {
+        keys.push_back(substrings[i].substring);
+        values.push_back(substrings[i].rules);
+    }
+    std::mt19937_64 generator(seed);
+    std::set<K> used_keys(keys.begin(), keys.end());
+    while (keys.size() < num_of_keys) {
+        K key = 0;
+        for (std::size_t byte = 0; byte < L; ++byte) {
+            key = static_cast<K>((key << 8) | static_cast<K>(generator() & 0xff));
+        }
+        if (used_keys.insert(key).second) {
+            keys.push_back(key);
+            values.push_back(0);
+        }
+    }
+}
+
+/// <summary>
+/// Benchmark the batched lookups (contains_batch: buckets of a group of keys prefetched before probing) vs. one lookup at a time,
+/// in frozen tables of each size of TABLE_SIZES. A table holds the substrings of L bytes, topped up with random keys (masked to
+/// L bytes) up to its size. The windows of the corpus (mostly misses) are looked up with their hashes computed in advance,
+/// so only the probes are timed.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchPrefetch(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+
+    std::vector<K> windows;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        windows.push_back(key);
+    });
+    std::vector<std::size_t> hashes(windows.size());
+    hashKeys<K>(windows.data(), windows.size(), hashes.data());
+    std::vector<uint8_t> results(windows.size());
+    std::size_t rounds = std::max<std::size_t>(1, iterations / 100);
+    const std::size_t slot_size = sizeof(uint16_t) + sizeof(K) + sizeof(uint32_t);
+
+    std::size_t table_sizes[] = TABLE_SIZES;
+    for (std::size_t table_size : table_sizes) {
+        std::size_t num_of_keys = static_cast<std::size_t>(table_size * 1024 / slot_size * FROZEN_CUCKOO_TARGET_LOAD_FACTOR);
+        std::vector<K> keys;
+        std::vector<uint32_t> values;
+        fillKeys<K, L>(substrings, num_of_keys, SHUFFLE_SEED ^ table_size, keys, values);
+        FrozenCuckooTable<K, uint32_t> frozen_table(keys, values);
+
+        std::size_t hits = 0;
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+        for (std::size_t round = 0; round < rounds; ++round) {
+            for (std::size_t i = 0; i < windows.size(); ++i) {
+                hits += frozen_table.contains(windows[i], hashes[i]);
+            }
+        }
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+        double single_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / (windows.size() * rounds);
+
+        std::size_t batched_hits = 0;
+        timestamp_a = std::chrono::high_resolution_clock::now();
+        for (std::size_t round = 0; round < rounds; ++round) {
+            frozen_table.contains_batch(windows.data(), hashes.data(), windows.size(), results.data());
+            for (uint8_t result : results) {
+                batched_hits += result;
+            }
+        }
+        timestamp_b = std::chrono::high_resolution_clock::now();
+        double batched_ns = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / (windows.size() * rounds);
+
+        std::cout << "L = " << L << ", " << table_size << "[KB] (" << frozen_table.memoryBytes() / 1024 << "[KB] frozen table): "   \
+            << single_ns << "[ns/lookup] one at a time, " << batched_ns << "[ns/lookup] batched (" << hits / rounds << " / "       \
+            << batched_hits / rounds << " hits)." << std::endl;
+        bench_log.addData({
+            {"L", L},
+            {"G", G},
+            {"table_size", table_size},
+            {"size_bytes", frozen_table.memoryBytes()},
+            {"num_of_keys", frozen_table.size()},
+            {"load_factor", frozen_table.load_factor()},
+            {"single_ns", single_ns},
+            {"batched_ns", batched_ns},
+            {"single_lookups_per_sec", 1e9 / single_ns},
+            {"batched_lookups_per_sec", 1e9 / batched_ns},
+            {"num_of_hits", hits / rounds},
+            {"num_of_batched_hits", batched_hits / rounds}
+        });
+    }
+}
+
+/// <summary>
+/// Time a scan of the corpus (rounds times): every window, hashed in batches, is looked up with lookup(key, hash).
+/// </summary>
+/// <returns>Scan throughput in MB/s</returns>
+template<typename K, std::size_t L, std::size_t G, typename F>
+double timeScan(const std::vector<uint8_t>& corpus, std::size_t rounds, std::size_t* hits, F lookup) {
+    std::size_t found = 0;
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round) {
+        forEachHashedWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key, std::size_t hash) {
+            found += lookup(key, hash);
+        });
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    *hits = found / rounds;
+    return corpus.size() * rounds / std::chrono::duration<double>(timestamp_b - timestamp_a).count() / 1e6;
+}
+
+/// <summary>
+/// Benchmark the binary fuse prefilter of the substrings of L bytes (every G bytes): its size, its false positive rate on the
+/// windows of the corpus missing the table, and the scan throughput of the corpus with and without it, in front of libcuckoo
+/// and of a FrozenCuckooTable.
+/// </summary>
+template<std::size_t L, std::size_t G>
+void benchPrefilter(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    libcuckoo::cuckoohash_map<K, uint32_t, PrehashedHash<CustomHash>> hash_table;
+    hash_table.reserve(substrings.size());
+    std::vector<K> keys;
+    for (const Substring<K>& substring : substrings) {
+        hash_table.insert(substring.substring, substring.rules);
+        keys.push_back(substring.substring);
+    }
+    FrozenCuckooTable<K, uint32_t> frozen_table(hash_table);
+
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    BinaryFuseFilter<K> prefilter(keys);
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double build_ms = std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e3;
+
+    // False positives: the unique windows of the corpus which are not in the table, but pass the filter
+    std::set<K> missing_windows;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        if (!frozen_table.contains(key)) {
+            missing_windows.insert(key);
+        }
+    });
+    std::size_t num_of_false_positives = 0;
+    for (const K& key : missing_windows) {
+        num_of_false_positives += prefilter.contains(key);
+    }
+    double false_positive_rate = missing_windows.empty() ? 0 : double(num_of_false_positives) / missing_windows.size();
+
+    std::size_t rounds = std::max<std::size_t>(1, iterations / 100);
+    std::size_t hits = 0, prefiltered_hits = 0, frozen_hits = 0, frozen_prefiltered_hits = 0;
+    double scan_mbps = timeScan<K, L, G>(corpus, rounds, &hits, [&](K key, std::size_t hash) {
+        PrehashedHash<CustomHash>::arm(key, hash);
+        return hash_table.contains(key);
+    });
+    double prefiltered_scan_mbps = timeScan<K, L, G>(corpus, rounds, &prefiltered_hits, [&](K key, std::size_t hash) {
+        if (!prefilter.contains(key)) {
+            return false;
+        }
+        PrehashedHash<CustomHash>::arm(key, hash);
+        return hash_table.contains(key);
+    });
+    double frozen_scan_mbps = timeScan<K, L, G>(corpus, rounds, &frozen_hits, [&](K key, std::size_t hash) {
+        return frozen_table.contains(key, hash);
+    });
+    double frozen_prefiltered_scan_mbps = timeScan<K, L, G>(corpus, rounds, &frozen_prefiltered_hits, [&](K key, std::size_t hash) {
+        return prefilter.contains(key) && frozen_table.contains(key, hash);
+    });
+
+    std::cout << "L = " << L << ", G = " << G << ": prefilter of " << prefilter.size() << " keys, " << prefilter.sizeBytes()     \
+        << " Bytes (" << prefilter.bitsPerKey() << " bits/key), false positive rate " << false_positive_rate << ". Scan: "      \
+        << scan_mbps << " / " << prefiltered_scan_mbps << "[MB/s] libcuckoo without / with, " << frozen_scan_mbps << " / "    \
+        << frozen_prefiltered_scan_mbps << "[MB/s] frozen table without / with (" << hits << " / " << prefiltered_hits        \
+        << " / " << frozen_hits << " / " << frozen_prefiltered_hits << " hits)." << std::endl;
+    bench_log.addData({
+        {"L", L},
+        {"G", G},
+        {"num_of_keys", prefilter.size()},
+        {"filter_size_bytes", prefilter.sizeBytes()},
+        {"bits_per_key", prefilter.bitsPerKey()},
+        {"build_ms", build_ms},
+        {"num_of_missing_windows", missing_windows.size()},
+        {"num_of_false_positives", num_of_false_positives},
+        {"false_positive_rate", false_positive_rate},
+        {"scan_mbps", scan_mbps},
+        {"prefiltered_scan_mbps", prefiltered_scan_mbps},
+        {"frozen_scan_mbps", frozen_scan_mbps},
+        {"frozen_prefiltered_scan_mbps", frozen_prefiltered_scan_mbps},
+        {"num_of_hits", hits},
+        {"num_of_prefiltered_hits", prefiltered_hits}
+    });
+}
+
+/// <summary>
+/// Scan the flows on num_of_threads threads (rounds times) against the shared table, with a histogram of the SIDs hit per thread.
+/// </summary>
+/// <returns>Wall clock time in seconds</returns>
+template<typename K, std::size_t L, std::size_t G, typename T>
+double timeParallelScan(const T& table, const RulePool& substrings_rules, const std::vector<Span<uint8_t>>& flows, std::size_t max_flow_size,
+                        std::size_t num_of_threads, std::size_t rounds, std::map<int, int>& sids_hit) {
+    std::vector<ScanWorker<K, uint32_t>> workers(num_of_threads);
+    for (ScanWorker<K, uint32_t>& worker : workers) {
+        worker.reserve(max_flow_size);
+    }
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    parallelFor(flows.size() * rounds, num_of_threads, [&](std::size_t thread_index, std::size_t item_index) {
+        ScanWorker<K, uint32_t>& worker = workers[thread_index];
+        const Span<uint8_t>& flow = flows[item_index % flows.size()];
+        scanPayload<K, L, G>(table, static_cast<const BinaryFuseFilter<K>*>(nullptr), flow.data(), flow.size(), worker);
+        for (uint32_t handle : worker.hit_values) {
+            for (uint32_t rule : substrings_rules.getRules(handle)) {
+                worker.sids_hit[rule]++;
+            }
+        }
+    });
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    sids_hit = mergeHistograms(workers);
+    return std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+}
+
+/// <summary>
+/// Benchmark the scaling of the parallel scan (1, 2, 4, ... threads, up to the number of hardware threads) of a set of flows,
+/// against one FrozenCuckooTable shared by the threads. The merged histogram of every run is checked against the 1 thread run.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchThreads(BenchmarkLog& bench_log, const std::string& corpus_name, const RulesetView& exact_matches,
+                  const std::vector<Span<uint8_t>>& flows, std::size_t rounds) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    std::vector<K> keys;
+    std::vector<uint32_t> values;
+    for (const Substring<K>& substring : substrings) {
+        keys.push_back(substring.substring);
+        values.push_back(substring.rules);
+    }
+    FrozenCuckooTable<K, uint32_t> table(keys, values);
+
+    std::size_t total_bytes = 0;
+    std::size_t max_flow_size = 0;
+    for (const Span<uint8_t>& flow : flows) {
+        total_bytes += flow.size();
+        max_flow_size = std::max(max_flow_size, flow.size());
+    }
+    std::vector<std::size_t> thread_counts;
+    std::size_t max_threads = scanThreadCount(0);
+    for (std::size_t num_of_threads = 1; num_of_threads < max_threads; num_of_threads *= 2) {
+        thread_counts.push_back(num_of_threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::map<int, int> single_thread_sids_hit;
+    double single_thread_mbps = 0;
+    for (std::size_t num_of_threads : thread_counts) {
+        std::map<int, int> sids_hit;
+        double seconds = timeParallelScan<K, L, G>(table, substrings_rules, flows, max_flow_size, num_of_threads, rounds, sids_hit);
+        double mbps = total_bytes * rounds / seconds / 1e6;
+        if (num_of_threads == 1) {
+            single_thread_sids_hit = sids_hit;
+            single_thread_mbps = mbps;
+        }
+        bool is_consistent = (sids_hit == single_thread_sids_hit);
+        std::cout << corpus_name << ", L = " << L << ", G = " << G << ", " << num_of_threads << " thread(s): " << mbps     \
+            << "[MB/s] (x" << mbps / single_thread_mbps << "), " << sids_hit.size() << " SID(s) hit"                       \
+            << (is_consistent ? "" : ", HISTOGRAM DIFFERS FROM 1 THREAD") << "." << std::endl;
+        bench_log.addData({
+            {"corpus", corpus_name},
+            {"L", L},
+            {"G", G},
+            {"num_of_threads", num_of_threads},
+            {"num_of_flows", flows.size()},
+            {"scanned_bytes", total_bytes * rounds},
+            {"seconds", seconds},
+            {"mbps", mbps},
+            {"speedup", mbps / single_thread_mbps},
+            {"num_of_sids_hit", sids_hit.size()},
+            {"is_consistent", is_consistent}
+        });
+    }
+}
+
+/// <summary>
+/// Benchmark the single pass scan of the flows against the tables of L = 4 and L = 8 at once (scanPayloadMultiLength) vs. the
+/// two scans back to back (a scan of L = 4, then a scan of L = 8, see timeParallelScan), on the threads of SCAN_THREADS.
+/// The distinct SIDs of every flow are checked against the union of the SIDs of the two separate scans.
+/// </summary>
+template<std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchMultiLength(BenchmarkLog& bench_log, const std::string& corpus_name, const RulesetView& exact_matches,
+                      const std::vector<Span<uint8_t>>& flows, std::size_t rounds) {
+    typedef SubstringKey<4>::type KS;
+    typedef SubstringKey<8>::type KL;
+    std::vector<Substring<KS>> short_substrings;
+    std::vector<Substring<KL>> long_substrings;
+    RulePool short_rules, long_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    std::size_t num_of_unique_rules = parseExactMatches<KS, 4, G>(exact_matches, short_substrings, short_rules, substrings_log);
+    num_of_unique_rules += parseExactMatches<KL, 8, G>(exact_matches, long_substrings, long_rules, substrings_log);
+    std::vector<KS> short_keys;
+    std::vector<KL> long_keys;
+    std::vector<uint32_t> short_values, long_values;
+    for (const Substring<KS>& substring : short_substrings) {
+        short_keys.push_back(substring.substring);
+        short_values.push_back(substring.rules);
+    }
+    for (const Substring<KL>& substring : long_substrings) {
+        long_keys.push_back(substring.substring);
+        long_values.push_back(substring.rules);
+    }
+    FrozenCuckooTable<KS, uint32_t> short_table(short_keys, short_values);
+    FrozenCuckooTable<KL, uint32_t> long_table(long_keys, long_values);
+    auto short_sids = [&](uint32_t handle) { return short_rules.getRules(handle); };
+    auto long_sids = [&](uint32_t handle) { return long_rules.getRules(handle); };
+
+    std::size_t total_bytes = 0;
+    std::size_t max_flow_size = 0;
+    for (const Span<uint8_t>& flow : flows) {
+        total_bytes += flow.size();
+        max_flow_size = std::max(max_flow_size, flow.size());
+    }
+    std::size_t num_of_threads = scanThreadCount(SCAN_THREADS);
+
+    // Back to back: every flow is scanned for the windows of 4 bytes, then every flow again for the windows of 8 bytes
+    std::map<int, int> short_sids_hit, long_sids_hit;
+    double separate_seconds = timeParallelScan<KS, 4, G>(short_table, short_rules, flows, max_flow_size, num_of_threads, rounds, short_sids_hit);
+    separate_seconds += timeParallelScan<KL, 8, G>(long_table, long_rules, flows, max_flow_size, num_of_threads, rounds, long_sids_hit);
+
+    // Single pass
+    std::vector<MultiLengthScanWorker<KS, KL, uint32_t>> workers(num_of_threads);
+    for (MultiLengthScanWorker<KS, KL, uint32_t>& worker : workers) {
+        worker.reserve(max_flow_size, num_of_unique_rules);
+    }
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    parallelFor(flows.size() * rounds, num_of_threads, [&](std::size_t thread_index, std::size_t item_index) {
+        MultiLengthScanWorker<KS, KL, uint32_t>& worker = workers[thread_index];
+        const Span<uint8_t>& flow = flows[item_index % flows.size()];
+        scanPayloadMultiLength<KS, 4, KL, 8, G>(short_table, long_table, flow.data(), flow.size(), worker, short_sids, long_sids);
+        for (uint32_t sid : worker.sids) {
+            worker.sids_hit[sid]++;
+        }
+    });
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double single_pass_seconds = std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+    std::size_t lookups = 0, duplicate_sids = 0;
+    for (const MultiLengthScanWorker<KS, KL, uint32_t>& worker : workers) {
+        lookups += worker.lookups();
+        duplicate_sids += worker.duplicate_sids;
+    }
+    std::map<int, int> sids_hit = mergeHistograms(workers);
+
+    // Check: the SIDs of each flow are the union of the SIDs of the two separate scans
+    std::size_t num_of_mismatches = 0;
+    ScanWorker<KS, uint32_t> short_worker;
+    ScanWorker<KL, uint32_t> long_worker;
+    short_worker.reserve(max_flow_size);
+    long_worker.reserve(max_flow_size);
+    for (const Span<uint8_t>& flow : flows) {
+        scanPayload<KS, 4, G>(short_table, static_cast<const BinaryFuseFilter<KS>*>(nullptr), flow.data(), flow.size(), short_worker);
+        scanPayload<KL, 8, G>(long_table, static_cast<const BinaryFuseFilter<KL>*>(nullptr), flow.data(), flow.size(), long_worker);
+        std::set<uint32_t> expected_sids;
+        for (uint32_t handle : short_worker.hit_values) {
+            Span<uint32_t> rules = short_rules.getRules(handle);
+            expected_sids.insert(rules.begin(), rules.end());
+        }
+        for (uint32_t handle : long_worker.hit_values) {
+            Span<uint32_t> rules = long_rules.getRules(handle);
+            expected_sids.insert(rules.begin(), rules.end());
+        }
+        scanPayloadMultiLength<KS, 4, KL, 8, G>(short_table, long_table, flow.data(), flow.size(), workers[0], short_sids, long_sids);
+        num_of_mismatches += (std::set<uint32_t>(workers[0].sids.begin(), workers[0].sids.end()) != expected_sids);
+    }
+
+    double separate_mbps = total_bytes * rounds / separate_seconds / 1e6;
+    double single_pass_mbps = total_bytes * rounds / single_pass_seconds / 1e6;
+    std::cout << corpus_name << ", L = 4 + 8, G = " << G << ", " << num_of_threads << " thread(s): single pass " << single_pass_mbps  \
+        << "[MB/s] vs. back to back " << separate_mbps << "[MB/s] (x" << single_pass_mbps / separate_mbps << "), "            \
+        << sids_hit.size() << " SID(s) hit (" << short_sids_hit.size() << " with L = 4, " << long_sids_hit.size()           \
+        << " with L = 8), " << duplicate_sids << " duplicate SID hit(s) merged, " << num_of_mismatches << " mismatch(es)." << std::endl;
+    bench_log.addData({
+        {"corpus", corpus_name},
+        {"G", G},
+        {"num_of_threads", num_of_threads},
+        {"num_of_flows", flows.size()},
+        {"scanned_bytes", total_bytes * rounds},
+        {"lookups", lookups},
+        {"single_pass_seconds", single_pass_seconds},
+        {"single_pass_mbps", single_pass_mbps},
+        {"separate_seconds", separate_seconds},
+        {"separate_mbps", separate_mbps},
+        {"speedup", single_pass_mbps / separate_mbps},
+        {"num_of_sids_hit", sids_hit.size()},
+        {"num_of_short_sids_hit", short_sids_hit.size()},
+        {"num_of_long_sids_hit", long_sids_hit.size()},
+        {"duplicate_sids", duplicate_sids},
+        {"num_of_mismatches", num_of_mismatches}
+    });
+}
+
+/// <summary>
+/// Benchmark the startup of a scanner: building the table of the substrings of L bytes (parse the substrings, insert them into
+/// libcuckoo with their SID lists in a SidArena, freeze it) vs. restoring it from its snapshot (TableSnapshot.h, written from
+/// the built table into dest_path). Time and resident memory (private / mapped file) of each, and the lookups of the corpus
+/// windows in the restored table are checked against the built one.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchSnapshot(BenchmarkLog& bench_log, const std::string& dest_path, const RulesetFile& ruleset, const std::vector<uint8_t>& corpus) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<K> windows;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        windows.push_back(key);
+    });
+
+    // Build path
+    std::size_t anon_before_build = processMemoryBytes("RssAnon");
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    SidArena sid_arena;
+    std::unique_ptr<FrozenCuckooTable<K, uint32_t>> built_table;
+    {
+        std::vector<Substring<K>> substrings;
+        RulePool substrings_rules;
+        SubstringLogger substrings_log;     // required by the parser, not written
+        parseExactMatches<K, L, G>(ruleset.view(), substrings, substrings_rules, substrings_log);
+        libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> hash_table(substrings.size());
+        for (const Substring<K>& substring : substrings) {
+            hash_table.insert(substring.substring, sid_arena.add(substrings_rules, substring.rules));
+        }
+        sid_arena.shrinkToFit();
+        built_table.reset(new FrozenCuckooTable<K, uint32_t>(hash_table));
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    double build_ms = std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+    std::size_t build_anon_bytes = std::max(processMemoryBytes("RssAnon"), anon_before_build) - anon_before_build;
+
+    std::string snapshot_path = defaultSnapshotPath(dest_path, L, G);
+    writeTableSnapshot(snapshot_path, *built_table, sid_arena, L, G, ruleset.header().checksum);
+
+    // Restore path (the pages of the snapshot are mapped in by the lookups)
+    std::size_t anon_before_restore = processMemoryBytes("RssAnon");
+    std::size_t file_before_restore = processMemoryBytes("RssFile");
+    timestamp_a = std::chrono::high_resolution_clock::now();
+    TableSnapshot<K, uint32_t> snapshot;
+    bool is_restored = snapshot.open(snapshot_path, L, G, ruleset.header().checksum);
+    timestamp_b = std::chrono::high_resolution_clock::now();
+    double restore_ms = std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+
+    std::size_t num_of_hits = 0;
+    std::size_t num_of_mismatches = 0;
+    for (const K& window : windows) {
+        uint32_t built_offset = 0, restored_offset = 0;
+        bool is_built_hit = built_table->find(window, built_offset);
+        bool is_restored_hit = is_restored && snapshot.table().find(window, restored_offset);
+        num_of_hits += is_built_hit;
+        if (is_built_hit != is_restored_hit) {
+            ++num_of_mismatches;
+        }
+        else if (is_built_hit) {
+            Span<uint32_t> built_sids = sid_arena.getSids(built_offset);
+            Span<uint32_t> restored_sids = snapshot.sidArena().getSids(restored_offset);
+            num_of_mismatches += !std::equal(built_sids.begin(), built_sids.end(), restored_sids.begin(), restored_sids.end());
+        }
+    }
+    std::size_t restore_anon_bytes = std::max(processMemoryBytes("RssAnon"), anon_before_restore) - anon_before_restore;
+    std::size_t restore_file_bytes = std::max(processMemoryBytes("RssFile"), file_before_restore) - file_before_restore;
+
+    std::cout << "L = " << L << ", G = " << G << ": build " << build_ms << "[ms], " << build_anon_bytes / 1024            \
+        << "[KB] private; restore " << (is_restored ? "" : "FAILED ") << restore_ms << "[ms], " << restore_anon_bytes / 1024 \
+        << "[KB] private + " << restore_file_bytes / 1024 << "[KB] shared (snapshot of " << snapshot.sizeBytes() / 1024     \
+        << "[KB]), " << num_of_hits << " hits, " << num_of_mismatches << " mismatch(es)." << std::endl;
+    bench_log.addData({
+        {"L", L},
+        {"G", G},
+        {"num_of_keys", built_table->size()},
+        {"build_ms", build_ms},
+        {"build_private_bytes", build_anon_bytes},
+        {"is_restored", is_restored},
+        {"restore_ms", restore_ms},
+        {"restore_private_bytes", restore_anon_bytes},
+        {"restore_shared_bytes", restore_file_bytes},
+        {"snapshot_bytes", snapshot.sizeBytes()},
+        {"num_of_hits", num_of_hits},
+        {"num_of_mismatches", num_of_mismatches}
+    });
+}
+
+/// <summary>
+/// Benchmark the minimal perfect hash index (PerfectHashIndex.h) vs. libcuckoo, for the keys each table size of TABLE_SIZES holds
+/// in libcuckoo (at MAX_LOAD_FACTOR): the substrings of L bytes, topped up with random keys. Both are built from the same keys:
+/// bits per key, build time, and the latency of a single lookup (one at a time) of the keys (hits) and of the corpus windows.
+/// </summary>
+template<std::size_t L, std::size_t G = SUBSTRING_DEFAULT_GAP>
+void benchPerfectHash(BenchmarkLog& bench_log, const RulesetView& exact_matches, const std::vector<uint8_t>& corpus, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+
+    std::vector<K> windows;
+    forEachWindow<K, L, G>(corpus.data(), corpus.size(), true, [&](K key) {
+        windows.push_back(key);
+    });
+    std::size_t rounds = std::max<std::size_t>(1, iterations / 100);
+    const std::size_t slot_size = sizeof(std::pair<K, uint32_t>);
+
+    std::size_t table_sizes[] = TABLE_SIZES;
+    for (std::size_t table_size : table_sizes) {
+        std::size_t num_of_keys = static_cast<std::size_t>(table_size * 1024 / slot_size * MAX_LOAD_FACTOR);
+        std::vector<K> keys;
+        std::vector<uint32_t> values;
+        fillKeys<K, L>(substrings, num_of_keys, SHUFFLE_SEED ^ table_size, keys, values);
+
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+        libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> hash_table(table_size * 1024 / slot_size);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            hash_table.insert(keys[i], values[i]);
+        }
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+        double libcuckoo_build_ms = std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+
+        timestamp_a = std::chrono::high_resolution_clock::now();
+        PerfectHashIndex<K, uint32_t> index(keys, values);
+        timestamp_b = std::chrono::high_resolution_clock::now();
+        double build_ms = std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+
+        // Every key is found, with its value
+        std::size_t num_of_mismatches = 0;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            uint32_t value = 0;
+            num_of_mismatches += !index.find(keys[i], value) || value != values[i];
+        }
+
+        std::vector<K> shuffled_keys(keys);
+        deterministicShuffle(shuffled_keys, SHUFFLE_SEED);
+        std::size_t hits = 0, libcuckoo_hits = 0, window_hits = 0, libcuckoo_window_hits = 0;
+        double hit_ns = 1e9 / timeLookups(index, shuffled_keys, rounds, &hits);
+        double libcuckoo_hit_ns = 1e9 / timeLookups(hash_table, shuffled_keys, rounds, &libcuckoo_hits);
+        double window_ns = 1e9 / timeLookups(index, windows, rounds, &window_hits);
+        double libcuckoo_window_ns = 1e9 / timeLookups(hash_table, windows, rounds, &libcuckoo_window_hits);
+
+        std::size_t libcuckoo_size = hash_table.capacity() * slot_size;
+        double libcuckoo_bits_per_key = 8.0 * libcuckoo_size / keys.size();
+        std::cout << "L = " << L << ", " << std::setw(3) << table_size << "[KB], " << keys.size() << " keys: perfect hash "       \
+            << index.bitsPerKey() << " bits/key (" << index.hashBitsPerKey() << " of hash), build " << build_ms << "[ms], "     \
+            << hit_ns << " / " << window_ns << "[ns/lookup] keys / corpus; libcuckoo " << libcuckoo_bits_per_key                \
+            << " bits/key, build " << libcuckoo_build_ms << "[ms], " << libcuckoo_hit_ns << " / " << libcuckoo_window_ns      \
+            << "[ns/lookup] (" << num_of_mismatches << " mismatches, " << window_hits << " / " << libcuckoo_window_hits        \
+            << " corpus hits)." << std::endl;
+        bench_log.addData({
+            {"L", L},
+            {"G", G},
+            {"table_size", table_size},
+            {"num_of_keys", keys.size()},
+            {"size_bytes", index.memoryBytes()},
+            {"bits_per_key", index.bitsPerKey()},
+            {"hash_bits_per_key", index.hashBitsPerKey()},
+            {"build_ms", build_ms},
+            {"hit_ns", hit_ns},
+            {"corpus_ns", window_ns},
+            {"libcuckoo_size_bytes", libcuckoo_size},
+            {"libcuckoo_bits_per_key", libcuckoo_bits_per_key},
+            {"libcuckoo_build_ms", libcuckoo_build_ms},
+            {"libcuckoo_hit_ns", libcuckoo_hit_ns},
+            {"libcuckoo_corpus_ns", libcuckoo_window_ns},
+            {"num_of_mismatches", num_of_mismatches},
+            {"num_of_corpus_hits", window_hits},
+            {"num_of_libcuckoo_corpus_hits", libcuckoo_window_hits}
+        });
+    }
+}
+
+/// <summary>
+/// Time the lookups of the probes in a table (rounds times), reading the list of SIDs of each hit (its value is the offset of
+/// the list in sid_arena), and count the dTLB load misses meanwhile.
+/// </summary>
+/// <returns>Nanoseconds per lookup</returns>
+template<typename T, typename K>
+double timeListLookups(const T& table, const SidArena& sid_arena, const std::vector<K>& probes, std::size_t rounds,
+                       DtlbMissCounter& dtlb_misses, uint64_t* misses, std::size_t* hits) {
+    std::size_t found = 0;
+    std::size_t sum = 0;
+    dtlb_misses.start();
+    auto timestamp_a = std::chrono::high_resolution_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round) {
+        for (const K& probe : probes) {
+            uint32_t offset = 0;
+            if (table.find(probe, offset)) {
+                ++found;
+                for (uint32_t sid : sid_arena.getSids(offset)) {
+                    sum += sid;
+                }
+            }
+        }
+    }
+    auto timestamp_b = std::chrono::high_resolution_clock::now();
+    *misses = dtlb_misses.stop() / rounds;
+    *hits = found / rounds;
+    bench_sink = bench_sink + sum;
+    return std::chrono::duration<double>(timestamp_b - timestamp_a).count() * 1e9 / (probes.size() * rounds);
+}
+
+/// <summary>
+/// Benchmark the huge page backing (HugePages.h) of the structures a scan reads, on synthetic rulesets of each size of
+/// BENCH_HUGE_PAGES_SIZES: random keys of L bytes, each with a list of 1 - 4 SIDs in a SidArena, in a FrozenCuckooTable and in a
+/// libcuckoo table. The lookups (random order, half of them hits whose lists are read) are timed with the tables and the lists
+/// in the default allocator's memory, then in a HugePageArena: ns/lookup and dTLB load misses per lookup (where perf events are
+/// permitted and the CPU has a dTLB event, else null).
+/// </summary>
+template<std::size_t L>
+void benchHugePages(BenchmarkLog& bench_log, std::size_t iterations) {
+    typedef typename SubstringKey<L>::type K;
+    typedef libcuckoo::cuckoohash_map<K, uint32_t, CustomHash, std::equal_to<K>, HugePageAllocator<std::pair<const K, uint32_t>>> huge_table_type;
+    const std::size_t slot_size = sizeof(uint16_t) + sizeof(K) + sizeof(uint32_t);
+    std::size_t rounds = std::max<std::size_t>(1, iterations / 100);
+    DtlbMissCounter dtlb_misses;
+
+    std::size_t table_sizes[] = BENCH_HUGE_PAGES_SIZES;
+    for (std::size_t table_size : table_sizes) {
+        // The synthetic ruleset: the value of a key is the offset of its list of SIDs
+        std::size_t num_of_keys = static_cast<std::size_t>(table_size * 1024 / slot_size * FROZEN_CUCKOO_TARGET_LOAD_FACTOR);
+        std::vector<K> keys;
+        std::vector<uint32_t> values;
+        fillKeys<K, L>(std::vector<Substring<K>>(), num_of_keys, SHUFFLE_SEED ^ table_size, keys, values);
+        std::mt19937_64 generator(SHUFFLE_SEED ^ table_size);
+        SidArena sid_arena;
+        std::vector<uint32_t> sids;
+        for (uint32_t& value : values) {
+            sids.assign(1 + generator() % 4, 0);
+            for (uint32_t& sid : sids) {
+                sid = static_cast<uint32_t>(generator() % 1000000);
+            }
+            value = sid_arena.add(Span<uint32_t>(sids.data(), sids.size()));
+        }
+        sid_arena.shrinkToFit();
+
+        // The probes: the keys (hits) and as many random keys (mostly misses), shuffled
+        std::vector<K> probes(keys);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            K key = 0;
+            for (std::size_t byte = 0; byte < L; ++byte) {
+                key = static_cast<K>((key << 8) | static_cast<K>(generator() & 0xff));
+            }
+            probes.push_back(key);
+        }
+        deterministicShuffle(probes, SHUFFLE_SEED);
+        std::size_t probe_rounds = std::max<std::size_t>(1, rounds * (std::size_t(1) << 20) / probes.size());
+
+        FrozenCuckooTable<K, uint32_t> frozen_table(keys, values);
+        libcuckoo::cuckoohash_map<K, uint32_t, CustomHash> hash_table(static_cast<std::size_t>(keys.size() / MAX_LOAD_FACTOR));
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            hash_table.insert(keys[i], values[i]);
+        }
+
+        // The same structures in huge pages
+        HugePageArena huge_pages;
+        FrozenCuckooTable<K, uint32_t> huge_frozen_table(frozen_table);
+        moveToHugePages(huge_frozen_table, huge_pages);
+        SidArena huge_sid_arena;
+        huge_sid_arena.attach(sid_arena.data(), sid_arena.sizeWords());
+        moveToHugePages(huge_sid_arena, huge_pages);
+        huge_table_type huge_table(static_cast<std::size_t>(keys.size() / MAX_LOAD_FACTOR), CustomHash(), std::equal_to<K>(),
+                                   HugePageAllocator<std::pair<const K, uint32_t>>(&huge_pages));
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            huge_table.insert(keys[i], values[i]);
+        }
+
+        uint64_t frozen_misses = 0, huge_frozen_misses = 0, libcuckoo_misses = 0, huge_libcuckoo_misses = 0;
+        std::size_t frozen_hits = 0, huge_frozen_hits = 0, libcuckoo_hits = 0, huge_libcuckoo_hits = 0;
+        double frozen_ns = timeListLookups(frozen_table, sid_arena, probes, probe_rounds, dtlb_misses, &frozen_misses, &frozen_hits);
+        double huge_frozen_ns = timeListLookups(huge_frozen_table, huge_sid_arena, probes, probe_rounds, dtlb_misses, &huge_frozen_misses, &huge_frozen_hits);
+        double libcuckoo_ns = timeListLookups(hash_table, sid_arena, probes, probe_rounds, dtlb_misses, &libcuckoo_misses, &libcuckoo_hits);
+        double huge_libcuckoo_ns = timeListLookups(huge_table, huge_sid_arena, probes, probe_rounds, dtlb_misses, &huge_libcuckoo_misses, &huge_libcuckoo_hits);
+        double num_of_probes = double(probes.size());
+
+        // The dTLB misses per lookup are only reported where they are counted (null / "not counted" otherwise: e.g. in a VM
+        //  without a PMU, where perf_event_open has no dTLB event), never as 0
+        auto dtlb_text = [&](uint64_t misses, uint64_t huge_misses) {
+            return dtlb_misses.available() ? " (" + std::to_string(misses / num_of_probes) + " -> " +
+                std::to_string(huge_misses / num_of_probes) + " dTLB misses/lookup)" : std::string(" (dTLB misses not counted)");
+        };
+        auto dtlb_json = [&](uint64_t misses) {
+            return dtlb_misses.available() ? nlohmann::json(misses / num_of_probes) : nlohmann::json(nullptr);
+        };
+
+        std::cout << "L = " << L << ", " << table_size << "[KB] (" << keys.size() << " keys, " << sid_arena.sizeBytes() / 1024     \
+            << "[KB] of lists), " << hugePageBackingName(huge_pages.backing()) << " (" << huge_pages.hugePageBytes() / 1024        \
+            << " of " << huge_pages.mappedBytes() / 1024 << "[KB] in huge pages): frozen " << frozen_ns << " -> " << huge_frozen_ns \
+            << "[ns/lookup]" << dtlb_text(frozen_misses, huge_frozen_misses) << ", libcuckoo " << libcuckoo_ns << " -> "           \
+            << huge_libcuckoo_ns << "[ns/lookup]" << dtlb_text(libcuckoo_misses, huge_libcuckoo_misses) << ", "                    \
+            << frozen_hits << " / " << huge_frozen_hits << " / " << libcuckoo_hits << " / " << huge_libcuckoo_hits << " hits."  \
+            << std::endl;
+        bench_log.addData({
+            {"L", L},
+            {"table_size", table_size},
+            {"num_of_keys", keys.size()},
+            {"num_of_probes", probes.size()},
+            {"frozen_size_bytes", frozen_table.memoryBytes()},
+            {"libcuckoo_size_bytes", hash_table.capacity() * sizeof(std::pair<K, uint32_t>)},
+            {"sid_lists_bytes", sid_arena.sizeBytes()},
+            {"transparent_huge_pages", transparentHugePagesMode()},
+            {"backing", hugePageBackingName(huge_pages.backing())},
+            {"arena_used_bytes", huge_pages.usedBytes()},
+            {"arena_mapped_bytes", huge_pages.mappedBytes()},
+            {"huge_page_bytes", huge_pages.hugePageBytes()},
+            {"dtlb_misses_counted", dtlb_misses.available()},
+            {"frozen_ns", frozen_ns},
+            {"frozen_huge_pages_ns", huge_frozen_ns},
+            {"frozen_dtlb_misses_per_lookup", dtlb_json(frozen_misses)},
+            {"frozen_huge_pages_dtlb_misses_per_lookup", dtlb_json(huge_frozen_misses)},
+            {"libcuckoo_ns", libcuckoo_ns},
+            {"libcuckoo_huge_pages_ns", huge_libcuckoo_ns},
+            {"libcuckoo_dtlb_misses_per_lookup", dtlb_json(libcuckoo_misses)},
+            {"libcuckoo_huge_pages_dtlb_misses_per_lookup", dtlb_json(huge_libcuckoo_misses)},
+            {"num_of_hits", frozen_hits},
+            {"num_of_huge_pages_hits", huge_frozen_hits},
+            {"num_of_libcuckoo_hits", libcuckoo_hits},
+            {"num_of_libcuckoo_huge_pages_hits", huge_libcuckoo_hits}
+        });
+    }
+}
+
+/// <summary>
+/// Benchmark a libcuckoo layout of S slots per bucket in each memory budget of TABLE_SIZES: the hashpower is the largest one whose
+/// table (2^hashpower buckets of S slots) fits in the budget, and the table may not grow past it. The substrings are inserted (in a
+/// fixed shuffled order) until the table is full, then all of them are looked up (the inserted ones hit, the others miss).
+/// </summary>
+/// <typeparam name="S">Slots per bucket (associativity) of the table</typeparam>
+template<typename K, std::size_t S>
+void benchLayoutAssociativity(Statistics& stats, std::size_t L, const std::vector<Substring<K>>& substrings, const RulePool& substrings_rules,
+                              std::size_t num_of_unique_rules) {
+    typedef libcuckoo::cuckoohash_map<K, uint32_t, CustomHash, std::equal_to<K>, std::allocator<std::pair<const K, uint32_t>>, S> table_type;
+    const std::size_t slot_size = sizeof(std::pair<K, uint32_t>);
+    std::size_t table_sizes[] = TABLE_SIZES;
+    for (std::size_t table_size : table_sizes) {
+        std::size_t hash_power = 1;
+        while ((std::size_t(2) << hash_power) * S * slot_size <= table_size * 1024) {
+            ++hash_power;
+        }
+
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+        table_type hash_table((std::size_t(1) << hash_power) * S);
+        hash_table.maximum_hashpower(hash_table.hashpower());
+        std::size_t num_of_inserted = 0;
+        try {
+            for (const Substring<K>& substring : substrings) {
+                hash_table.insert(substring.substring, substring.rules);
+                ++num_of_inserted;
+            }
+        }
+        catch (const libcuckoo::maximum_hashpower_exceeded&) {
+            // the table is full
+        }
+        catch (const libcuckoo::load_factor_too_low&) {
+            // the table is full (an unlucky cuckoo path at a low load factor)
+        }
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+        double insert_ms = std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+
+        std::size_t found = 0;
+        timestamp_a = std::chrono::high_resolution_clock::now();
+        for (const Substring<K>& substring : substrings) {
+            found += hash_table.contains(substring.substring);
+        }
+        timestamp_b = std::chrono::high_resolution_clock::now();
+        double lookup_time = std::chrono::duration<double>(timestamp_b - timestamp_a).count();
+        bench_sink = found;
+
+        std::set<uint32_t> unique_rules_inserted;
+        for (std::size_t i = 0; i < num_of_inserted; ++i) {
+            Span<uint32_t> rules = substrings_rules.getRules(substrings[i].rules);
+            unique_rules_inserted.insert(rules.begin(), rules.end());
+        }
+        std::size_t table_bytes = hash_table.capacity() * slot_size;
+        double load_factor = hash_table.load_factor();
+        double bytes_per_key = num_of_inserted ? double(table_bytes) / num_of_inserted : 0;
+        double lookup_throughput = (lookup_time > 0) ? substrings.size() / lookup_time / 1e6 : 0;
+
+        std::cout << "L = " << L << ", " << std::setw(3) << table_size << "[KB], " << std::setw(2) << S << " slots/bucket, hashpower "  \
+            << hash_table.hashpower() << ": max load factor " << load_factor << ", " << num_of_inserted << " key(s) inserted in "   \
+            << insert_ms << "[ms], " << lookup_throughput << "[M lookups/s], " << bytes_per_key << " Bytes/key." << std::endl;
+        stats.addData({
+            table_size,
+            0,
+            0,
+            load_factor,
+            double(unique_rules_inserted.size()),
+            num_of_unique_rules ? double(unique_rules_inserted.size()) / num_of_unique_rules * 100 : 0,
+            double(num_of_inserted),
+            double(num_of_inserted) / substrings.size() * 100,
+            double(hash_table.hashpower()),
+            insert_ms,
+            bytes_per_key,
+            0,
+            lookup_throughput,
+            0,
+            S
+        });
+    }
+}
+
+/// <summary>
+/// Benchmark the libcuckoo layouts (slots per bucket x hashpower, see benchLayoutAssociativity) for the substrings of L bytes
+/// (every G bytes), to find the layout with the highest load factor and lookups/s in a given memory budget.
+/// </summary>
+template<std::size_t L, std::size_t G>
+void benchLayout(const std::string& dest_path, const RulesetView& exact_matches) {
+    typedef typename SubstringKey<L>::type K;
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log;     // required by the parser, not written
+    std::size_t num_of_unique_rules = parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+    deterministicShuffle(substrings, SHUFFLE_SEED);
+
+    Statistics layout_stats;
+    benchLayoutAssociativity<K, 2>(layout_stats, L, substrings, substrings_rules, num_of_unique_rules);
+    benchLayoutAssociativity<K, 4>(layout_stats, L, substrings, substrings_rules, num_of_unique_rules);
+    benchLayoutAssociativity<K, 8>(layout_stats, L, substrings, substrings_rules, num_of_unique_rules);
+    benchLayoutAssociativity<K, 16>(layout_stats, L, substrings, substrings_rules, num_of_unique_rules);
+    layout_stats.writeToFile(dest_path, "bench_layout_L" + std::to_string(L) + "_G" + std::to_string(G) + ".json");
+}
+
+/// <summary>
+/// Benchmarks of the cuckoohash engine, see the list of modes above.
+/// </summary>
+/// <param name="argv">Run with path to exact_matches_hex.json (-f), destination (-d), mode (-m), iterations (-n) and test payloads (-t).</param>
+int main(int argc, char* argv[]) {
+    std::string file_path = "parta_data_by_exactmatch.json";
+    std::string dest_path = ".";
+    std::string mode = BENCH_MODE_ALL;
+    std::string test_path = "";
+    std::string ruleset_path = "";
+    std::size_t iterations = BENCH_ITERATIONS;
+
+    getBenchOpts(argc, argv, file_path, dest_path, mode, &iterations, test_path, ruleset_path);
+
+    RulesetFile ruleset;
+    loadRuleset(file_path, ruleset_path, ruleset);
+    const RulesetView& exact_matches = ruleset.view();
+
+    std::vector<SearchResults> search_items;
+    if (!test_path.empty()) {
+        parseFile(test_path, search_items);
+    }
+    std::vector<uint8_t> corpus = generateCorpus(BENCH_CORPUS_SIZE, SHUFFLE_SEED);
+    createDir(dest_path);
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_LENGTHS) {
+        std::cout << "Benchmark: substring lengths" << std::endl;
+        BenchmarkLog lengths_log;
+        benchLength<2>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<3>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<4>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<5>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<6>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<8>(lengths_log, exact_matches, search_items, corpus, iterations);
+#if SUBSTRING_MAX_LENGTH > 8
+        benchLength<12>(lengths_log, exact_matches, search_items, corpus, iterations);
+        benchLength<16>(lengths_log, exact_matches, search_items, corpus, iterations);
+#endif
+        lengths_log.writeToFile(dest_path, "bench_lengths.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_HASHES) {
+        std::cout << "Benchmark: hash functions" << std::endl;
+        BenchmarkLog hashes_log;
+        benchHashes<2>(hashes_log, exact_matches, iterations);
+        benchHashes<4>(hashes_log, exact_matches, iterations);
+        benchHashes<8>(hashes_log, exact_matches, iterations);
+#if SUBSTRING_MAX_LENGTH > 8
+        benchHashes<16>(hashes_log, exact_matches, iterations);
+#endif
+        hashes_log.writeToFile(dest_path, "bench_hashes.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_BATCH) {
+        std::cout << "Benchmark: batched window hashing" << std::endl;
+        BenchmarkLog batch_log;
+        benchBatchHash<4>(batch_log, exact_matches, corpus, iterations);
+        benchBatchHash<8>(batch_log, exact_matches, corpus, iterations);
+        batch_log.writeToFile(dest_path, "bench_batch.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_FROZEN) {
+        std::cout << "Benchmark: frozen cuckoo table" << std::endl;
+        BenchmarkLog frozen_log;
+        benchFrozen<2>(frozen_log, exact_matches, corpus, iterations);
+        benchFrozen<4>(frozen_log, exact_matches, corpus, iterations);
+        benchFrozen<8>(frozen_log, exact_matches, corpus, iterations);
+#if SUBSTRING_MAX_LENGTH > 8
+        benchFrozen<16>(frozen_log, exact_matches, corpus, iterations);
+#endif
+        frozen_log.writeToFile(dest_path, "bench_frozen.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_PREFETCH) {
+        std::cout << "Benchmark: batched lookups with prefetching" << std::endl;
+        BenchmarkLog prefetch_log;
+        benchPrefetch<4>(prefetch_log, exact_matches, corpus, iterations);
+        benchPrefetch<8>(prefetch_log, exact_matches, corpus, iterations);
+        prefetch_log.writeToFile(dest_path, "bench_prefetch.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_PREFILTER) {
+        std::cout << "Benchmark: binary fuse prefilter" << std::endl;
+        BenchmarkLog prefilter_log;
+        benchPrefilter<4, 1>(prefilter_log, exact_matches, corpus, iterations);
+        benchPrefilter<4, 2>(prefilter_log, exact_matches, corpus, iterations);
+        benchPrefilter<8, 1>(prefilter_log, exact_matches, corpus, iterations);
+        benchPrefilter<8, 2>(prefilter_log, exact_matches, corpus, iterations);
+        prefilter_log.writeToFile(dest_path, "bench_prefilter.json");
+    }
+
+    // The test payloads (each one a flow), and a large synthetic corpus cut into flows of BENCH_FLOW_SIZE Bytes
+    std::vector<Span<uint8_t>> test_flows;
+    std::vector<uint8_t> large_corpus;
+    std::vector<Span<uint8_t>> corpus_flows;
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_THREADS || mode == BENCH_MODE_MULTI_LENGTH) {
+        for (const SearchResults& search_item : search_items) {
+            test_flows.push_back(Span<uint8_t>(search_item.payload.data(), search_item.payload.size()));
+        }
+        large_corpus = generateCorpus(BENCH_LARGE_CORPUS_SIZE, SHUFFLE_SEED);
+        for (std::size_t offset = 0; offset < large_corpus.size(); offset += BENCH_FLOW_SIZE) {
+            corpus_flows.push_back(Span<uint8_t>(large_corpus.data() + offset, std::min<std::size_t>(BENCH_FLOW_SIZE, large_corpus.size() - offset)));
+        }
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_THREADS) {
+        std::cout << "Benchmark: parallel scan (" << scanThreadCount(0) << " hardware thread(s))" << std::endl;
+        BenchmarkLog threads_log;
+        if (!test_flows.empty()) {
+            benchThreads<4, 1>(threads_log, "end_to_end_test", exact_matches, test_flows, iterations);
+            benchThreads<8, 1>(threads_log, "end_to_end_test", exact_matches, test_flows, iterations);
+        }
+        benchThreads<4, 1>(threads_log, "synthetic", exact_matches, corpus_flows, std::max<std::size_t>(1, iterations / 1000));
+        benchThreads<8, 1>(threads_log, "synthetic", exact_matches, corpus_flows, std::max<std::size_t>(1, iterations / 1000));
+        threads_log.writeToFile(dest_path, "bench_threads.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_MULTI_LENGTH) {
+        std::cout << "Benchmark: single pass scan of L = 4 and L = 8" << std::endl;
+        BenchmarkLog multi_length_log;
+        if (!test_flows.empty()) {
+            benchMultiLength<1>(multi_length_log, "end_to_end_test", exact_matches, test_flows, iterations);
+            benchMultiLength<2>(multi_length_log, "end_to_end_test", exact_matches, test_flows, iterations);
+        }
+        benchMultiLength<1>(multi_length_log, "synthetic", exact_matches, corpus_flows, std::max<std::size_t>(1, iterations / 1000));
+        benchMultiLength<2>(multi_length_log, "synthetic", exact_matches, corpus_flows, std::max<std::size_t>(1, iterations / 1000));
+        multi_length_log.writeToFile(dest_path, "bench_multi.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_SNAPSHOT) {
+        std::cout << "Benchmark: table snapshots" << std::endl;
+        BenchmarkLog snapshot_log;
+        benchSnapshot<4, 1>(snapshot_log, dest_path, ruleset, corpus);
+        benchSnapshot<8, 1>(snapshot_log, dest_path, ruleset, corpus);
+        snapshot_log.writeToFile(dest_path, "bench_snapshot.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_PERFECT_HASH) {
+        std::cout << "Benchmark: minimal perfect hash index" << std::endl;
+        BenchmarkLog perfect_hash_log;
+        benchPerfectHash<4>(perfect_hash_log, exact_matches, corpus, iterations);
+        benchPerfectHash<8>(perfect_hash_log, exact_matches, corpus, iterations);
+        perfect_hash_log.writeToFile(dest_path, "bench_mphf.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_HUGE_PAGES) {
+        std::cout << "Benchmark: huge pages (transparent huge pages: " << transparentHugePagesMode() << ")" << std::endl;
+        BenchmarkLog huge_pages_log;
+        benchHugePages<4>(huge_pages_log, iterations);
+        benchHugePages<8>(huge_pages_log, iterations);
+        huge_pages_log.writeToFile(dest_path, "bench_hugepages.json");
+    }
+
+    if (mode == BENCH_MODE_ALL || mode == BENCH_MODE_LAYOUT) {
+        std::cout << "Benchmark: libcuckoo layouts (slots per bucket, hashpower)" << std::endl;
+        benchLayout<4, 1>(dest_path, exact_matches);
+        benchLayout<4, 2>(dest_path, exact_matches);
+        benchLayout<8, 1>(dest_path, exact_matches);
+        benchLayout<8, 2>(dest_path, exact_matches);
+    }
+
+    return 0;
+}
@@ -1,182 +1,600 @@
 #include "Auxiliary.h"
 
-#define SIMULATION_POINTER_VALUE 0  // use for simulation (see comment on architecture differences)
-
 typedef uint32_t sid_size_type_;    // the size of an SID (Signature ID)
-typedef std::set<int>* sid_list_ptr_type_;
-// For the sake of simplicity we use a "regular" pointer, of which the size is 8Bytes (on our x64-bits architecture)
-// However, the purpose of this structer is to be allocated on a designated x32-bits hardware, meaning each pointer will be 4Bytes.
+// The value of a table entry: a 32-bits reference to the entry's list of SIDs (its handle in the RulePool in runTests, its offset
+// in the SidArena in searchTest), the size of a pointer on the designated x32-bits hardware.
 typedef uint32_t theoretical_ptr_type_;
 typedef uint32_t substring_4bytes_type_;
 typedef uint64_t substring_8bytes_type_;
 
 /// <summary>
-/// Template function for running a generic test of inserting substrings with length = sizeof(K) to libcuckoo hash table.
+/// Merge the trials of a size sweep (num_of_tests trials per size of table_sizes, in this order) into an entry of stats per size,
+/// and print them.
 /// </summary>
-/// <typeparam name="K">Type of the key {uint8_t, uint16_t, uint32_t, uint64_t}</typeparam>
-/// <typeparam name="V">Type of the value {uint..., Empty, std::set<int>*}</typeparam>
-/// <typeparam name="H">Type of the hash function {CustomHash - recommended, std::hash<K> - not recommended, unexpected results}</typeparam>
-/// <typeparam name="L">Length of substring (L = sizeof(K))</typeparam>
-/// <typeparam name="G">Gap between 2 substrings when parsing an exact match for substrings</typeparam>
-template<typename K, typename V, typename H = CustomHash, std::size_t L = sizeof(K), std::size_t G = SUBSTRING_DEFAULT_GAP>
-void runTests(Statistics& stats, SubstringLogger& log, const ExactMatches& exact_matches, const std::size_t num_of_tests = NUMBER_OF_TESTS, bool isSimulation = true) {
-    std::size_t table_sizes[] = { 2, 4, 8, 16, 32, 64, 128, 256, 512 };
-    
-    std::vector<Substring<K>> substrings;
-    std::size_t num_of_unique_rules = parseExactMatches<K, G>(exact_matches, substrings, log);
-    std::size_t num_of_substrings_duplicates = getTotalNumOfDups(substrings);
-    
-    std::cout << "Starting Test: L = " << L << " , G = " << G << ", " << "increasing table size "       \
-        << "[" << std::dec << substrings.size() << " Substring(s), " << num_of_substrings_duplicates   \
-        << " Duplicates]" << std::endl << std::endl;
-    
-    // Useful when trying to quickly produce the substrings logs
-    if (num_of_tests <= 0) {
-        return;
-    }
-
-    libcuckoo::cuckoohash_map<K, V, H>* hashTable;
-    for (std::size_t table_size : table_sizes) {
+/// <param name="size_name">What the sizes of table_sizes are: "table size", "budget"</param>
+void addTrialStatistics(Statistics& stats, const std::vector<TrialResult>& trials, const std::size_t* table_sizes, std::size_t num_of_table_sizes,
+                        std::size_t num_of_tests, std::size_t num_of_unique_rules, std::size_t num_of_substrings, std::size_t slot_per_bucket,
+                        std::size_t L, std::size_t G, const std::string& size_name) {
+    for (std::size_t size_index = 0; size_index < num_of_table_sizes; ++size_index) {
+        std::size_t table_size = table_sizes[size_index];
         std::size_t sum_additional_size_bytes = 0;
-        std::size_t num_of_slots = (table_size * 1024) / sizeof(std::pair<K, V>);
+        std::size_t sum_measured_additional_size_bytes = 0;
         double sum_load_factors = 0;
         double sum_substrings_inserted = 0;
         double sum_unique_rules_covered = 0;
         double sum_runtime = 0;
+        double sum_table_bytes = 0;
+        std::size_t sum_measured_table_bytes = 0;
+        double sum_lookups = 0;
+        double sum_lookup_time = 0;
+        double sum_hash_power = 0;
+        LatencyHistogram insert_latency;
+        LatencyHistogram lookup_latency;
+        CuckooCounters cuckoo_counters;
 
         std::cout << "========================================== " << table_size << "[KB] ==========================================" << std::endl;
         for (std::size_t i = 0; i < num_of_tests; ++i) {
-            std::shuffle(substrings.begin(), substrings.end(), std::default_random_engine(std::random_device()()));
-            //std::shuffle(substrings.begin(), substrings.end(), std::default_random_engine(SHUFFLE_SEED ^ static_cast<unsigned int>(i)));
-            
-            // TIME STAMP BEGIN: initiate hash table
-            auto timestamp_a = std::chrono::high_resolution_clock::now();
-            
-            // Allocate a new cuckoo hash table for load factor consistancy
-            hashTable = new libcuckoo::cuckoohash_map<K, V, H>(num_of_slots);
-            hashTable->reserve(num_of_slots);
-            // TODO: add hashpower changing
-            //cuckoo_hash.maximum_hashpower(log2(MAX_TABLE_SIZE));
-            
-
-            // Inserting the substrings from the substrings vector to the hash table
-            int substrings_inserted = 0;
-            double max_lf = 0.0;
-            std::set<int> unique_rules_inserted;
-            std::vector<Substring<K>> substrings_in_table;
-
-            for (auto& iter : substrings) {
-                K key = iter.substring;
-                V value;
-
-                // In theory, we would want to have the value set as the pointer to the rules
-                // HOWEVER, since we work on x64-bit architecture PCs in contrast to the x32-bit architecture designated processor,
-                // we would simulate the space consumption for the theoretical pointer, and implement the search function in more simplistic way.
-                if (isSimulation) {
-                    value = SIMULATION_POINTER_VALUE;
-                }
-                // UNCOMMENT IF USING x32-bits hardware(!)
-                // else  {
-                //    value = iter.rules;
-                // }
-
-                // Check if hash capacity reached test threshold for hash table size
-                if (hashTable->capacity() * sizeof(std::pair<K, V>) >= table_size && hashTable->load_factor() >= MAX_LOAD_FACTOR) {
-                    break;
-                }
-
-                // Insert entry(key,value) to hash table
-                hashTable->insert(key, value);
-                substrings_in_table.push_back(iter);
-
-                unique_rules_inserted.insert(iter.rules->begin(), iter.rules->end());
-                if (hashTable->load_factor() > max_lf) {
-                    max_lf = hashTable->load_factor();
-                }
-            }
-            delete hashTable;
-            
-            // TIME STAMP END: delete hash table
-            auto timestamp_b = std::chrono::high_resolution_clock::now();
-            auto test_runtime = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp_b - timestamp_a).count();
-
-
-            substrings_inserted = substrings_in_table.size();
-            sum_load_factors += max_lf;     // TODO: check if to add occupancy or final load factor instead of max
+            const TrialResult& trial = trials[size_index * num_of_tests + i];
+            sum_load_factors += trial.max_load_factor;     // TODO: check if to add occupancy or final load factor instead of max
             //sum_occupancy += num_of_elements_inserted / num_of_table_slots;
-            sum_substrings_inserted += substrings_inserted;
-            sum_unique_rules_covered += unique_rules_inserted.size();
-            sum_runtime += test_runtime;
-
-            // calculate additional size of the data structure
-            std::size_t additional_size_bytes = 0;
-            for (Substring<K> substring : substrings_in_table) {
-                // each entry in the hashtable has a pointer to a list of SIDs that were triggered from the entry's key.
-                // in theory, this list's size is the count of SIDs times the size of each SID + the size of the 'next' pointer in the list.
-                additional_size_bytes += substring.rules->size() * (sizeof(sid_size_type_) + sizeof(theoretical_ptr_type_));
-            }
-            sum_additional_size_bytes += additional_size_bytes;
-            
-            std::cout << "Test " << i + 1 << "/" << num_of_tests << ". Runtime: " << test_runtime << "[ms]. " << "Covered: "  \
-                << double(unique_rules_inserted.size()) / double(num_of_unique_rules) * 100 << "% of rules." << std::endl;
+            sum_substrings_inserted += trial.substrings_inserted;
+            sum_unique_rules_covered += trial.unique_rules_covered;
+            sum_runtime += trial.runtime;
+            sum_additional_size_bytes += trial.additional_size_bytes;
+            sum_measured_additional_size_bytes += trial.measured_additional_size_bytes;
+            sum_table_bytes += trial.table_bytes;
+            sum_measured_table_bytes += trial.measured_table_bytes;
+            sum_lookups += trial.num_of_lookups;
+            sum_lookup_time += trial.lookup_time;
+            sum_hash_power += trial.hash_power;
+            insert_latency.merge(trial.insert_latency);
+            lookup_latency.merge(trial.lookup_latency);
+            cuckoo_counters.merge(trial.cuckoo_counters);
+
+            std::cout << "Test " << i + 1 << "/" << num_of_tests << ". Runtime: " << trial.runtime << "[ms]. " << "Covered: "  \
+                << double(trial.unique_rules_covered) / double(num_of_unique_rules) * 100 << "% of rules." << std::endl;
         }
         // Collect and Print Statistics    
         std::size_t hash_table_size = table_size;
         std::size_t additional_size = int((sum_additional_size_bytes / 1024) / num_of_tests);
+        std::size_t measured_additional_size = int((sum_measured_additional_size_bytes / 1024) / num_of_tests);
+        std::size_t measured_table_bytes = sum_measured_table_bytes / num_of_tests;
+        std::size_t measured_additional_bytes = sum_measured_additional_size_bytes / num_of_tests;
         double avg_load_factor = double(sum_load_factors) / num_of_tests;
         double avg_number_of_rules_inserted = double(sum_unique_rules_covered) / num_of_tests;
         double percentage_of_rules_inserted = (avg_number_of_rules_inserted / num_of_unique_rules) * 100;
         double avg_number_of_substrings_inserted = double(sum_substrings_inserted) / num_of_tests;
-        double percentage_of_all_substrings_inserted = (avg_number_of_substrings_inserted / substrings.size()) * 100;
-        double hash_power = 0;  // TODO: implement
+        double percentage_of_all_substrings_inserted = (avg_number_of_substrings_inserted / num_of_substrings) * 100;
+        double hash_power = sum_hash_power / num_of_tests;
         double average_run_time = double(sum_runtime) / num_of_tests;
+        double bytes_per_key = (sum_substrings_inserted > 0) ? sum_table_bytes / sum_substrings_inserted : 0;
+        double false_positive_rate = 0;     // full keys: a lookup never matches a key which was not inserted
+        double lookup_throughput = (sum_lookup_time > 0) ? sum_lookups / sum_lookup_time / 1e6 : 0;
 
         TestStatistics test_data = {
                 hash_table_size,
                 additional_size,
+                measured_additional_size,
                 avg_load_factor,
                 avg_number_of_rules_inserted,
                 percentage_of_rules_inserted,
                 avg_number_of_substrings_inserted,
                 percentage_of_all_substrings_inserted,
                 hash_power,
-                average_run_time
+                average_run_time,
+                bytes_per_key,
+                false_positive_rate,
+                lookup_throughput,
+                0,
+                slot_per_bucket,
+                insert_latency.summary(),
+                lookup_latency.summary(),
+                cuckoo_counters,
+                measured_table_bytes,
+                measured_additional_bytes
         };
         stats.addData(test_data);
         
-        std::cout << std::endl << std::dec << substrings.size() << " Substring(s) have been produced." << std::endl             \
+        std::cout << std::endl << std::dec << num_of_substrings << " Substring(s) have been produced." << std::endl             \
             << avg_number_of_substrings_inserted << " Substring(s) were inserted to the hash table on average." << std::endl    \
             << percentage_of_rules_inserted << "% Rules were covered on average." << std::endl                                  \
             << percentage_of_all_substrings_inserted << "% of all Substrings were inserted on average." << std::endl            \
             << "Average load factor was: " << avg_load_factor << std::endl                                                      \
-            << "Additional size of SID list was: " << additional_size << "[KB]." << std::endl                                   \
-            << "Data was calculated over " << num_of_tests << " run(s) of cuckoo hash insertions with L = " << sizeof(K)        \
+            << "Additional size of SID list was: " << additional_size << "[KB] (theoretical), "                                 \
+            << measured_additional_size << "[KB] (measured, SID arena)." << std::endl                                           \
+            << "Bytes allocated: " << measured_table_bytes << " (hash table, buckets and locks) + " << measured_additional_bytes \
+            << " (SID arena), of " << table_size * 1024 << " (" << size_name << ")." << std::endl        \
+            << "Data was calculated over " << num_of_tests << " run(s) of cuckoo hash insertions with L = " << L              \
             << " and G = " << G << "." << std::endl << "Average insertion time: " << average_run_time << "[ms]." << std::endl   \
+            << "Bytes per key: " << bytes_per_key << ", lookups: " << lookup_throughput << "[M lookups/s]." << std::endl       \
+            << "Insertion latency: p50 " << test_data.insert_latency.p50 << ", p99 " << test_data.insert_latency.p99         \
+            << ", p99.9 " << test_data.insert_latency.p999 << ", max " << test_data.insert_latency.max << "[ns]. "            \
+            << "Lookup latency: p50 " << test_data.lookup_latency.p50 << ", p99 " << test_data.lookup_latency.p99            \
+            << ", p99.9 " << test_data.lookup_latency.p999 << ", max " << test_data.lookup_latency.max << "[ns]." << std::endl \
+            << "Displacements per insertion: " << (cuckoo_counters.inserts ? double(cuckoo_counters.displacements) / cuckoo_counters.inserts : 0) \
+            << " (longest cuckoo path: " << cuckoo_counters.max_path_length << "), " << cuckoo_counters.failed_inserts         \
+            << " failed insertion(s), " << cuckoo_counters.resizes << " resize(s)." << std::endl                               \
             << std::endl;
     }
 }
 
-
 /// <summary>
-/// Template function for running a generic test of inserting substrings with length = sizeof(K) to libcuckoo hash table.
+/// Template function for running a generic test of inserting substrings with length = L to libcuckoo hash table.
+/// With byte_budget, every size of TABLE_SIZES is instead an exact budget (in Bytes) for the table and its lists of SIDs together,
+/// as allocated: the bytes libcuckoo allocates (buckets and locks, counted by the table's CountingAllocator) and the bytes
+/// allocated for the lists, packed in a SidArena which grows exactly (its residentBytes(), also the reported measured size).
+/// The table is the largest one (hashpower) whose allocation fits the budget, and the insertions stop at the first substring
+/// whose list would not fit in what is left of the budget (or once the table is full).
 /// </summary>
-/// <typeparam name="K">Type of the key {uint8_t, uint16_t, uint32_t, uint64_t}</typeparam>
-/// <typeparam name="V">Type of the value {uint..., Empty, std::set<int>*}</typeparam>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="V">Type of the value: the handle of the entry's list of SIDs in the RulePool (theoretical_ptr_type_)</typeparam>
 /// <typeparam name="H">Type of the hash function {CustomHash - recommended, std::hash<K> - not recommended, unexpected results}</typeparam>
-/// <typeparam name="L">Length of substring (L = sizeof(K))</typeparam>
+/// <typeparam name="L">Length of substring (L <= sizeof(K), the key is masked to L bytes)</typeparam>
 /// <typeparam name="G">Gap between 2 substrings when parsing an exact match for substrings</typeparam>
 template<typename K, typename V, typename H = CustomHash, std::size_t L = sizeof(K), std::size_t G = SUBSTRING_DEFAULT_GAP>
-void searchTest(std::string test_path, Results& results, SubstringLogger& log, const ExactMatches& exact_matches, bool isSimulation = true) {
+void runTests(Statistics& stats, SubstringLogger& log, const RulesetView& exact_matches, const std::size_t num_of_tests = NUMBER_OF_TESTS,
+              const bool byte_budget = false) {
+    std::size_t table_sizes[] = TABLE_SIZES;
+    
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;      // the (combined) rule lists of the substrings, shared by handle
+    std::size_t num_of_unique_rules = parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, log);
+    std::size_t num_of_substrings_duplicates = getTotalNumOfDups(substrings);
+    
+    std::cout << "Starting Test: L = " << L << " , G = " << G << ", " << (byte_budget ? "increasing byte budget " : "increasing table size ") \
+        << "[" << std::dec << substrings.size() << " Substring(s), " << num_of_substrings_duplicates   \
+        << " Duplicates]" << std::endl << std::endl;
+    
+    // Useful when trying to quickly produce the substrings logs
+    if (num_of_tests <= 0) {
+        return;
+    }
+
+    // Every trial (table size, test #) is independent: they run on a pool of TEST_THREADS threads, each thread shuffling its own
+    //  copy of the substrings with the trial's seed (SHUFFLE_SEED ^ test #), so the results do not depend on the thread count
+    //  nor on the order the trials run in. The statistics are merged afterwards, in trial order.
+    typedef libcuckoo::cuckoohash_map<K, V, H, std::equal_to<K>, CountingAllocator<std::pair<const K, V>>> counted_table_type;
+    const std::size_t num_of_table_sizes = sizeof(table_sizes) / sizeof(table_sizes[0]);
+    std::size_t num_of_threads = scanThreadCount(TEST_THREADS);
+    std::vector<std::vector<Substring<K>>> shuffled_substrings(num_of_threads);
+    std::vector<TrialResult> trials(num_of_table_sizes * num_of_tests);
+
+    // The hashpower of each budget: the largest one whose empty table the allocator measures within the budget
+    std::vector<std::size_t> budget_hash_powers(num_of_table_sizes, 0);
+    for (std::size_t size_index = 0; byte_budget && size_index < num_of_table_sizes; ++size_index) {
+        std::size_t budget_bytes = table_sizes[size_index] * 1024;
+        std::size_t hash_power = 0;
+        while ((std::size_t(2) << hash_power) * counted_table_type::slot_per_bucket() * sizeof(std::pair<K, V>) <= budget_bytes) {
+            ++hash_power;
+        }
+        for (; hash_power > 0; --hash_power) {
+            CuckooCounters counters;
+            counted_table_type table((std::size_t(1) << hash_power) * counted_table_type::slot_per_bucket(), H(), std::equal_to<K>(),
+                                     CountingAllocator<std::pair<const K, V>>(&counters));
+            if (counters.allocated_bytes <= budget_bytes) {
+                break;
+            }
+        }
+        budget_hash_powers[size_index] = hash_power;
+    }
+
+    parallelFor(trials.size(), num_of_threads, [&](std::size_t thread_index, std::size_t trial_index) {
+        std::size_t table_size = table_sizes[trial_index / num_of_tests];
+        std::size_t i = trial_index % num_of_tests;
+        std::size_t num_of_slots = byte_budget ? (std::size_t(1) << budget_hash_powers[trial_index / num_of_tests]) * counted_table_type::slot_per_bucket()
+                                               : (table_size * 1024) / sizeof(std::pair<K, V>);
+        std::vector<Substring<K>>& trial_substrings = shuffled_substrings[thread_index];
+        trial_substrings.assign(substrings.begin(), substrings.end());
+        deterministicShuffle(trial_substrings, SHUFFLE_SEED ^ static_cast<uint64_t>(i));
+        TrialResult& trial = trials[trial_index];
+
+        // TIME STAMP BEGIN: initiate hash table
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+
+        // Allocate a new cuckoo hash table for load factor consistancy (its allocator counts the elements it places, see CuckooCounters.h)
+        counted_table_type* hashTable = new counted_table_type(num_of_slots, H(), std::equal_to<K>(), CountingAllocator<std::pair<const K, V>>(&trial.cuckoo_counters));
+        hashTable->reserve(num_of_slots);
+        // The table may not grow past the hashpower of its size (an insertion which would double it ends the trial)
+        std::size_t hash_power = hashTable->hashpower();
+        hashTable->maximum_hashpower(hash_power);
+
+        // Inserting the substrings from the substrings vector to the hash table
+        double max_lf = 0.0;
+        std::set<int> unique_rules_inserted;
+        std::vector<Substring<K>> substrings_in_table;
+        SidArena sid_arena(byte_budget);    // the lists of SIDs of the inserted substrings (a list per RulePool handle)
+
+        for (auto& iter : trial_substrings) {
+            K key = iter.substring;
+            V value = iter.rules;       // the handle of the substring's list of SIDs
+
+            bool is_list_added = false;     // the substring's list was added to the arena for this substring
+            if (byte_budget) {
+                // Check if the table and the lists, with the substring's list, exceed the budget (as allocated)
+                std::size_t sid_words = sid_arena.sizeWords();
+                sid_arena.add(substrings_rules, value);
+                is_list_added = sid_arena.sizeWords() != sid_words;
+                if (trial.cuckoo_counters.allocated_bytes + sid_arena.residentBytes() > table_size * 1024) {
+                    if (is_list_added) {
+                        sid_arena.undoAdd(value);
+                    }
+                    break;
+                }
+            }
+            // Check if hash capacity reached test threshold for hash table size
+            else if (hashTable->capacity() * sizeof(std::pair<K, V>) >= table_size * 1024 && hashTable->load_factor() >= MAX_LOAD_FACTOR) {
+                break;
+            }
+
+            // Insert entry(key,value) to hash table
+            try {
+                countInsert(*hashTable, trial.cuckoo_counters, [&]() { return hashTable->insert(key, value); });
+            }
+            catch (const libcuckoo::maximum_hashpower_exceeded&) {
+                if (is_list_added) {
+                    sid_arena.undoAdd(value);
+                }
+                break;      // the table is full
+            }
+            substrings_in_table.push_back(iter);
+
+            Span<uint32_t> rules = substrings_rules.getRules(iter.rules);
+            unique_rules_inserted.insert(rules.begin(), rules.end());
+            if (hashTable->load_factor() > max_lf) {
+                max_lf = hashTable->load_factor();
+            }
+        }
+
+        // Look up every substring of the trial (the inserted ones hit, the others miss), timed apart from the insertions
+        std::size_t hits = 0;
+        auto timestamp_lookup_a = std::chrono::high_resolution_clock::now();
+        for (const Substring<K>& substring : trial_substrings) {
+            hits += hashTable->contains(substring.substring) ? 1 : 0;
+        }
+        auto timestamp_lookup_b = std::chrono::high_resolution_clock::now();
+        trial.num_of_hits = hits;
+        // The latency of a lookup: the substrings looked up again, one at a time, in a pass of their own (so neither the
+        //  throughput above nor the runtime include the clock reads)
+        for (const Substring<K>& substring : trial_substrings) {
+            LatencyClock::ticks_type lookup_begin = LatencyClock::now();
+            hashTable->contains(substring.substring);
+            trial.lookup_latency.recordTicks(lookup_begin, LatencyClock::now());
+        }
+        auto timestamp_latency_b = std::chrono::high_resolution_clock::now();
+        std::size_t table_bytes = hashTable->capacity() * sizeof(std::pair<K, V>);
+        trial.measured_table_bytes = trial.cuckoo_counters.allocated_bytes;
+        delete hashTable;
+
+        // TIME STAMP END: delete hash table
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+
+        trial.lookup_time = std::chrono::duration<double>(timestamp_lookup_b - timestamp_lookup_a).count();
+        trial.num_of_lookups = trial_substrings.size();
+        trial.table_bytes = table_bytes;
+        trial.hash_power = hash_power;
+        trial.runtime = std::chrono::duration<double, std::milli>((timestamp_b - timestamp_a) - (timestamp_latency_b - timestamp_lookup_a)).count();
+
+        // The latency of an insertion: the substrings of the trial inserted again, in the same order, one at a time into a table
+        //  of the same hashpower (libcuckoo places them the same way), in a pass of its own (so the runtime does not include it)
+        libcuckoo::cuckoohash_map<K, V, H> latency_table(num_of_slots);
+        latency_table.reserve(num_of_slots);
+        latency_table.maximum_hashpower(hash_power);
+        try {
+            for (const Substring<K>& substring : substrings_in_table) {
+                LatencyClock::ticks_type insert_begin = LatencyClock::now();
+                latency_table.insert(substring.substring, substring.rules);
+                trial.insert_latency.recordTicks(insert_begin, LatencyClock::now());
+            }
+        }
+        catch (const libcuckoo::maximum_hashpower_exceeded&) {
+            // not expected: the same insertions fit in the trial's table
+        }
+        trial.max_load_factor = max_lf;
+        trial.substrings_inserted = substrings_in_table.size();
+        trial.unique_rules_covered = unique_rules_inserted.size();
+
+        // calculate additional size of the data structure
+        trial.additional_size_bytes = 0;
+        for (const Substring<K>& substring : substrings_in_table) {
+            // each entry in the hashtable has a pointer to a list of SIDs that were triggered from the entry's key.
+            // in theory, this list's size is the count of SIDs times the size of each SID + the size of the 'next' pointer in the list.
+            trial.additional_size_bytes += substrings_rules.getRules(substring.rules).size() * (sizeof(sid_size_type_) + sizeof(theoretical_ptr_type_));
+        }
+        // and the size actually allocated when the lists are packed in a SidArena (32-bits offsets, a list per RulePool handle)
+        for (const Substring<K>& substring : substrings_in_table) {
+            sid_arena.add(substrings_rules, substring.rules);
+        }
+        sid_arena.shrinkToFit();
+        trial.measured_additional_size_bytes = sid_arena.residentBytes();
+    });
+
+    addTrialStatistics(stats, trials, table_sizes, num_of_table_sizes, num_of_tests, num_of_unique_rules, substrings.size(),
+                       counted_table_type::slot_per_bucket(), L, G, byte_budget ? "budget" : "table size");
+}
+
+/// <summary>
+/// Template function for the offline placement test: the trials of runTests (same table sizes, same shuffles), with the substrings
+/// placed in a PlacedCuckooTable of the hashpower libcuckoo gets for each size, instead of inserted into libcuckoo up to MAX_LOAD_FACTOR.
+/// Every substring is inserted in its shuffled order; a substring the table can not hold (no augmenting path) is skipped, and the
+/// insertions carry on. The entries are comparable with the runTests size sweep: the rules covered per KB of the same tables.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="V">Type of the value: the handle of the entry's list of SIDs in the RulePool (theoretical_ptr_type_)</typeparam>
+/// <typeparam name="H">Type of the hash function {CustomHash - recommended}</typeparam>
+/// <typeparam name="L">Length of substring (L <= sizeof(K), the key is masked to L bytes)</typeparam>
+/// <typeparam name="G">Gap between 2 substrings when parsing an exact match for substrings</typeparam>
+template<typename K, typename V, typename H = CustomHash, std::size_t L = sizeof(K), std::size_t G = SUBSTRING_DEFAULT_GAP>
+void runPlacementTests(Statistics& stats, const RulesetView& exact_matches, const std::size_t num_of_tests = NUMBER_OF_TESTS) {
+    std::size_t table_sizes[] = TABLE_SIZES;
+
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;
+    SubstringLogger substrings_log; // required by the parser, not written (see runTests)
+    std::size_t num_of_unique_rules = parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+
+    std::cout << "Starting Test: L = " << L << " , G = " << G << ", offline placement, increasing table size [" << std::dec
+        << substrings.size() << " Substring(s)]" << std::endl << std::endl;
+
+    if (num_of_tests <= 0) {
+        return;
+    }
+
+    // The trials run as in runTests (see there)
+    typedef PlacedCuckooTable<K, V, CUCKOO_PLACEMENT_SLOTS_PER_BUCKET, H> placed_table_type;
+    const std::size_t num_of_table_sizes = sizeof(table_sizes) / sizeof(table_sizes[0]);
+    std::size_t num_of_threads = scanThreadCount(TEST_THREADS);
+    std::vector<std::vector<Substring<K>>> shuffled_substrings(num_of_threads);
+    std::vector<TrialResult> trials(num_of_table_sizes * num_of_tests);
+
+    parallelFor(trials.size(), num_of_threads, [&](std::size_t thread_index, std::size_t trial_index) {
+        std::size_t table_size = table_sizes[trial_index / num_of_tests];
+        std::size_t i = trial_index % num_of_tests;
+        std::vector<Substring<K>>& trial_substrings = shuffled_substrings[thread_index];
+        trial_substrings.assign(substrings.begin(), substrings.end());
+        deterministicShuffle(trial_substrings, SHUFFLE_SEED ^ static_cast<uint64_t>(i));
+        TrialResult& trial = trials[trial_index];
+
+        // The hashpower libcuckoo reserves for the slots of the table size (the smallest one holding them)
+        std::size_t num_of_slots = (table_size * 1024) / sizeof(std::pair<K, V>);
+        std::size_t num_of_buckets = (num_of_slots + placed_table_type::slot_per_bucket() - 1) / placed_table_type::slot_per_bucket();
+        std::size_t hash_power = 0;
+        while ((std::size_t(1) << hash_power) < num_of_buckets) {
+            ++hash_power;
+        }
+
+        // TIME STAMP BEGIN: initiate hash table
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+        placed_table_type* hashTable = new placed_table_type(hash_power);
+
+        std::set<int> unique_rules_inserted;
+        std::vector<Substring<K>> substrings_in_table;
+        for (auto& iter : trial_substrings) {
+            bool is_inserted = hashTable->insert(iter.substring, iter.rules);
+            if (!is_inserted) {
+                ++trial.cuckoo_counters.failed_inserts;
+                continue;
+            }
+            ++trial.cuckoo_counters.inserts;
+            substrings_in_table.push_back(iter);
+            Span<uint32_t> rules = substrings_rules.getRules(iter.rules);
+            unique_rules_inserted.insert(rules.begin(), rules.end());
+        }
+
+        // Look up every substring of the trial, and measure the latencies of the lookups in a pass of their own, as in runTests
+        std::size_t hits = 0;
+        auto timestamp_lookup_a = std::chrono::high_resolution_clock::now();
+        for (const Substring<K>& substring : trial_substrings) {
+            hits += hashTable->contains(substring.substring) ? 1 : 0;
+        }
+        auto timestamp_lookup_b = std::chrono::high_resolution_clock::now();
+        trial.num_of_hits = hits;
+        for (const Substring<K>& substring : trial_substrings) {
+            LatencyClock::ticks_type lookup_begin = LatencyClock::now();
+            hashTable->contains(substring.substring);
+            trial.lookup_latency.recordTicks(lookup_begin, LatencyClock::now());
+        }
+        auto timestamp_latency_b = std::chrono::high_resolution_clock::now();
+        trial.max_load_factor = hashTable->load_factor();   // the table only grows, its final load factor is its max
+        trial.table_bytes = hashTable->capacity() * sizeof(std::pair<K, V>);
+        trial.measured_table_bytes = hashTable->memoryBytes();
+        delete hashTable;
+
+        // TIME STAMP END: delete hash table
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+
+        trial.lookup_time = std::chrono::duration<double>(timestamp_lookup_b - timestamp_lookup_a).count();
+        trial.num_of_lookups = trial_substrings.size();
+        trial.hash_power = hash_power;
+        trial.runtime = std::chrono::duration<double, std::milli>((timestamp_b - timestamp_a) - (timestamp_latency_b - timestamp_lookup_a)).count();
+        trial.substrings_inserted = substrings_in_table.size();
+
+        // The latency of an insertion: the substrings of the trial placed again, in the same order, one at a time in a table of
+        //  the same hashpower (the placement is deterministic), in a pass of its own as in runTests
+        placed_table_type latency_table(hash_power);
+        for (const Substring<K>& substring : trial_substrings) {
+            LatencyClock::ticks_type insert_begin = LatencyClock::now();
+            latency_table.insert(substring.substring, substring.rules);
+            trial.insert_latency.recordTicks(insert_begin, LatencyClock::now());
+        }
+        trial.unique_rules_covered = unique_rules_inserted.size();
+
+        // The additional size, theoretical and packed in a SidArena, as in runTests
+        SidArena sid_arena;
+        trial.additional_size_bytes = 0;
+        for (const Substring<K>& substring : substrings_in_table) {
+            trial.additional_size_bytes += substrings_rules.getRules(substring.rules).size() * (sizeof(sid_size_type_) + sizeof(theoretical_ptr_type_));
+            sid_arena.add(substrings_rules, substring.rules);
+        }
+        sid_arena.shrinkToFit();
+        trial.measured_additional_size_bytes = sid_arena.residentBytes();
+    });
+
+    addTrialStatistics(stats, trials, table_sizes, num_of_table_sizes, num_of_tests, num_of_unique_rules, substrings.size(),
+                       placed_table_type::slot_per_bucket(), L, G, "table size");
+}
+
+
+/// <summary>
+/// Template function for the fingerprint-only mode: all the substrings with length = L in a CuckooFilterTable, which stores
+/// fingerprints of FingerprintBits bits instead of the keys and verifies the candidates against the ruleset's pattern bytes.
+/// Logs a single entry, comparable with the entries of the runTests size sweep: the size of the fingerprints, the bytes per key,
+/// the false positive rate of the fingerprints (before their verification) and the lookup throughput.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="V">Type of the value: the handle of the entry's list of SIDs in the RulePool (theoretical_ptr_type_)</typeparam>
+/// <typeparam name="FingerprintBits">Bits of a fingerprint {8, 12, 16}</typeparam>
+/// <typeparam name="H">Type of the hash function {CustomHash - recommended}</typeparam>
+/// <typeparam name="L">Length of substring (L <= sizeof(K), the key is masked to L bytes)</typeparam>
+/// <typeparam name="G">Gap between 2 substrings when parsing an exact match for substrings</typeparam>
+template<typename K, typename V, std::size_t FingerprintBits, typename H = CustomHash, std::size_t L = sizeof(K), std::size_t G = SUBSTRING_DEFAULT_GAP>
+void runFilterTest(Statistics& stats, const RulesetView& exact_matches, const std::size_t num_of_tests = NUMBER_OF_TESTS) {
+    std::vector<Substring<K>> substrings;
+    RulePool substrings_rules;      // the (combined) rule lists of the substrings, shared by handle
+    SubstringLogger substrings_log; // required by the parser, not written (see runTests)
+    std::size_t num_of_unique_rules = parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, substrings_log);
+
+    std::cout << "Starting Fingerprint-Only Test: L = " << L << " , G = " << G << ", " << FingerprintBits << " bits fingerprints "  \
+        << "[" << std::dec << substrings.size() << " Substring(s)]" << std::endl << std::endl;
+
+    if (num_of_tests <= 0 || substrings.empty()) {
+        return;
+    }
+
+    std::vector<K> keys;
+    std::vector<V> values;
+    keys.reserve(substrings.size());
+    values.reserve(substrings.size());
+    for (const Substring<K>& substring : substrings) {
+        keys.push_back(substring.substring);
+        values.push_back(substring.rules);
+    }
+    std::vector<uint32_t> sources = findSubstringSources<K, L, G>(exact_matches, keys);
+
+    // The build is deterministic: it is repeated num_of_tests times only to average its run time
+    CuckooFilterTable<K, V, L, FingerprintBits, H> table;
+    double sum_runtime = 0;
+    for (std::size_t i = 0; i < num_of_tests; ++i) {
+        auto timestamp_a = std::chrono::high_resolution_clock::now();
+        table.build(keys, sources, values, exact_matches);
+        auto timestamp_b = std::chrono::high_resolution_clock::now();
+        sum_runtime += std::chrono::duration<double, std::milli>(timestamp_b - timestamp_a).count();
+    }
+
+    // Every substring is found, with its value
+    std::size_t num_of_mismatches = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        V value = 0;
+        num_of_mismatches += !table.find(keys[i], value) || value != values[i];
+    }
+
+    // Keys which are not substrings (random keys of L bytes): the fingerprints pass some of them, the verification none
+    std::unordered_set<K, CustomHash> key_set(keys.begin(), keys.end());
+    std::vector<K> missing_keys;
+    std::mt19937_64 generator(SHUFFLE_SEED);
+    while (missing_keys.size() < std::max<std::size_t>(keys.size(), 1 << 16)) {
+        K key = 0;
+        for (std::size_t byte = 0; byte < L; ++byte) {
+            key = static_cast<K>((key << 8) | static_cast<K>(generator() & 0xff));
+        }
+        if (key_set.count(key) == 0) {
+            missing_keys.push_back(key);
+        }
+    }
+    std::size_t num_of_false_positives = 0;
+    std::size_t num_of_verified_false_positives = 0;
+    for (const K& key : missing_keys) {
+        num_of_false_positives += table.mayContain(key);
+        num_of_verified_false_positives += table.contains(key);
+    }
+
+    // Lookup throughput: the substrings (hits) and the missing keys, as the lookups of runTests
+    std::size_t found = 0;
+    auto timestamp_lookup_a = std::chrono::high_resolution_clock::now();
+    for (const K& key : keys) {
+        found += table.contains(key);
+    }
+    for (const K& key : missing_keys) {
+        found += table.contains(key);
+    }
+    auto timestamp_lookup_b = std::chrono::high_resolution_clock::now();
+    double lookup_time = std::chrono::duration<double>(timestamp_lookup_b - timestamp_lookup_a).count();
+
+    // Collect and Print Statistics
+    std::size_t hash_table_size = table.filterBytes() / 1024;
+    std::size_t additional_size = table.verificationBytes() / 1024;
+    double bytes_per_key = double(table.filterBytes()) / table.size();
+    double false_positive_rate = double(num_of_false_positives) / missing_keys.size();
+    double lookup_throughput = (lookup_time > 0) ? (keys.size() + missing_keys.size()) / lookup_time / 1e6 : 0;
+    double average_run_time = sum_runtime / num_of_tests;
+
+    TestStatistics test_data = {
+            hash_table_size,
+            additional_size,
+            additional_size,
+            table.load_factor(),
+            double(num_of_unique_rules),
+            100,
+            double(keys.size()),
+            100,
+            0,
+            average_run_time,
+            bytes_per_key,
+            false_positive_rate,
+            lookup_throughput,
+            FingerprintBits,
+            CUCKOO_FILTER_SLOTS_PER_BUCKET,
+            LatencySummary(),
+            LatencySummary(),
+            CuckooCounters(),
+            table.filterBytes(),
+            table.verificationBytes()
+    };
+    stats.addData(test_data);
+
+    std::cout << keys.size() << " Substring(s) in " << table.filterBytes() << " Bytes of fingerprints (" << bytes_per_key      \
+        << " Bytes per key, load factor " << table.load_factor() << ") + " << table.verificationBytes()                     \
+        << " Bytes of sources and values for the verification stage." << std::endl                                          \
+        << "False positive rate: " << false_positive_rate * 100 << "% of " << missing_keys.size() << " missing key(s) "      \
+        << "before verification, " << num_of_verified_false_positives << " after. " << num_of_mismatches << " mismatch(es), " \
+        << found << " hit(s)." << std::endl                                                                                  \
+        << "Lookups: " << lookup_throughput << "[M lookups/s]. Average build time: " << average_run_time << "[ms]."          \
+        << std::endl << std::endl;
+}
+
+
+/// <summary>
+/// Template function for running a generic test of inserting substrings with length = L to libcuckoo hash table.
+/// </summary>
+/// <typeparam name="K">Type of the key {uint16_t, uint32_t, uint64_t, uint128_t}, see SubstringKey<L></typeparam>
+/// <typeparam name="V">Type of the value: the offset of the entry's list of SIDs in the SidArena (theoretical_ptr_type_)</typeparam>
+/// <typeparam name="H">Type of the hash function {PrehashedHash<CustomHash> - recommended (uses the batched hashes of the scan), CustomHash, ...}</typeparam>
+/// <typeparam name="L">Length of substring (L <= sizeof(K), the key is masked to L bytes)</typeparam>
+/// <typeparam name="G">Gap between 2 substrings when parsing an exact match for substrings</typeparam>
+/// <typeparam name="T">Type of the table the scan looks up: the libcuckoo table itself, or a FrozenCuckooTable<K, V, Tag, H> built from it</typeparam>
+/// <param name="use_prefilter">Look the windows up in a binary fuse filter of the table's keys first, and in the table only if they pass it</param>
+/// <param name="use_huge_pages">Allocate the libcuckoo table from huge pages, and move the frozen table (if T is one) and the lists of
+/// SIDs to them before the scan (see HugePages.h)</param>
+template<typename K, typename V, typename H = CustomHash, std::size_t L = sizeof(K), std::size_t G = SUBSTRING_DEFAULT_GAP,
+    typename T = libcuckoo::cuckoohash_map<K, V, H, std::equal_to<K>, HugePageAllocator<std::pair<const K, V>>>>
+void searchTest(std::string test_path, Results& results, SubstringLogger& log, const RulesetView& exact_matches,
+                bool use_prefilter = USE_PREFILTER, bool use_huge_pages = USE_HUGE_PAGES) {
     std::vector<SearchResults> search_results;
     std::vector<Substring<K>> substrings;
-    parseExactMatches<K, G>(exact_matches, substrings, log);
+    RulePool substrings_rules;      // the (combined) rule lists of the substrings, shared by handle
+    parseExactMatches<K, L, G>(exact_matches, substrings, substrings_rules, log);
 
     std::cout << "Starting Search Test: L = " << L << " , G = " << G << ", " << "[" << std::dec << substrings.size()    \
        << " Substring(s) were created]." << std::endl;
 
-    libcuckoo::cuckoohash_map<K, V, H>* hashTable;
+    typedef libcuckoo::cuckoohash_map<K, V, H, std::equal_to<K>, HugePageAllocator<std::pair<const K, V>>> table_type;
+    table_type* hashTable;
     std::size_t num_of_slots = substrings.size() * sizeof(std::pair<K, V>);
 
+    // The huge pages of the structures the scan reads: a table of a few hundred [KB] and its lists then take a single dTLB entry
+    //  instead of ~100. The libcuckoo table allocates its buckets and locks there (reserved up front, so it does not resize);
+    //  without huge pages its allocator has no arena, and is std::allocator.
+    HugePageArena huge_pages;
+
     // Shuffle substrings for random insertion
     std::shuffle(substrings.begin(), substrings.end(), std::default_random_engine(std::random_device()()));
 
@@ -184,129 +602,189 @@ void searchTest(std::string test_path, Results& results, SubstringLogger& log, c
     auto timestamp_a = std::chrono::high_resolution_clock::now();
 
     // Allocate a new cuckoo hash table for load factor consistancy
-    hashTable = new libcuckoo::cuckoohash_map<K, V, H>(num_of_slots);
+    hashTable = new table_type(num_of_slots, H(), std::equal_to<K>(),
+                               HugePageAllocator<std::pair<const K, V>>(use_huge_pages ? &huge_pages : nullptr));
     hashTable->reserve(num_of_slots);
    
     // Inserting the substrings from the substrings vector to the hash table
     int substrings_inserted = 0;
     std::set<int> unique_rules_inserted;
     std::vector<Substring<K>> substrings_in_table;
+    SidArena sid_arena;             // the lists of SIDs of the entries, the value of an entry is the offset of its list
     std::size_t raw_list_size = 0;
     std::size_t iblt_size_optimal = 0;
     std::size_t iblt_size_100_rate = 0;
     std::size_t iblt_size_99_rate = 0;
     std::size_t iblt_size_95_rate = 0;
+    LatencyHistogram insert_latency;
 
     // Insert all substrings to the hash table
     for (auto& iter : substrings) {
         K key = iter.substring;
-        V value;
-
-        // In theory, we would want to have the value set as the pointer to the rules
-        // HOWEVER, since we work on x64-bit architecture PCs in contrast to the x32-bit architecture designated processor,
-        // we would simulate the space consumption for the theoretical pointer, and implement the search function in more simplistic way.
-        if (isSimulation) {
-            value = SIMULATION_POINTER_VALUE;
-        }
-        // UNCOMMENT IF USING x32-bits hardware(!)
-            // else  {
-            //    value = iter.rules;
-            // }
+        V value = sid_arena.add(substrings_rules, iter.rules);     // the offset of the substring's list of SIDs
 
         // NO NEED WHEN INSERTING ALL SUBSTRINGS (!) (Check if hash capacity reached test threshold for hash table size)
             //if (hashTable->capacity() * sizeof(std::pair<K, V>) >= table_size && hashTable->load_factor() >= MAX_LOAD_FACTOR) {
             //    break;
             //}
 
+        LatencyClock::ticks_type insert_begin = LatencyClock::now();
         hashTable->insert(key, value);
+        insert_latency.recordTicks(insert_begin, LatencyClock::now());
         substrings_in_table.push_back(iter);
-        unique_rules_inserted.insert(iter.rules->begin(), iter.rules->end());
+        Span<uint32_t> rules = substrings_rules.getRules(iter.rules);
+        unique_rules_inserted.insert(rules.begin(), rules.end());
 
         // IBLT size calculation
-        raw_list_size += iter.rules->size() * SID_ENTRY_IN_LINKED_LIST;
-        iblt_size_optimal += 2 * iter.rules->size() * IBLT_CELL_SIZE;
+        raw_list_size += rules.size() * SID_ENTRY_IN_LINKED_LIST;
+        iblt_size_optimal += 2 * rules.size() * IBLT_CELL_SIZE;
         iblt_size_100_rate += ibltNumOfCells(L, G, 1) * IBLT_CELL_SIZE;
         iblt_size_99_rate += ibltNumOfCells(L, G, 0.99) * IBLT_CELL_SIZE;
         iblt_size_95_rate += ibltNumOfCells(L, G, 0.95) * IBLT_CELL_SIZE;
     }
 
+    sid_arena.shrinkToFit();
     substrings_inserted = substrings_in_table.size();
     std::cout << "Hash Table created! " << substrings_inserted << " Substring(s) were inserted." << std::endl;
 
     // Calculate the hash table's theoretical size (assuming a 32bits pointers are use to point at a Bloom Filter struct
     // IBLT size calculation: Total bits = 2 * M * (8 + 32 + 32) = 144 * M bits = 18M Bytes, where M is the number of rules.
     std::size_t hash_table_size = hashTable->capacity() * sizeof(std::pair<K, theoretical_ptr_type_>);
+
+    // The table the scan looks up (read-only from here on)
+    std::unique_ptr<T> frozen_table;
+    const T& lookup_table = lookupTableOf(*hashTable, frozen_table);
+
+    // The frozen table (if any) and the lists of SIDs, moved to the huge pages of the libcuckoo table
+    std::size_t sid_arena_bytes = sid_arena.residentBytes();
+    if (use_huge_pages) {
+        if (frozen_table) {
+            moveToHugePages(*frozen_table, huge_pages);
+        }
+        moveToHugePages(sid_arena, huge_pages);
+        std::cout << "Moved to huge pages (" << hugePageBackingName(huge_pages.backing()) << "): " << huge_pages.usedBytes()  \
+            << " Bytes, " << huge_pages.hugePageBytes() << " Bytes backed by huge pages." << std::endl;
+    }
+
+    // Optional prefilter: most windows miss the table, and a miss in the filter (3 loads) skips the two-bucket probe
+    BinaryFuseFilter<K> prefilter;
+    if (use_prefilter) {
+        std::vector<K> keys_in_table;
+        keys_in_table.reserve(substrings_in_table.size());
+        for (const Substring<K>& substring : substrings_in_table) {
+            keys_in_table.push_back(substring.substring);
+        }
+        prefilter.build(keys_in_table);
+        std::cout << "Prefilter built: " << prefilter.sizeBytes() << " Bytes (" << prefilter.bitsPerKey() << " bits/key)." << std::endl;
+    }
     
     // ###################################### Start Pattern Search Test ######################################
     // Parse the test JSON file to get a vector of {search_key, original_sids, **EMPTY** sid_hits_historam map}
     parseFile(test_path, search_results);
 
-    // For each item in the above vector, extract the relevant size Substrings from the search_item.search_key
-    //  then, seach in the hashtable each one of the substrings created from the search key and document findings in the histogram map.
-    int search_test_number = 0;
-    for (SearchResults search_item : search_results) {    
-        // Parse testString to extract substrings with relevant Lengths and Gaps respectively to the hash table:
-        // It is assumed for now that the testString is in the form of "0xFFFFFFFF..."
-        std::vector<Substring<K>> testSubstrings;
-        std::set<int> empty_ruleset;  // used since the testSubstrings has *NO* rules related to it (unlike the substring entries in the hash table).
-        Substring<K>::extractSubstrings(search_item.search_key, testSubstrings, empty_ruleset, G, L, true); // true - force lowercase on search key
-        for (Substring<K> testSubstring : testSubstrings) {
-            bool found = false;
-            K key_to_search = testSubstring.substring;
-            sid_list_ptr_type_ rules_ptr = nullptr;
-            if (isSimulation) {
-                found = hashTable->contains(key_to_search);
-            }
-            else {
-                // now the value_found is the ptr for the list of rules
-                found = true;
-                try {
-                    hashTable->find(key_to_search);
-                }
-                catch (std::out_of_range) {
-                    found = false;
-                }
-                //found = (rules_ptr != nullptr);
-            }
-        
-            // Deals with any hits to the given search pattern
-            // Since we only simulated the rules Bloom Filter in Part D,
-            //      we dont have in the real hash table the sid assosiated with every cuckoo hash table entry.
-            // Iterates over the orignial substrings vector to get this information for further analysis.
-            if (found) {
-                // std::cout << "Found substring: " << testSubstring << std::endl;
-                for (auto& substring : substrings) {
-                    if (substring == testSubstring) {
-                        rules_ptr = substring.rules;
-                        if (rules_ptr != nullptr) {
-                            for (auto rule : *rules_ptr) {
-                                // Document the sid hit in the historgram
-                                if (search_item.sids_hit.find(rule) == search_item.sids_hit.end()) {
-                                    search_item.sids_hit[rule] = 0;
-                                }
-                                search_item.sids_hit[rule]++;
-                            }
-                        }
-                        else {
-                            std::cout << "No rules found." << std::endl;
-                        }
-                    }
-                }
+    // Room for the windows of the largest payload, allocated once per thread (the scan itself does not allocate).
+    std::size_t max_windows = 0;
+    for (const SearchResults& search_item : search_results) {
+        max_windows = std::max(max_windows, search_item.payload.size());
+    }
+    std::size_t num_of_threads = scanThreadCount(SCAN_THREADS);
+    std::vector<ScanWorker<K, V>> workers(num_of_threads);
+    for (ScanWorker<K, V>& worker : workers) {
+        worker.reserve(max_windows);
+    }
+    std::vector<LatencyHistogram> payload_lookup_latency(num_of_threads);  // the lookups of the payload being scanned by each thread
+    std::vector<LatencyHistogram> lookup_latency(num_of_threads);          // ...and of all its payloads
+
+    // For each item in the above vector, generate the windows (L bytes, every G bytes) straight from the search_item.payload bytes
+    //  then, seach in the hashtable each one of the (unique) windows of the payload and document findings in the histogram map.
+    // The items (independent flows) are scanned in parallel: each worker thread has its own buffers and histogram,
+    //  and writes only to the items it scans.
+    auto parallel_scan_begin = std::chrono::high_resolution_clock::now();
+    parallelFor(search_results.size(), num_of_threads, [&](std::size_t thread_index, std::size_t item_index) {
+        ScanWorker<K, V>& worker = workers[thread_index];
+        SearchResults& search_item = search_results[item_index];
+        auto scan_begin = std::chrono::high_resolution_clock::now();
+        scanPayload<K, L, G>(lookup_table, use_prefilter ? &prefilter : nullptr, search_item.payload.data(), search_item.payload.size(), worker);
+
+        // Deals with any hits to the given search pattern: the value found is the offset of the hit's list of SIDs in the arena
+        for (V offset : worker.hit_values) {
+            for (auto rule : sid_arena.getSids(offset)) {
+                // Document the sid hit in the historgrams (of the item, and of the thread)
+                search_item.sids_hit[rule]++;
+                worker.sids_hit[rule]++;
             }
-        }   // FOR LOOP: SUBSTRINGS
+        }   // FOR LOOP: HITS
+        auto scan_end = std::chrono::high_resolution_clock::now();
+        worker.scan_time += std::chrono::duration<double>(scan_end - scan_begin).count();
+        search_item.scan_ns = std::chrono::duration<double, std::nano>(scan_end - scan_begin).count();
+    });
+    auto parallel_scan_end = std::chrono::high_resolution_clock::now();
+    double parallel_scan_time = std::chrono::duration<double>(parallel_scan_end - parallel_scan_begin).count();
+
+    // The latency of a lookup: the windows of each payload looked up again, one at a time, in a pass of their own (so neither
+    //  the scan times nor its wall clock include it). The windows are generated again by workers of their own (their counters
+    //  are not part of the totals).
+    std::vector<ScanWorker<K, V>> latency_workers(num_of_threads);
+    for (ScanWorker<K, V>& worker : latency_workers) {
+        worker.reserve(max_windows);
+    }
+    parallelFor(search_results.size(), num_of_threads, [&](std::size_t thread_index, std::size_t item_index) {
+        ScanWorker<K, V>& worker = latency_workers[thread_index];
+        SearchResults& search_item = search_results[item_index];
+        scanPayload<K, L, G>(lookup_table, use_prefilter ? &prefilter : nullptr, search_item.payload.data(), search_item.payload.size(), worker);
+
+        LatencyHistogram& payload_latency = payload_lookup_latency[thread_index];
+        payload_latency.clear();
+        for (std::size_t i = 0; i < worker.windows.size(); ++i) {
+            V value = 0;
+            uint8_t found = 0;
+            LatencyClock::ticks_type lookup_begin = LatencyClock::now();
+            findBatch(lookup_table, &worker.windows[i], &worker.window_hashes[i], 1, &value, &found);
+            payload_latency.recordTicks(lookup_begin, LatencyClock::now());
+        }
+        search_item.lookup_latency = payload_latency.summary();
+        lookup_latency[thread_index].merge(payload_latency);
+    });
+
+    int search_test_number = 0;
+    for (SearchResults& search_item : search_results) {
         std::cout << "Search Test Results for Test # " << (++search_test_number) << std::endl;
         for (auto& sid : search_item.original_sids){
             std::cout << "SID: " << sid << " was hit " << search_item.sids_hit[sid] << " time(s)." << std::endl;
         }
         search_item.size = hash_table_size;
         search_item.full_list_size = int(raw_list_size/8);
+        search_item.full_list_size_measured = sid_arena_bytes;
         search_item.iblt_size_optimal = int(iblt_size_optimal/8);
         search_item.iblt_size_100_rate = int(iblt_size_100_rate/8);
         search_item.iblt_size_99_rate = int(iblt_size_99_rate/8);
         search_item.iblt_size_95_rate = int(iblt_size_95_rate/8);
+        search_item.insert_latency = insert_latency.summary();
         results.addData(search_item);
     }   // FOR LOOP: SEARCH ITEM
 
+    // Totals of the threads
+    std::size_t scanned_bytes = 0;
+    std::size_t lookups = 0;
+    std::size_t unique_windows = 0;
+    std::size_t num_of_hits = 0;
+    double scan_time = 0;
+    for (const ScanWorker<K, V>& worker : workers) {
+        scanned_bytes += worker.scanned_bytes;
+        lookups += worker.lookups;
+        unique_windows += worker.unique_windows;
+        scan_time += worker.scan_time;
+    }
+    std::map<int, int> sids_hit = mergeHistograms(workers);
+    for (const auto& sid : sids_hit) {
+        num_of_hits += sid.second;
+    }
+    for (std::size_t thread_index = 1; thread_index < num_of_threads; ++thread_index) {
+        lookup_latency[0].merge(lookup_latency[thread_index]);
+    }
+    LatencySummary insert_summary = insert_latency.summary();
+    LatencySummary lookup_summary = lookup_latency[0].summary();
+
     // TIME STAMP END: delete hash table
     auto timestamp_b = std::chrono::high_resolution_clock::now();
     auto test_runtime = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp_b - timestamp_a).count();
@@ -314,15 +792,31 @@ void searchTest(std::string test_path, Results& results, SubstringLogger& log, c
 
     // calculate additional size of the data structure
     std::size_t additional_size_bytes = 0;
-    for (Substring<K> substring : substrings_in_table) {
+    for (const Substring<K>& substring : substrings_in_table) {
         // each entry in the hashtable has a pointer to a list of SIDs that were triggered from the entry's key.
         // in theory, this list's size is the count of SIDs times the size of each SID + the size of the 'next' pointer in the list.
-        additional_size_bytes += substring.rules->size() * (sizeof(sid_size_type_) + sizeof(theoretical_ptr_type_));
+        additional_size_bytes += substrings_rules.getRules(substring.rules).size() * (sizeof(sid_size_type_) + sizeof(theoretical_ptr_type_));
     }
     
+    std::cout << "Scanned " << scanned_bytes << " Bytes in " << scan_time * 1000 << "[ms] ("       \
+        << scanned_bytes / scan_time / 1e9 << " GB/s), " << lookups << " lookups (" << lookups / scan_time / 1e6    \
+        << " M lookups/s)." << std::endl;
+    std::cout << "Parallel scan: " << num_of_threads << " thread(s), " << parallel_scan_time * 1000 << "[ms] (wall clock), "   \
+        << sids_hit.size() << " SID(s) hit " << num_of_hits << " time(s) in total." << std::endl;
+    std::cout << "Insertion latency: p50 " << insert_summary.p50 << ", p99 " << insert_summary.p99 << ", p99.9 "        \
+        << insert_summary.p999 << ", max " << insert_summary.max << "[ns]. Lookup latency: p50 " << lookup_summary.p50    \
+        << ", p99 " << lookup_summary.p99 << ", p99.9 " << lookup_summary.p999 << ", max " << lookup_summary.max          \
+        << "[ns]." << std::endl;
+    if (use_prefilter) {
+        std::cout << "Prefilter: " << lookups << " of " << unique_windows << " window(s) passed." << std::endl;
+    }
     std::cout << "Finished search test. Time elapsed: " << test_runtime << "[ms]." << std::endl     \
         << "Table size: " << int(hashTable->capacity() * sizeof(std::pair<K, V>) / 1024) << "[KB]. "     \
-        << "Additional size: " << int(additional_size_bytes / 1024) << "[KB]." << std::endl << std::endl;
+        << "Additional size: " << int(additional_size_bytes / 1024) << "[KB] (theoretical), "     \
+        << int(sid_arena_bytes / 1024) << "[KB] (measured, SID arena)." << std::endl << std::endl;
+
+    // The table's buckets may be in huge_pages: delete it before the arena is released
+    delete hashTable;
 }
 
 /// <summary>
@@ -346,14 +840,16 @@ int main(int argc, char* argv[]) {
     std::string file_path = "parta_data_by_exactmatch.json";
     std::string dest_path = "";
     std::string test_path = "";
+    std::string ruleset_path = "";
     std::size_t num_of_tests = NUMBER_OF_TESTS;
     
     // Get arguments from VS/WSL
-    getOpts(argc, argv, file_path, dest_path, &num_of_tests, test_path);
+    getOpts(argc, argv, file_path, dest_path, &num_of_tests, test_path, ruleset_path);
     
-    // Parse PartA.json file to fill the ExactMatches vector with the extracted data from the .rules file
-    ExactMatches exact_matches;
-    parseFile(file_path, exact_matches); 
+    // Map the compiled ruleset (compiled once from the PartA.json file) to get the ExactMatches extracted from the .rules file
+    RulesetFile ruleset;
+    loadRuleset(file_path, ruleset_path, ruleset);
+    const RulesetView& exact_matches = ruleset.view();
 
     // START TESTS:
     // Test 1: Search test - L8 G1
@@ -363,7 +859,7 @@ int main(int argc, char* argv[]) {
     createDir(search_test_dest);
     Results results_log_L8_G1;
     SubstringLogger substrings_log_L8_G1;
-    searchTest<uint32_t, theoretical_ptr_type_, CustomHash, 8, 1>(test_path, results_log_L8_G1, substrings_log_L8_G1, exact_matches);
+    searchTest<SubstringKey<8>::type, theoretical_ptr_type_, PrehashedHash<CustomHash>, 8, 1>(test_path, results_log_L8_G1, substrings_log_L8_G1, exact_matches);
     std::cout << "search_test_dest: " << search_test_dest << std::endl; // "search_results.json" and "inserted_substrings.json
     results_log_L8_G1.writeToFile(search_test_dest, "search_results.json");
     substrings_log_L8_G1.writeToFile(search_test_dest, "inserted_substrings.json");
@@ -375,7 +871,7 @@ int main(int argc, char* argv[]) {
     createDir(search_test_dest);
     Results results_log_L8_G2;
     SubstringLogger substrings_log_L8_G2;
-    searchTest<uint32_t, theoretical_ptr_type_, CustomHash, 8, 2>(test_path, results_log_L8_G2, substrings_log_L8_G2, exact_matches);
+    searchTest<SubstringKey<8>::type, theoretical_ptr_type_, PrehashedHash<CustomHash>, 8, 2>(test_path, results_log_L8_G2, substrings_log_L8_G2, exact_matches);
     results_log_L8_G2.writeToFile(search_test_dest, "search_results.json");
     substrings_log_L8_G2.writeToFile(search_test_dest, "inserted_substrings.json");
 
@@ -386,7 +882,7 @@ int main(int argc, char* argv[]) {
     createDir(search_test_dest);
     Results results_log_L4_G1;
     SubstringLogger substrings_log_L4_G1;
-    searchTest<uint32_t, theoretical_ptr_type_, CustomHash, 4, 1>(test_path, results_log_L4_G1, substrings_log_L4_G1, exact_matches);
+    searchTest<SubstringKey<4>::type, theoretical_ptr_type_, PrehashedHash<CustomHash>, 4, 1>(test_path, results_log_L4_G1, substrings_log_L4_G1, exact_matches);
     results_log_L4_G1.writeToFile(search_test_dest, "search_results.json");
     substrings_log_L4_G1.writeToFile(search_test_dest, "inserted_substrings.json");
 
@@ -397,7 +893,7 @@ int main(int argc, char* argv[]) {
     createDir(search_test_dest);
     Results results_log_L4_G2;
     SubstringLogger substrings_log_L4_G2;
-    searchTest<uint32_t, theoretical_ptr_type_, CustomHash, 4, 2>(test_path, results_log_L4_G2, substrings_log_L4_G2, exact_matches);
+    searchTest<SubstringKey<4>::type, theoretical_ptr_type_, PrehashedHash<CustomHash>, 4, 2>(test_path, results_log_L4_G2, substrings_log_L4_G2, exact_matches);
     results_log_L4_G2.writeToFile(search_test_dest, "search_results.json");
     substrings_log_L4_G2.writeToFile(search_test_dest, "inserted_substrings.json");
 
@@ -441,6 +937,69 @@ int main(int argc, char* argv[]) {
     stats_test4.writeToFile(l4g2_path, "L4_G2_increasing_table_size.json");
     substrings_log4.writeToFile(l4g2_path, "L4_G2_substrings.json");
 
+    // Test 9: Fingerprint-only (cuckoo filter) tables with 8, 12 and 16 bits fingerprints, compared with Tests 5-8
+    Statistics filter_stats_l8g1;
+    runFilterTest<uint64_t, theoretical_ptr_type_, 8, CustomHash, 8, 1>(filter_stats_l8g1, exact_matches, num_of_tests);
+    runFilterTest<uint64_t, theoretical_ptr_type_, 12, CustomHash, 8, 1>(filter_stats_l8g1, exact_matches, num_of_tests);
+    runFilterTest<uint64_t, theoretical_ptr_type_, 16, CustomHash, 8, 1>(filter_stats_l8g1, exact_matches, num_of_tests);
+    filter_stats_l8g1.writeToFile(l8g1_path, "L8_G1_cuckoo_filter.json");
+
+    Statistics filter_stats_l8g2;
+    runFilterTest<uint64_t, theoretical_ptr_type_, 8, CustomHash, 8, 2>(filter_stats_l8g2, exact_matches, num_of_tests);
+    runFilterTest<uint64_t, theoretical_ptr_type_, 12, CustomHash, 8, 2>(filter_stats_l8g2, exact_matches, num_of_tests);
+    runFilterTest<uint64_t, theoretical_ptr_type_, 16, CustomHash, 8, 2>(filter_stats_l8g2, exact_matches, num_of_tests);
+    filter_stats_l8g2.writeToFile(l8g2_path, "L8_G2_cuckoo_filter.json");
+
+    Statistics filter_stats_l4g1;
+    runFilterTest<uint32_t, theoretical_ptr_type_, 8, CustomHash, 4, 1>(filter_stats_l4g1, exact_matches, num_of_tests);
+    runFilterTest<uint32_t, theoretical_ptr_type_, 12, CustomHash, 4, 1>(filter_stats_l4g1, exact_matches, num_of_tests);
+    runFilterTest<uint32_t, theoretical_ptr_type_, 16, CustomHash, 4, 1>(filter_stats_l4g1, exact_matches, num_of_tests);
+    filter_stats_l4g1.writeToFile(l4g1_path, "L4_G1_cuckoo_filter.json");
+
+    Statistics filter_stats_l4g2;
+    runFilterTest<uint32_t, theoretical_ptr_type_, 8, CustomHash, 4, 2>(filter_stats_l4g2, exact_matches, num_of_tests);
+    runFilterTest<uint32_t, theoretical_ptr_type_, 12, CustomHash, 4, 2>(filter_stats_l4g2, exact_matches, num_of_tests);
+    runFilterTest<uint32_t, theoretical_ptr_type_, 16, CustomHash, 4, 2>(filter_stats_l4g2, exact_matches, num_of_tests);
+    filter_stats_l4g2.writeToFile(l4g2_path, "L4_G2_cuckoo_filter.json");
+
+    // Test 10: Insert tests within an exact byte budget (table and lists of SIDs, as allocated), compared with Tests 5-8
+    Statistics budget_stats_l8g1;
+    SubstringLogger budget_log_l8g1;   // required by the parser, not written (the substrings are those of Tests 5-8)
+    runTests<uint64_t, theoretical_ptr_type_, CustomHash, 8, 1>(budget_stats_l8g1, budget_log_l8g1, exact_matches, num_of_tests, true);
+    budget_stats_l8g1.writeToFile(l8g1_path, "L8_G1_byte_budget.json");
+
+    Statistics budget_stats_l8g2;
+    SubstringLogger budget_log_l8g2;
+    runTests<uint64_t, theoretical_ptr_type_, CustomHash, 8, 2>(budget_stats_l8g2, budget_log_l8g2, exact_matches, num_of_tests, true);
+    budget_stats_l8g2.writeToFile(l8g2_path, "L8_G2_byte_budget.json");
+
+    Statistics budget_stats_l4g1;
+    SubstringLogger budget_log_l4g1;
+    runTests<uint32_t, theoretical_ptr_type_, CustomHash, 4, 1>(budget_stats_l4g1, budget_log_l4g1, exact_matches, num_of_tests, true);
+    budget_stats_l4g1.writeToFile(l4g1_path, "L4_G1_byte_budget.json");
+
+    Statistics budget_stats_l4g2;
+    SubstringLogger budget_log_l4g2;
+    runTests<uint32_t, theoretical_ptr_type_, CustomHash, 4, 2>(budget_stats_l4g2, budget_log_l4g2, exact_matches, num_of_tests, true);
+    budget_stats_l4g2.writeToFile(l4g2_path, "L4_G2_byte_budget.json");
+
+    // Test 11: Offline placement of the substrings in the tables of Tests 5-8 (rules covered per KB, compared with libcuckoo)
+    Statistics placement_stats_l8g1;
+    runPlacementTests<uint64_t, theoretical_ptr_type_, CustomHash, 8, 1>(placement_stats_l8g1, exact_matches, num_of_tests);
+    placement_stats_l8g1.writeToFile(l8g1_path, "L8_G1_offline_placement.json");
+
+    Statistics placement_stats_l8g2;
+    runPlacementTests<uint64_t, theoretical_ptr_type_, CustomHash, 8, 2>(placement_stats_l8g2, exact_matches, num_of_tests);
+    placement_stats_l8g2.writeToFile(l8g2_path, "L8_G2_offline_placement.json");
+
+    Statistics placement_stats_l4g1;
+    runPlacementTests<uint32_t, theoretical_ptr_type_, CustomHash, 4, 1>(placement_stats_l4g1, exact_matches, num_of_tests);
+    placement_stats_l4g1.writeToFile(l4g1_path, "L4_G1_offline_placement.json");
+
+    Statistics placement_stats_l4g2;
+    runPlacementTests<uint32_t, theoretical_ptr_type_, CustomHash, 4, 2>(placement_stats_l4g2, exact_matches, num_of_tests);
+    placement_stats_l4g2.writeToFile(l4g2_path, "L4_G2_offline_placement.json");
+
     // Register finish time and calculate total execution time
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -3,8 +3,10 @@
 
 #include "aho_corasick.hpp"
 #include "Parser.h"
+#include "Ruleset.h"
 #include "Statistics.h"
 #include "ExactMatches.h"
+#include "HugePages.h"
 #include <nlohmann/json.hpp>
 #include <iostream>
 #include <string>
@@ -36,7 +38,7 @@ void createDir(std::string path) {
 }
 
 // Gets the arguments for the main functions for either Visual Studio environment or WSL environment
-void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_path, std::string& test_path) {
+void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_path, std::string& test_path, std::string& ruleset_path) {
     bool is_file_path_set = false;
     bool is_test_path_set = false;
 #if defined _MSC_VER    // Visual Studio
@@ -52,10 +54,13 @@ void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_p
         test_path = argv[3];
         is_test_path_set = true;
     }
+    if (argc > 4) {
+        ruleset_path = argv[4];
+    }
 #elif defined __GNUC__  // WSL (GNU/Linux)
     // Running from WSL: get params from "run_project_unix.sh" script
     int opt = 0;
-    while ((opt = getopt(argc, argv, "f:d:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "f:d:t:b:")) != -1) {
         switch (opt) {
         case 'f':
             file_path = optarg;
@@ -68,16 +73,22 @@ void getOpts(int argc, char* argv[], std::string& file_path, std::string& dest_p
             test_path = optarg;
             is_test_path_set = true;
             break;
+        case 'b':
+            ruleset_path = optarg;
+            break;
         default:
-            std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-t test_file_path]" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-t test_file_path] [-b ruleset_path]" << std::endl;
             exit(EXIT_FAILURE);
         }
     }
 #endif  
     if (!is_file_path_set || !is_test_path_set) {
-        std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-t test_file_path]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [-f file_path] [-d dest_path] [-t test_file_path] [-b ruleset_path]" << std::endl;
         exit(EXIT_FAILURE);
 }
+    if (ruleset_path.empty()) {
+        ruleset_path = defaultRulesetPath(file_path);
+    }
     std::cout << "File path: " << file_path << std::endl;
 }
 // END OF ENVIRONMENT DEFINITIONS
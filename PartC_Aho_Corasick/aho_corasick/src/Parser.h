@@ -4,6 +4,7 @@
 #include "ExactMatches.h"
 #include "Statistics.h"
 #include "bstring.h"
+#include "Ruleset.h"
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
@@ -24,16 +25,14 @@ std::size_t addBstring(const std::string& hexString, std::vector<bstring>& bstri
 /// <summary>
 /// Convert the ExactMatches to std::basic_string<char>.
 /// </summary>
-/// <param name="exact_matches">Element of class ExactMatches, which is a vector of ExactMatch (rules,type,string) for each exact match extracted from the snort rules' signatures</param>
+/// <param name="exact_matches">A view of the compiled ruleset, holding the (rules, decoded bytes) of each exact match extracted from the snort rules' signatures</param>
 /// <param name="bstrings">An empty vector in which the basic_strings will be stored</param>
-std::size_t toBstring(const ExactMatches& exact_matches, std::vector<bstring>& bstrings) {
+std::size_t toBstring(const RulesetView& exact_matches, std::vector<bstring>& bstrings) {
     std::size_t max_length = 0;
-    for (auto it = exact_matches.exact_matches->begin(); it != exact_matches.exact_matches->end(); ++it) {
-        std::string hexString = (*it)->getExactMatch();
-        //std::set<int> rules = (*it)->getRulesNumbers();
-        //total_unique_rules.insert(rules.begin(), rules.end());
-        //bstrings.push_back(addBstring(hexString));
-        std::size_t length = addBstring(hexString, bstrings);
+    bstrings.reserve(exact_matches.size());
+    for (std::size_t i = 0; i < exact_matches.size(); ++i) {
+        bstrings.push_back(exact_matches.getBstring(i));
+        std::size_t length = bstrings.back().length();
         if (length > max_length) {
             max_length = length;
         }
@@ -59,39 +58,28 @@ void toBstring(const std::vector<SearchResults>* search_results, std::vector<bst
 }
 
 /**
- * Parse a line in 'exact_matches_hex.json' to extract items of class ExactMatch.
+ * Parse a line in 'exact_matches_hex.json' to extract an exact match (decoded bytes and rules).
  *
  * @param line string representing a line in the parsed .json file
  * @param exact_matches reference to a member of class ExactMaches,
  * that the results of the parsing will be inserted to
  */
-void parseLine(std::string line, ExactMatches& exact_matches) {
+void parseLine(const std::string& line, ExactMatches& exact_matches) {
     nlohmann::json jsonObj = nlohmann::json::parse(line);
 
-    // Accessing elements in the JSON object
-    std::vector<std::string> exact_match_hex = jsonObj["exact_match_hex"];
-    std::vector<int> non_unique_rules = jsonObj["rules"];
-    std::set<int> rules(non_unique_rules.begin(), non_unique_rules.end());
-
-    std::string match = "0x";
-
-    int j = 0;
-    for (const auto& hex : exact_match_hex) {
-        std::string value_to_concat = "";
-        if ((hex.substr(0, 2) == "0x")) {
-            value_to_concat = hex.substr(2);
-        }
-        match = match + value_to_concat;
-        ++j;
+    // Each byte is given as "0x.." with 1 or 2 hex digits
+    std::vector<uint8_t> exact_match;
+    for (const auto& hex : jsonObj["exact_match_hex"]) {
+        exact_match.push_back(static_cast<uint8_t>(std::stoul(hex.get<std::string>(), nullptr, 16)));
     }
-    //insert exact_match to ExactMatches.
-    exact_matches.insert(ExactMatch(rules, match));
+    std::vector<uint32_t> rules = jsonObj["rules"].get<std::vector<uint32_t>>();
+    exact_matches.insert(exact_match.data(), exact_match.size(), rules);
 }
 
  /**
-  * Parse a line in 'parta_data.json' to extract items of class ExactMatch.
+  * Parse 'parta_data.json' to extract the exact matches.
   *
-  * @param line string representing a line in the parsed .json file
+  * @param file_path string representing a .json file to be parsed
   * @param exact_matches reference to a member of class ExactMaches,
   * that the results of the parsing will be inserted to
   */
@@ -115,6 +103,48 @@ void parseFile(std::string file_path, ExactMatches& exact_matches) {
     }
 }
 
+/// <summary>
+/// The compiler step: parse the .json file generated by Part A a single time, and write its exact matches as a compiled ruleset file.
+/// </summary>
+/// <param name="json_path">Path to the .json file generated by Part A</param>
+/// <param name="bin_path">Path to the compiled ruleset file to create</param>
+void compileRuleset(const std::string& json_path, const std::string& bin_path) {
+    ExactMatches exact_matches;
+    parseFile(json_path, exact_matches);
+    if (exact_matches.size() == 0) {
+        throw std::runtime_error("No exact matches were parsed from " + json_path + ".");
+    }
+    writeRuleset(exact_matches, bin_path);
+}
+
+/// <summary>
+/// Load the ruleset: map the compiled ruleset file, (re)compiling it first from the .json file
+/// if it is missing, invalid or older than the .json file.
+/// </summary>
+/// <param name="json_path">Path to the .json file generated by Part A</param>
+/// <param name="bin_path">Path to the compiled ruleset file</param>
+/// <param name="ruleset">The RulesetFile to map the compiled ruleset into</param>
+void loadRuleset(const std::string& json_path, const std::string& bin_path, RulesetFile& ruleset) {
+    try {
+        std::error_code error;
+        bool is_stale = std::filesystem::exists(json_path, error) && (!std::filesystem::exists(bin_path, error)
+            || std::filesystem::last_write_time(bin_path, error) < std::filesystem::last_write_time(json_path, error));
+        if (is_stale || !ruleset.open(bin_path)) {
+            std::cout << "Compiling " << json_path << " into " << bin_path << std::endl;
+            compileRuleset(json_path, bin_path);
+            if (!ruleset.open(bin_path)) {
+                throw std::runtime_error("Invalid compiled ruleset file " + bin_path + ".");
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "Loaded " << ruleset.view().size() << " exact match(es) from " << bin_path << std::endl;
+}
+
+
 
 /// <summary>
 /// Parse a JSON test file containing hexStrings of signatures patterns to search.
@@ -0,0 +1,312 @@
+#ifndef _RULESET_H
+#define _RULESET_H
+
+#include "ExactMatches.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+
+#if defined __GNUC__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+/*
+Compiled ruleset file format (all integers are stored in the host's byte order):
+	[RulesetHeader]
+	[pattern_offsets]	uint32_t * (num_patterns + 1)	- offset of each pattern in pattern_bytes
+	[pattern_rules]		uint32_t * num_patterns			- index of each pattern's rule list
+	[rule_offsets]		uint32_t * (num_rule_lists + 1)	- offset of each rule list in rule_ids
+	[rule_ids]			uint32_t * num_rule_ids			- the (sorted) rule lists, back to back
+	[pattern_bytes]		uint8_t * num_pattern_bytes		- the decoded exact matches, back to back
+Every section starts on an 8 bytes boundary, so the file can be mapped and used in place.
+*/
+#define RULESET_MAGIC "SNTRULES"
+#define RULESET_VERSION 1
+#define RULESET_SECTION_ALIGNMENT 8
+#define RULESET_FILE_EXTENSION ".bin"
+
+struct RulesetHeader {
+	char magic[8];					// RULESET_MAGIC (without the terminating null)
+	uint32_t version;				// RULESET_VERSION
+	uint32_t num_patterns;			// number of exact matches
+	uint32_t num_rule_lists;		// number of rule lists (patterns may share a rule list)
+	uint32_t num_rule_ids;			// total number of SIDs in all the rule lists
+	uint64_t num_pattern_bytes;		// total number of bytes in all the exact matches
+	uint64_t checksum;				// FNV-1a of everything following the header
+	uint64_t pattern_offsets_pos;	// file offsets of each of the sections
+	uint64_t pattern_rules_pos;
+	uint64_t rule_offsets_pos;
+	uint64_t rule_ids_pos;
+	uint64_t pattern_bytes_pos;
+	uint64_t file_size;
+};
+
+
+std::size_t alignRulesetSection(std::size_t pos) {
+	return (pos + RULESET_SECTION_ALIGNMENT - 1) & ~static_cast<std::size_t>(RULESET_SECTION_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// Lay out the given ruleset arrays as a compiled ruleset image (see the file format above).
+/// </summary>
+/// <param name="ruleset">View of the ruleset arrays to serialize</param>
+/// <param name="num_rule_lists">Number of rule lists referenced by ruleset.pattern_rules</param>
+/// <returns>The ruleset image, ready to be written to a file</returns>
+std::vector<uint8_t> buildRulesetImage(const RulesetView& ruleset, std::size_t num_rule_lists) {
+	std::size_t num_patterns = ruleset.size();
+	std::size_t num_pattern_bytes = ruleset.pattern_offsets[num_patterns];
+	std::size_t num_rule_ids = ruleset.rule_offsets[num_rule_lists];
+
+	RulesetHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, RULESET_MAGIC, sizeof(header.magic));
+	header.version = RULESET_VERSION;
+	header.num_patterns = static_cast<uint32_t>(num_patterns);
+	header.num_rule_lists = static_cast<uint32_t>(num_rule_lists);
+	header.num_rule_ids = static_cast<uint32_t>(num_rule_ids);
+	header.num_pattern_bytes = num_pattern_bytes;
+	header.pattern_offsets_pos = alignRulesetSection(sizeof(RulesetHeader));
+	header.pattern_rules_pos = alignRulesetSection(header.pattern_offsets_pos + (num_patterns + 1) * sizeof(uint32_t));
+	header.rule_offsets_pos = alignRulesetSection(header.pattern_rules_pos + num_patterns * sizeof(uint32_t));
+	header.rule_ids_pos = alignRulesetSection(header.rule_offsets_pos + (num_rule_lists + 1) * sizeof(uint32_t));
+	header.pattern_bytes_pos = alignRulesetSection(header.rule_ids_pos + num_rule_ids * sizeof(uint32_t));
+	header.file_size = alignRulesetSection(header.pattern_bytes_pos + num_pattern_bytes);
+
+	std::vector<uint8_t> image(header.file_size, 0);
+	std::memcpy(image.data() + header.pattern_offsets_pos, ruleset.pattern_offsets, (num_patterns + 1) * sizeof(uint32_t));
+	std::memcpy(image.data() + header.pattern_rules_pos, ruleset.pattern_rules, num_patterns * sizeof(uint32_t));
+	std::memcpy(image.data() + header.rule_offsets_pos, ruleset.rule_offsets, (num_rule_lists + 1) * sizeof(uint32_t));
+	std::memcpy(image.data() + header.rule_ids_pos, ruleset.rule_ids, num_rule_ids * sizeof(uint32_t));
+	std::memcpy(image.data() + header.pattern_bytes_pos, ruleset.pattern_bytes, num_pattern_bytes);
+
+	header.checksum = fnv1a(image.data() + sizeof(RulesetHeader), image.size() - sizeof(RulesetHeader));
+	std::memcpy(image.data(), &header, sizeof(header));
+	return image;
+}
+
+/// <summary>
+/// Write an image to a file atomically: it is written to a temporary file in the same directory, then renamed over the target.
+/// Readers see either the whole old file or the whole new one, and a process that has the old file mapped keeps valid pages.
+/// </summary>
+/// <param name="path">Path to the file to create or replace</param>
+/// <param name="image">The bytes to write</param>
+void writeFileAtomically(const std::string& path, const std::vector<uint8_t>& image) {
+#if defined __GNUC__
+	std::string temp_path = path + ".tmp" + std::to_string(getpid());
+#else
+	std::string temp_path = path + ".tmp" + std::to_string(_getpid());
+#endif
+	std::ofstream output_file(temp_path, std::ios::binary | std::ios::trunc);
+	if (!output_file.is_open()) {
+		throw std::runtime_error("Error creating the file " + temp_path + ".");
+	}
+	output_file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+	output_file.close();
+	std::error_code error;
+	if (!output_file) {
+		std::filesystem::remove(temp_path, error);
+		throw std::runtime_error("Error writing the file " + temp_path + ".");
+	}
+	std::filesystem::rename(temp_path, path, error);
+	if (error) {
+		std::filesystem::remove(temp_path, error);
+		throw std::runtime_error("Error replacing the file " + path + ".");
+	}
+}
+
+/// <summary>
+/// Write the given ExactMatches as a compiled ruleset file.
+/// </summary>
+/// <param name="exact_matches">The ExactMatches to write</param>
+/// <param name="bin_path">Path to the compiled ruleset file to create</param>
+void writeRuleset(const ExactMatches& exact_matches, const std::string& bin_path) {
+	writeFileAtomically(bin_path, buildRulesetImage(exact_matches.view(), exact_matches.getRulePool().size()));
+}
+
+/// <summary>
+/// Map a file read-only into memory: its pages are shared by all the processes mapping it (MAP_PRIVATE, never written).
+/// Where mmap is not available (Windows) the file is read into buffer instead.
+/// </summary>
+/// <param name="min_size">The smallest valid file size (its header)</param>
+/// <returns>true if the file was mapped (mapping / mapping_size are set), false otherwise</returns>
+bool mapReadOnlyFile(const std::string& path, std::size_t min_size, const uint8_t*& mapping, std::size_t& mapping_size,
+					 std::vector<uint64_t>& buffer) {
+#if defined __GNUC__
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || static_cast<std::size_t>(file_stat.st_size) < min_size) {
+		::close(fd);
+		return false;
+	}
+	void* addr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+	mapping = static_cast<const uint8_t*>(addr);
+	mapping_size = file_stat.st_size;
+#else
+	std::ifstream input_file(path, std::ios::binary | std::ios::ate);
+	if (!input_file.is_open()) {
+		return false;
+	}
+	mapping_size = static_cast<std::size_t>(input_file.tellg());
+	if (mapping_size < min_size) {
+		mapping_size = 0;
+		return false;
+	}
+	buffer.resize((mapping_size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+	input_file.seekg(0);
+	input_file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(mapping_size));
+	mapping = reinterpret_cast<const uint8_t*>(buffer.data());
+#endif
+	return true;
+}
+
+/// <summary>
+/// Unmap a file mapped by mapReadOnlyFile (or release its buffer).
+/// </summary>
+void unmapReadOnlyFile(const uint8_t*& mapping, std::size_t& mapping_size, std::vector<uint64_t>& buffer) {
+#if defined __GNUC__
+	if (mapping != nullptr) {
+		munmap(const_cast<uint8_t*>(mapping), mapping_size);
+	}
+#else
+	buffer.clear();
+#endif
+	mapping = nullptr;
+	mapping_size = 0;
+}
+
+/// <summary>
+/// Check that a section of count elements of element_size bytes at pos lies within a file of file_size bytes, and is aligned
+/// to alignment (the arithmetic can not overflow, whatever the header of the file holds).
+/// </summary>
+bool isFileSectionValid(uint64_t pos, uint64_t count, std::size_t element_size, uint64_t file_size, std::size_t alignment) {
+	return pos % alignment == 0 && pos <= file_size && count <= (file_size - pos) / element_size;
+}
+
+/// <summary>
+/// Check that the num_of_offsets + 1 offsets of an offsets section never decrease, and the last one is at most max_offset
+/// (every range they delimit is then within its section).
+/// </summary>
+bool areOffsetsValid(const uint32_t* offsets, std::size_t num_of_offsets, uint64_t max_offset) {
+	for (std::size_t i = 0; i < num_of_offsets; ++i) {
+		if (offsets[i + 1] < offsets[i]) {
+			return false;
+		}
+	}
+	return offsets[num_of_offsets] <= max_offset;
+}
+
+/// <summary>
+/// Validate a compiled ruleset image: its header, its checksum, and that every section and every offset (and rule list index)
+/// it holds is within the image, so the RulesetView of the image never reads outside of it.
+/// </summary>
+/// <returns>true if the image is a valid compiled ruleset of the current version</returns>
+bool isValidRulesetImage(const uint8_t* image, std::size_t image_size) {
+	if (image_size < sizeof(RulesetHeader)) {
+		return false;
+	}
+	const RulesetHeader& header = *reinterpret_cast<const RulesetHeader*>(image);
+	if (std::memcmp(header.magic, RULESET_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != RULESET_VERSION || header.file_size != image_size) {
+		return false;
+	}
+	if (!isFileSectionValid(header.pattern_offsets_pos, uint64_t(header.num_patterns) + 1, sizeof(uint32_t), image_size, RULESET_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.pattern_rules_pos, header.num_patterns, sizeof(uint32_t), image_size, RULESET_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.rule_offsets_pos, uint64_t(header.num_rule_lists) + 1, sizeof(uint32_t), image_size, RULESET_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.rule_ids_pos, header.num_rule_ids, sizeof(uint32_t), image_size, RULESET_SECTION_ALIGNMENT)
+		|| !isFileSectionValid(header.pattern_bytes_pos, header.num_pattern_bytes, sizeof(uint8_t), image_size, RULESET_SECTION_ALIGNMENT)
+		|| header.pattern_offsets_pos < sizeof(RulesetHeader)) {
+		return false;
+	}
+	if (header.checksum != fnv1a(image + sizeof(RulesetHeader), image_size - sizeof(RulesetHeader))) {
+		return false;
+	}
+
+	const uint32_t* pattern_rules = reinterpret_cast<const uint32_t*>(image + header.pattern_rules_pos);
+	for (std::size_t i = 0; i < header.num_patterns; ++i) {
+		if (pattern_rules[i] >= header.num_rule_lists) {
+			return false;
+		}
+	}
+	return areOffsetsValid(reinterpret_cast<const uint32_t*>(image + header.pattern_offsets_pos), header.num_patterns, header.num_pattern_bytes)
+		&& areOffsetsValid(reinterpret_cast<const uint32_t*>(image + header.rule_offsets_pos), header.num_rule_lists, header.num_rule_ids);
+}
+
+/// <summary>
+/// A compiled ruleset file, mapped read-only into memory (on Windows it is read into a buffer instead).
+/// view() exposes the ExactMatches stored in the file in place, without parsing or copying them.
+/// </summary>
+class RulesetFile {
+public:
+	RulesetFile() : mapping(nullptr), mapping_size(0) {}
+	~RulesetFile() { close(); }
+	RulesetFile(const RulesetFile&) = delete;
+	RulesetFile& operator=(const RulesetFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+	const RulesetView& view() const { return ruleset; }
+	const RulesetHeader& header() const { return *reinterpret_cast<const RulesetHeader*>(mapping); }
+
+private:
+	const uint8_t* mapping;
+	std::size_t mapping_size;
+	std::vector<uint64_t> buffer;		// used only where mmap is not available
+	RulesetView ruleset;
+};
+
+/// <summary>
+/// Map a compiled ruleset file and validate it (see isValidRulesetImage).
+/// </summary>
+/// <param name="path">Path to the compiled ruleset file</param>
+/// <returns>true if the file was mapped and is a valid compiled ruleset of the current version, false otherwise (e.g. truncated or corrupt).</returns>
+bool RulesetFile::open(const std::string& path) {
+	close();
+	if (!mapReadOnlyFile(path, sizeof(RulesetHeader), mapping, mapping_size, buffer)) {
+		return false;
+	}
+
+	if (!isValidRulesetImage(mapping, mapping_size)) {
+		close();
+		return false;
+	}
+	const RulesetHeader& file_header = header();
+	ruleset.num_patterns = file_header.num_patterns;
+	ruleset.pattern_offsets = reinterpret_cast<const uint32_t*>(mapping + file_header.pattern_offsets_pos);
+	ruleset.pattern_rules = reinterpret_cast<const uint32_t*>(mapping + file_header.pattern_rules_pos);
+	ruleset.rule_offsets = reinterpret_cast<const uint32_t*>(mapping + file_header.rule_offsets_pos);
+	ruleset.rule_ids = reinterpret_cast<const uint32_t*>(mapping + file_header.rule_ids_pos);
+	ruleset.pattern_bytes = mapping + file_header.pattern_bytes_pos;
+	return true;
+}
+
+void RulesetFile::close() {
+	unmapReadOnlyFile(mapping, mapping_size, buffer);
+	ruleset = RulesetView();
+}
+
+
+/// <summary>
+/// Default path of the compiled ruleset of a Part A .json file ("parta_data_by_exactmatch.json" -> "parta_data_by_exactmatch.bin").
+/// </summary>
+std::string defaultRulesetPath(const std::string& json_path) {
+	return std::filesystem::path(json_path).replace_extension(RULESET_FILE_EXTENSION).string();
+}
+
+#endif // _RULESET_H
@@ -328,12 +328,28 @@ const bool DEFAULT_INSENSITIVE = true;
 
 	/// <summary>
 	/// A class representing a State in the aho-corasick automaton (trie tree).
+	/// The states and the nodes of their maps of transitions are allocated with Allocator (rebound), e.g. from huge pages.
 	/// </summary>
-	template<typename CharType>
+	template<typename CharType, typename Allocator = std::allocator<CharType>>
 	class state {
 	public:
-		typedef state<CharType>*                 ptr;
-		typedef std::unique_ptr<state<CharType>> unique_ptr;
+		typedef state<CharType, Allocator>*      ptr;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<state<CharType, Allocator>> state_allocator;
+
+		/// <summary>
+		/// Destroys a state and deallocates it with the allocator of its map (stateless, so a unique_ptr stays a pointer).
+		/// </summary>
+		struct deleter {
+			void operator()(ptr p) const {
+				state_allocator allocator(p->d_success.get_allocator());
+				std::allocator_traits<state_allocator>::destroy(allocator, p);
+				std::allocator_traits<state_allocator>::deallocate(allocator, p, 1);
+			}
+		};
+
+		typedef std::unique_ptr<state<CharType, Allocator>, deleter> unique_ptr;
+		typedef std::map<CharType, unique_ptr, std::less<CharType>,
+			typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const CharType, unique_ptr>>> success_map;
 		typedef std::basic_string<CharType>      string_type;
 		typedef std::basic_string<CharType>&     string_ref_type;
 		typedef std::pair<string_type, unsigned> key_index;
@@ -344,7 +360,7 @@ const bool DEFAULT_INSENSITIVE = true;
 	private:
 		size_t                         d_depth;
 		ptr                            d_root;
-		std::map<CharType, unique_ptr> d_success;		// Effective list of transitions and chars
+		success_map                    d_success;		// Effective list of transitions and chars
 														// For every state in the automaton:
 														//		map: {char_of_next_state(s) : ptr_to_follow_up_state}
 														//		Bla => ['B', ptr_B] -> ['l', ptr_l] -> ['a', ptr_a]
@@ -356,13 +372,29 @@ const bool DEFAULT_INSENSITIVE = true;
 	public:
 		state(): state(0) {}
 
-		explicit state(size_t depth)
+		explicit state(size_t depth, const Allocator& allocator = Allocator())
 			: d_depth(depth)
 			, d_root(depth == 0 ? this : nullptr)
-			, d_success()
+			, d_success(typename success_map::allocator_type(allocator))
 			, d_failure(nullptr)
 			, d_emits() {}
 
+		/// <summary>
+		/// Allocates a state with allocator (rebound), owned by the returned unique_ptr.
+		/// </summary>
+		static unique_ptr create(size_t depth, const Allocator& allocator) {
+			state_allocator node_allocator(allocator);
+			ptr p = std::allocator_traits<state_allocator>::allocate(node_allocator, 1);
+			try {
+				std::allocator_traits<state_allocator>::construct(node_allocator, p, depth, allocator);
+			}
+			catch (...) {
+				std::allocator_traits<state_allocator>::deallocate(node_allocator, p, 1);
+				throw;
+			}
+			return unique_ptr(p);
+		}
+
 		/// <summary>
 		/// Returns the size of a node in Bytes.
 		///	Usage:
@@ -424,8 +456,9 @@ const bool DEFAULT_INSENSITIVE = true;
 		ptr add_state(CharType character) {
 			auto next = next_state_ignore_root_state(character);
 			if (next == nullptr) {
-				next = new state<CharType>(d_depth + 1);
-				d_success[character].reset(next);
+				unique_ptr created = create(d_depth + 1, Allocator(d_success.get_allocator()));
+				next = created.get();
+				d_success.emplace(character, std::move(created));
 			}
 			return next;
 		}
@@ -486,19 +519,20 @@ const bool DEFAULT_INSENSITIVE = true;
 	///			  Use std::basic_string to deal with strings that has NPSCs (Non Printable and Special Characters).
 	/// </summary>
 	/// <typeparam name="CharType"></typeparam>
-	template<typename CharType>
+	/// <typeparam name="Allocator">The allocator of the states and their transitions (e.g. HugePageAllocator<CharType>)</typeparam>
+	template<typename CharType, typename Allocator = std::allocator<CharType>>
 	class basic_trie {
 	public:
 		using string_type = std::basic_string < CharType >;
 		using string_ref_type = std::basic_string<CharType>&;
 
-		typedef state<CharType>         state_type;
-		typedef state<CharType>*		state_ptr_type;
+		typedef state<CharType, Allocator>  state_type;
+		typedef state<CharType, Allocator>* state_ptr_type;
 		typedef token<CharType>         token_type;
 		typedef emit<CharType>          emit_type;
 		typedef std::vector<token_type> token_collection;
 		typedef std::vector<emit_type>  emit_collection;
-		typedef basic_trie<CharType>	this_trie_type;
+		typedef basic_trie<CharType, Allocator> this_trie_type;
 
 		class config {
 			bool d_allow_overlaps;
@@ -522,7 +556,7 @@ const bool DEFAULT_INSENSITIVE = true;
 		};
 
 	private:
-		std::unique_ptr<state_type> d_root;
+		typename state_type::unique_ptr d_root;
 		config                      d_config;
 		std::atomic_bool            d_constructed_failure_states;
 		unsigned                    d_num_keywords = 0;
@@ -531,8 +565,10 @@ const bool DEFAULT_INSENSITIVE = true;
 	public:
 		basic_trie() : basic_trie(config()) {}
 
-		basic_trie(const config& c)
-			: d_root(new state_type())
+		explicit basic_trie(const Allocator& allocator) : basic_trie(config(), allocator) {}
+
+		basic_trie(const config& c, const Allocator& allocator = Allocator())
+			: d_root(state_type::create(0, allocator))
 			, d_config(c)
 			, d_constructed_failure_states(false) {}
 
@@ -744,7 +780,7 @@ const bool DEFAULT_INSENSITIVE = true;
 		/// <param name="include_peripherals">A Boolean to determine whether or not to calculate a node's peripherals in the total size.</param>
 		/// <param name="print">A Boolean to determine whether or not to print the emits when traversing the tree</param>
 		/// <param name="count_edges">A Boolean to determine whether or not to count ONLY the edges of the automaton</param>
-		void traverse_tree_aux(const typename basic_trie<CharType>::state_ptr_type& node, size_t* size_ptr,
+		void traverse_tree_aux(const state_ptr_type& node, size_t* size_ptr,
 			bool include_emits = false, bool include_peripherals = false, bool print = false, bool count_edges = false) const {
 			
 			// Stop condition: NULLPTR (no further sons / transitions to node)
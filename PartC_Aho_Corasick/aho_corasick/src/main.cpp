@@ -6,6 +6,12 @@
 // (This is assuming a x32-bits hardware).
 #define SIZE_OF_GO_TO_TABLE_ENTRY 11	// Bytes
 
+// Allocate the states and transitions of the TRIE from huge pages (see HugePages.h), else from the heap
+#define USE_HUGE_PAGES true
+
+// The Aho Corasick TRIE: its states and transitions are allocated by a HugePageAllocator (std::allocator when it has no arena)
+typedef aho_corasick::basic_trie<char, HugePageAllocator<char>> huge_page_trie;
+
 // Theoretical calculations for the addition size needed to store the rules' SID(s) list / IBLT for each entry
 const std::size_t SID_ENTRY_IN_LINKED_LIST = 64; // size in bits (32bits for the SID, 32bits for the pointer to next item)
 const std::size_t IBLT_CELL_SIZE = 40; // size in bits (32 bits for the SID xor sum, 8 bits for the Bloom Filter)
@@ -20,7 +26,7 @@ const std::size_t IBLT_CELLS_SUCCESS_RATE_95 = 8; // based on part D
 /// </summary>
 /// <param name="trie">The Aho Corasick State Machine (TRIE tree)</param>
 /// <param name="text">The input text to parse</param>
-void find(aho_corasick::trie* trie, bstring& text) {
+void find(huge_page_trie* trie, bstring& text) {
 	auto res = trie->parse_text(text);
 	std::cout << "Parsed [" << res.size() << "] item(s): " << std::endl;
 	for (auto match : res) { // res is of class emit
@@ -36,15 +42,15 @@ void find(aho_corasick::trie* trie, bstring& text) {
 /// <param name="trie">The Aho Corasick State Machine (TRIE tree)</param>
 /// <param name="text">The input text to parse</param>
 /// <param name="log">The respective SearchResults item where the hits would be registered</param>
-void find(aho_corasick::trie* trie, bstring& text, SearchResults& log, const std::map<bstring, std::set<int>>& map) {
+void find(huge_page_trie* trie, bstring& text, SearchResults& log, const std::map<bstring, Span<uint32_t>>& map) {
 	auto res = trie->parse_text(text);
 	//std::cout << "Matched on " << res.size() << " item(s)" << std::endl;
 	for (auto test : res) { // res is of class emit
 		//std::cout << '\t' << test.get_keyword() << std::endl;
 		bstring test_bstring = test.get_keyword();
 		try {
-			const std::set<int>& rules = map.at(test_bstring);
-			for (int rule : rules) {
+			const Span<uint32_t>& rules = map.at(test_bstring);
+			for (uint32_t rule : rules) {
 				// log.sids_hit[rule]++;
 				log.sids_hit[rule] += test.length();
 			}
@@ -68,8 +74,9 @@ void find(aho_corasick::trie* trie, bstring& text, SearchResults& log, const std
 /// <param name="stats">A class member of Statistics</param>
 /// <param name="threshold">Minimum length threshold for the exact matches (take only exact matches with length >= threshold)</param>
 /// <param name="bstrings">An std::vector of the basic_string<char> represeting the exact matches to insert</param>
+/// <param name="use_huge_pages">Allocate the states and transitions of the TRIE from huge pages (see HugePages.h)</param>
 void runTest(Statistics& stats, Results& results, const size_t threshold, const std::vector<bstring>& bstrings, 
-	std::vector<SearchResults>* search_results, std::map<bstring, std::set<int>>& sids_map) {
+	std::vector<SearchResults>* search_results, std::map<bstring, Span<uint32_t>>& sids_map, bool use_huge_pages = USE_HUGE_PAGES) {
 	for (auto it = (*search_results).begin(); it != (*search_results).end(); it++) {
 		it->sids_hit.clear();
 	}
@@ -94,7 +101,8 @@ void runTest(Statistics& stats, Results& results, const size_t threshold, const
 	std::vector<bstring> search_strings;
 	toBstring(search_results, search_strings);
 
-	aho_corasick::trie* aho_corasick_trie;
+	huge_page_trie* aho_corasick_trie;
+	HugePageArena huge_pages;		// released after the TRIE is deleted
 	std::size_t nodes_size = 0;
 	std::size_t total_edges = 0;
 	std::size_t size_in_theory = 0;
@@ -106,7 +114,7 @@ void runTest(Statistics& stats, Results& results, const size_t threshold, const
 	auto timestamp_a = std::chrono::high_resolution_clock::now();
 
 	// Allocate a new TRIE tree for test timing consistancy
-	aho_corasick_trie = new aho_corasick::trie();
+	aho_corasick_trie = new huge_page_trie(HugePageAllocator<char>(use_huge_pages ? &huge_pages : nullptr));
 
 	// Insert the exact matches into the aho corasick TRIE
 	for (bstring s : thresholded_bstrings) {
@@ -154,8 +162,12 @@ void runTest(Statistics& stats, Results& results, const size_t threshold, const
 		std::cout << "Statistics for Aho_Corasick with Threshold <= " << threshold;
 		std::cout << std::endl << std::dec << exact_matches_inserted << " Exact Match(es) were inserted." << std::endl		\
 			<< "Aho Corasick size: " << size_in_theory << " Bytes" << std::endl												\
-			<< "Insertion time: " << static_cast<double>(test_runtime) << "[ms]." << std::endl								\
-			<< std::endl;
+			<< "Insertion time: " << static_cast<double>(test_runtime) << "[ms]." << std::endl;
+		if (use_huge_pages) {
+			std::cout << "TRIE in huge pages (" << hugePageBackingName(huge_pages.backing()) << "): " << huge_pages.usedBytes()	\
+				<< " Bytes, " << huge_pages.hugePageBytes() << " Bytes backed by huge pages." << std::endl;
+		}
+		std::cout << std::endl;
 	}
 }
 	
@@ -180,16 +192,18 @@ int main(int argc, char* argv[]) {
 	std::string file_path = "parta_data_by_exactmatch.json";
 	std::string dest_path = "";
 	std::string test_path = "snort_string_check.json";
+	std::string ruleset_path = "";
 	
 	// Retrieving arguments from WSL / Visual Studio
-	getOpts(argc, argv, file_path, dest_path, test_path);
+	getOpts(argc, argv, file_path, dest_path, test_path, ruleset_path);
 
-	// Parsing input file of patterns to add to the Aho Corasick TRIE
-	ExactMatches exact_matches;
-	parseFile(file_path, exact_matches);
+	// Mapping the compiled ruleset (compiled once from the input file) of patterns to add to the Aho Corasick TRIE
+	RulesetFile ruleset;
+	loadRuleset(file_path, ruleset_path, ruleset);
+	const RulesetView& exact_matches = ruleset.view();
 
 	// Creating a map for each input exact match with its respective rule
-	std::map<bstring, std::set<int>> sids_map;
+	std::map<bstring, Span<uint32_t>> sids_map;
 	exact_matches.createMap(sids_map);
 
 	// Parsing test file of patterns to search the Aho Corasick TRIE
@@ -218,14 +232,11 @@ int main(int argc, char* argv[]) {
 		// In order to have comparison ground with the Hash Table, we will also check the search results (hits/misses) using threshold
 		if (threshold >= 1 && threshold <= 8) {
 			// Calculate additional size required
-			for (ExactMatch* exact_match : (*exact_matches.exact_matches)) {
-				bstring bstr;
-				hexToBstring(exact_match->getExactMatch(), bstr);
-				//std::cout << "Exact Match: " << bstr << std::endl;
-				//std::cout << "Exact Match Length: " << bstr.length() << std::endl;
-				if (bstr.length() >= threshold) {	// Exact Match is in the Aho Corasick for current threshold
-					raw_list_size += exact_match->getRulesNumbers().size() * SID_ENTRY_IN_LINKED_LIST;
-					iblt_size_optimal += 2 * exact_match->getRulesNumbers().size() * IBLT_CELL_SIZE;
+			for (std::size_t i = 0; i < exact_matches.size(); ++i) {
+				//std::cout << "Exact Match Length: " << exact_matches.getExactMatch(i).size() << std::endl;
+				if (exact_matches.getExactMatch(i).size() >= threshold) {	// Exact Match is in the Aho Corasick for current threshold
+					raw_list_size += exact_matches.getRulesNumbers(i).size() * SID_ENTRY_IN_LINKED_LIST;
+					iblt_size_optimal += 2 * exact_matches.getRulesNumbers(i).size() * IBLT_CELL_SIZE;
 					iblt_size_100_rate += IBLT_CELLS_SUCCESS_RATE_100 * IBLT_CELL_SIZE;
 					iblt_size_99_rate += IBLT_CELLS_SUCCESS_RATE_99 * IBLT_CELL_SIZE;
 					iblt_size_95_rate += IBLT_CELLS_SUCCESS_RATE_95 * IBLT_CELL_SIZE;